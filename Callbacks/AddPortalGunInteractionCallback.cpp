@@ -7,7 +7,7 @@ namespace brtr{
     _switcher(switcher){}
 
     void AddPortalGunInteractionCallback::setText() {
-        _text->setText("Defect Portal Gun. \nLeft Click to pick it up anyway.");
+        showText("Defect Portal Gun. \nLeft Click to pick it up anyway.");
     }
 
     void AddPortalGunInteractionCallback::interact(osg::Node* node, osg::NodeVisitor* nv) {
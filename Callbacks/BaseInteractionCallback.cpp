@@ -7,10 +7,8 @@ namespace brtr {
         _attachTo(attachTo),
         _hudCam(hudCam),
         _done(false){
-        _text = brtr::createText(osg::Vec3d(width / 2.0 - 320, height / 2.0 - 110, 0), "", width * 0.02);
-        osg::ref_ptr<osg::Geode> textGeode = new osg::Geode;
-        textGeode->addDrawable(_text);    
-        _hudCam->addChild(textGeode);
+        //all callbacks of a HUD share one text drawable
+        _textLayer = HUDTextLayer::getOrCreate(_hudCam, width, height);
     }
 
     void BaseInteractionCallback::operator()(osg::Node* node, osg::NodeVisitor* nv) {
@@ -29,7 +27,13 @@ namespace brtr {
     }
 
     void BaseInteractionCallback::clearText() {
-        _text->setText("");
+        if (_textLayer)
+            _textLayer->clearMessage(this);
+    }
+
+    void BaseInteractionCallback::showText(const std::string& text) {
+        if (_textLayer)
+            _textLayer->setMessage(this, text);
     }
 
     void BaseInteractionCallback::reactivate() {
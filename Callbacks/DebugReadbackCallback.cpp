@@ -0,0 +1,85 @@
+#include "../header/DebugReadbackCallback.h"
+#include <osg/GL>
+#include <osg/Notify>
+#include <vector>
+
+namespace brtr {
+
+    DebugReadbackCallback::DebugReadbackCallback(osg::Texture2D* texture, osg::Camera* camera, unsigned int interval) :
+        _texture(texture),
+        _camera(camera),
+        _interval(interval > 0 ? interval : 1),
+        _mode(CelShading::DEBUG_OFF),
+        _frame(0) {}
+
+    void DebugReadbackCallback::setMode(CelShading::DebugMode mode) {
+        _mode.exchange(mode);
+        //first summary one interval after the switch, the techniques need a frame to compile
+        _frame.exchange(0);
+    }
+
+    void DebugReadbackCallback::operator()(osg::RenderInfo& renderInfo) const {
+        CelShading::DebugMode mode = static_cast<CelShading::DebugMode>(static_cast<unsigned int>(_mode));
+        if (mode == CelShading::DEBUG_OFF || ++_frame % _interval != 0)
+            return;
+        osg::ref_ptr<osg::Camera> camera;
+        if (!_camera.lock(camera) || !camera->getViewport())
+            return;
+        int width = _texture->getTextureWidth(), height = _texture->getTextureHeight();
+        if (width <= 0 || height <= 0)
+            return;
+
+        //rows of RGBA bytes are always 4 byte aligned
+        std::vector<unsigned char> pixels(width * height * 4);
+        osg::State& state = *renderInfo.getState();
+        state.setActiveTextureUnit(0);
+        state.applyTextureAttribute(0, _texture.get());
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+        const osg::Viewport* viewport = camera->getViewport();
+        int x0 = osg::clampBetween((int)viewport->x(), 0, width), y0 = osg::clampBetween((int)viewport->y(), 0, height);
+        int x1 = osg::clampBetween((int)(viewport->x() + viewport->width()), x0, width);
+        int y1 = osg::clampBetween((int)(viewport->y() + viewport->height()), y0, height);
+        unsigned int histogram[256] = { 0 };
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x)
+                histogram[pixels[(y * width + x) * 4]]++;
+        }
+        report(mode, histogram, (x1 - x0) * (y1 - y0));
+    }
+
+    void DebugReadbackCallback::report(CelShading::DebugMode mode, const unsigned int* histogram, unsigned int numPixels) const {
+        if (numPixels == 0)
+            return;
+        unsigned int covered = numPixels - histogram[0], maxCount = 0, atLeast3 = 0, atLeast4 = 0;
+        double sum = 0.0;
+        for (unsigned int i = 1; i < 256; ++i) {
+            if (histogram[i] == 0)
+                continue;
+            maxCount = i;
+            sum += (double)i * histogram[i];
+            if (i >= 3) atLeast3 += histogram[i];
+            if (i >= 4) atLeast4 += histogram[i];
+        }
+        double coverage = 100.0 * covered / numPixels;
+        double perCovered = covered > 0 ? sum / covered : 0.0;
+        switch (mode) {
+        case CelShading::DEBUG_OVERDRAW:
+            OSG_ALWAYS << "Overdraw: " << sum / numPixels << " shaded fragments per pixel, " << perCovered
+                << " per covered pixel (" << coverage << "% covered), max " << maxCount << ", "
+                << (covered > 0 ? 100.0 * atLeast4 / covered : 0.0) << "% of the covered pixels shaded 4 times or more" << std::endl;
+            break;
+        case CelShading::DEBUG_LIGHTS:
+            OSG_ALWAYS << "Lights per pixel: " << perCovered << " on the lit pixels (" << coverage << "% of the screen), max "
+                << maxCount << ", " << (covered > 0 ? 100.0 * atLeast3 / covered : 0.0) << "% lit by 3 or more" << std::endl;
+            break;
+        case CelShading::DEBUG_OUTLINES:
+            OSG_ALWAYS << "Outline coverage: " << coverage << "% of the pixels, " << perCovered
+                << " outline fragments per outline pixel, max " << maxCount << std::endl;
+            break;
+        default:
+            break;
+        }
+    }
+
+}
@@ -19,30 +19,34 @@ namespace brtr {
         //linear motion for the effect
         _motion->update(1);
         osg::Camera* camera = static_cast<osg::Camera*>(node);
+        //the planes are kept, FogFarPlaneCallback owns the far plane
+        double fovy = 70, aspect = 1.778, zNear = 0.01, zFar = 100000;
         if (camera) {
+            camera->getProjectionMatrixAsPerspective(fovy, aspect, zNear, zFar);
             OSG_NOTICE << "Motion Value " << _motion->getValue() << std::endl;
             //backwards after up to FOV 125
             if (_motion->getValue() >= 125)
                 _backwards = !_backwards;
-            camera->setProjectionMatrixAsPerspective(_backwards ? 195 - _motion->getValue() : _motion->getValue(), 2, 0.01, 100000);
+            camera->setProjectionMatrixAsPerspective(_backwards ? 195 - _motion->getValue() : _motion->getValue(), 2, zNear, zFar);
         }//camera
         
         if (nv->getFrameStamp()->getReferenceTime() - _startTime >= 20) {
             if (camera) {
-                camera->setProjectionMatrixAsPerspective(70, 1.778, 0.01, 100000);
+                camera->setProjectionMatrixAsPerspective(70, 1.778, zNear, zFar);
                 _done = true;
                 _geometrySwitch = nullptr;
                 _hudCam = nullptr;
                 _attachTo = nullptr;
                 _motion = nullptr;
-                _text = nullptr;
+                clearText();
+                _textLayer = nullptr;
                 OSG_NOTICE << "DrunkenInteractionCallback: Should now be removed" << std::endl;
             }//camera
         }//30 sec over
     }
 
     void DrunkenInteractionCallback::setText() {
-        _text->setText("Click Left Mouse for a drink!");
+        showText("Click Left Mouse for a drink!");
     }
 
 }
@@ -0,0 +1,39 @@
+#include "../header/FogFarPlaneCallback.h"
+#include <osg/Program>
+#include <osg/ValueObject>
+#include <cmath>
+
+namespace brtr {
+
+    FogFarPlaneCallback::FogFarPlaneCallback(osg::Camera* camera, osg::Uniform* zFar, osg::Uniform* fogStart, osg::Uniform* fogEnd, float defaultFar) :
+        _camera(camera),
+        _zFar(zFar),
+        _fogStart(fogStart),
+        _fogEnd(fogEnd),
+        _defaultFar(defaultFar) {}
+
+    void FogFarPlaneCallback::operator()(osg::Node* node, osg::NodeVisitor* nv) {
+        osg::ref_ptr<osg::Camera> camera;
+        osg::StateSet* stateSet = node->getStateSet();
+        if (_camera.lock(camera) && stateSet) {
+            float fogStart = 0.0f, fogEnd = 0.0f, zFar = _defaultFar;
+            const osg::Program* program = dynamic_cast<const osg::Program*>(stateSet->getAttribute(osg::StateAttribute::PROGRAM));
+            if (program && program->getUserValue("fogStart", fogStart) && program->getUserValue("fogEnd", fogEnd)) {
+                zFar = fogEnd;
+                _fogStart->set(fogStart);
+                _fogEnd->set(fogEnd);
+            }
+
+            //others may set the projection as well (DrunkenInteractionCallback), the camera is the reference
+            double fovy, aspect, zNear, oldFar;
+            if (camera->getProjectionMatrixAsPerspective(fovy, aspect, zNear, oldFar) && std::abs(oldFar - zFar) > zFar * 1e-4)
+                camera->setProjectionMatrixAsPerspective(fovy, aspect, zNear, zFar);
+            float currentFar = 0.0f;
+            _zFar->get(currentFar);
+            if (currentFar != zFar)
+                _zFar->set(zFar);
+        }
+        traverse(node, nv);
+    }
+
+}
@@ -8,10 +8,13 @@ namespace brtr {
     ProgramSwitcherCallback::ProgramSwitcherCallback(osg::Node* postprocessCam, osg::Camera* hudCam, int width, int height, std::vector<osg::ref_ptr<osg::Program>> programs):
         BaseInteractionCallback(postprocessCam,hudCam,width,height),
         _programs(programs),
-        _curProg(0){}
+        _curProg(0){
+        //programs are switched while the draw thread may still use the stateset
+        _attachTo->getOrCreateStateSet()->setDataVariance(osg::Object::DYNAMIC);
+    }
 
     void ProgramSwitcherCallback::setText() {
-        _text->setText("You feel a mysterious power\nfrom this strange device.\nA click will change the world...");
+        showText("You feel a mysterious power\nfrom this strange device.\nA click will change the world...");
     }
 
     void ProgramSwitcherCallback::interact(osg::Node*, osg::NodeVisitor*) {
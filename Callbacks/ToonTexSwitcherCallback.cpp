@@ -1,26 +1,31 @@
 #include <osg/NodeCallback>
 #include <osgViewer/Viewer>
 #include <osgDB/ReadFile>
+#include <algorithm>
 #include "../header/ToonTexSwitcherCallback.h"
 
 namespace brtr {
    
 
-    ToonTexSwitcherCallback::ToonTexSwitcherCallback(osg::Node* sceneData, osg::Camera* hudCam, int width, int height, std::vector<osg::ref_ptr<osg::Texture2D>> toonTexs) :
+    ToonTexSwitcherCallback::ToonTexSwitcherCallback(osg::Node* sceneData, osg::Camera* hudCam, int width, int height, unsigned int numToonTexs) :
     BaseInteractionCallback(sceneData,hudCam,width,height),
     _curTex(0),
-    _toonTexs(toonTexs){ }
+    _numToonTexs(numToonTexs),
+    _toonIndex(new osg::Uniform("toonIndex", 0)){
+        //the uniform is changed while the draw thread may still use it
+        _toonIndex->setDataVariance(osg::Object::DYNAMIC);
+        _attachTo->getOrCreateStateSet()->addUniform(_toonIndex);
+    }
 
     void ToonTexSwitcherCallback::setText() {
-        _text->setText("The colors of the world\nare hidden here.\nTouch them, if you dare.");
+        showText("The colors of the world\nare hidden here.\nTouch them, if you dare.");
     }
 
     void ToonTexSwitcherCallback::interact(osg::Node*, osg::NodeVisitor*) {
         _done = true;
-        _attachTo->getOrCreateStateSet()->removeTextureAttribute(1, _toonTexs[_curTex]);
         _curTex++;
-        _curTex = _curTex % _toonTexs.size();
-        _attachTo->getOrCreateStateSet()->setTextureAttribute(1, _toonTexs[_curTex], osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+        _curTex = _curTex % std::max(_numToonTexs, 1u);
+        _toonIndex->set(_curTex);
     }
 
 
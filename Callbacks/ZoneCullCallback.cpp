@@ -0,0 +1,13 @@
+#include "../header/ZoneCullCallback.h"
+
+namespace brtr{
+    ZoneCullCallback::ZoneCullCallback(ZoneManager& manager, unsigned int zone) :
+        _manager(&manager),
+        _zone(zone) {}
+
+    void ZoneCullCallback::operator()(osg::Node* node, osg::NodeVisitor* nv) {
+        if (_manager->isVisible(_zone, nv->getFrameStamp()))
+            traverse(node, nv);
+    }
+
+}
@@ -0,0 +1,93 @@
+#include "../header/DynamicResolutionHandler.h"
+#include <osg/Stats>
+#include <osg/Viewport>
+#include <algorithm>
+#include <cmath>
+
+using namespace osg;
+
+namespace brtr {
+
+    DynamicResolutionHandler::DynamicResolutionHandler(const RenderingPipeline& pipe, double budgetMs, bool resizeTextures, double minScale) :
+        _pipe(pipe),
+        _budget(budgetMs),
+        _resizeTextures(resizeTextures),
+        _minScale(minScale),
+        _scale(1.0),
+        _step(0.1),
+        _adjustInterval(30),
+        _lastAdjustFrame(0),
+        _statsEnabled(false) {}
+
+    bool DynamicResolutionHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa) {
+        if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME || !aa.asView())
+            return false;
+        Camera* camera = aa.asView()->getCamera();
+        Stats* stats = camera->getStats();
+        if (!stats)
+            return false;
+        if (!_statsEnabled) {
+            //the renderer only issues timer queries, if someone is interested
+            stats->collectStats("gpu", true);
+            _statsEnabled = true;
+        }
+
+        unsigned int frameNumber = aa.asView()->getFrameStamp()->getFrameNumber();
+        //wait until the stats history only contains frames with the current scale
+        if (frameNumber - _lastAdjustFrame < _adjustInterval)
+            return false;
+        double gpuTime = 0.0;
+        if (!stats->getAveragedAttribute("GPU draw time taken", gpuTime) || gpuTime <= 0.0)
+            return false;
+        double gpuTimeMs = gpuTime * 1000.0;
+
+        //the fill rate cost grows with the pixel count, i.e. with scale^2
+        double wanted = _scale * std::sqrt(_budget / gpuTimeMs);
+        if (gpuTimeMs > _budget)
+            setScale(std::max(wanted, _scale - _step));
+        else if (gpuTimeMs < _budget * 0.8 && _scale < 1.0)
+            setScale(std::min(wanted, _scale + _step));
+        else
+            return false;
+        _lastAdjustFrame = frameNumber;
+        OSG_NOTICE << "DynamicResolution: GPU " << gpuTimeMs << "ms, scale " << _scale << std::endl;
+        return false;
+    }
+
+    double DynamicResolutionHandler::getScale() const {
+        return _scale;
+    }
+
+    DynamicResolutionHandler& DynamicResolutionHandler::setScale(double val) {
+        val = std::max(_minScale, std::min(1.0, val));
+        if (std::abs(val - _scale) < 1e-3)
+            return *this;
+        _scale = val;
+        applyScale();
+        return *this;
+    }
+
+    void DynamicResolutionHandler::applyScale() {
+        int width = std::max(1, (int)(_pipe.width * _scale + 0.5));
+        int height = std::max(1, (int)(_pipe.height * _scale + 0.5));
+
+        //new viewport objects, the draw thread may still use the old ones
+        _pipe.pass_0_color->setViewport(new Viewport(0, 0, width, height));
+        _pipe.pass_0_depth->setViewport(new Viewport(0, 0, width, height));
+
+        if (_resizeTextures) {
+            _pipe.colorTexture->setTextureSize(width, height);
+            _pipe.colorTexture->dirtyTextureObject();
+            _pipe.depthTexture->setTextureSize(width, height);
+            _pipe.depthTexture->dirtyTextureObject();
+            //forces the render stages (and with them the FBOs) to be recreated
+            _pipe.pass_0_color->setRenderingCache(nullptr);
+            _pipe.pass_0_depth->setRenderingCache(nullptr);
+            _pipe.rttScale->set(Vec2(1.0f, 1.0f));
+        }
+        else {
+            _pipe.rttScale->set(Vec2((float)width / _pipe.width, (float)height / _pipe.height));
+        }
+    }
+
+}
@@ -9,6 +9,11 @@ using namespace osg;
 using namespace osgGA;
 
 namespace brtr {
+    namespace {
+        //predicted rays of the last frame may start and point this far off
+        const double rayTolerance = 0.05;
+    }
+
     FPSCameraManipulator::FPSCameraManipulator(double movementSpeed, double zHeight, Node* root, bool flightMode)
         :FirstPersonManipulator(),
         _forwardMovement(false),
@@ -32,7 +37,8 @@ namespace brtr {
         _intensity(1.0),
         _bodyLength(0.0),
         _savedzHeightCrouch(0.0),
-        _jumpHeight(4)
+        _jumpHeight(4),
+        _collisionMask(collisionMask)
     {
         setNode(root);
         ref_ptr<Node> evaBody= osgDB::readNodeFile("../BlenderFiles/exports/BodyEva.ive");
@@ -208,6 +214,7 @@ namespace brtr {
         }//if(_flightMode)
         else {
             double eyeIntersectionDistance = 1000;
+            auto wantedMovement = movement;
             if (intersect(newEye, newEye + movement * 10, eyeIntersectionDistance)) {
                 if (eyeIntersectionDistance < 1.75)
                     movement = Vec3d();
@@ -233,9 +240,12 @@ namespace brtr {
             }// if (_jumpingDown)
 
             newEye += movement;
-            if (groundIntersection(newEye))
+            bool grounded = groundIntersection(newEye);
+            if (grounded)
                 _eye = newEye;
-            else return false;
+            prefetchRays(wantedMovement, movement);
+            if (!grounded)
+                return false;
         }
         OSG_DEBUG << "eyeZ: " << _eye._v[2]<< std::endl;
         if (_attachBody)
@@ -260,13 +270,35 @@ namespace brtr {
         return true;
     }//groundIntersection()
 
+    void FPSCameraManipulator::prefetchRays(const osg::Vec3d& wantedMovement, const osg::Vec3d& movement) {
+        if (!_rayQueries.valid())
+            return;
+        //same rays as performEyeMovement() will cast from the current eye
+        std::vector<RayQueryService::Ray> rays;
+        if (wantedMovement.length() >= 1e-8)
+            rays.push_back(RayQueryService::Ray(_eye, _eye + wantedMovement * 10, _collisionMask));
+        auto nextEye = _eye + movement;
+        rays.push_back(RayQueryService::Ray(nextEye, nextEye + Vec3(0, 0, -1) * _maxFallHeight, _collisionMask));
+        _rayQueries->submit(rays);
+    }//prefetchRays()
+
     bool FPSCameraManipulator::intersect(const osg::Vec3d start, const osg::Vec3d end, double& distance) {
         if ((start - end).length() < 1e-8) return false; //avoids termination of program, if start == end
+        if (_rayQueries.valid()) {
+            RayQueryService::Ray ray(start, end, _collisionMask);
+            RayQueryService::Hit hit;
+            //the prediction of the last frame missed, the result is needed now
+            if (!_rayQueries->findResult(ray, rayTolerance, hit))
+                _rayQueries->intersect(ray, hit);
+            if (hit.valid)
+                distance = hit.distance;
+            return hit.valid;
+        }
         osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(start, end);
         intersector->setIntersectionLimit(osgUtil::Intersector::LIMIT_NEAREST);
         osgUtil::IntersectionVisitor iv(intersector);
         
-        iv.setTraversalMask(collisionMask); 
+        iv.setTraversalMask(_collisionMask);
         _node->accept(iv);
 
         if (intersector->containsIntersections()) {
@@ -304,6 +336,24 @@ namespace brtr {
         return _jumpHeight;
     }
 
+    int FPSCameraManipulator::getCollisionMask() const {
+        return _collisionMask;
+    }
+
+    FPSCameraManipulator& FPSCameraManipulator::setCollisionMask(int val) {
+        _collisionMask = val;
+        return *this;
+    }
+
+    RayQueryService* FPSCameraManipulator::getRayQueryService() const {
+        return _rayQueries.get();
+    }
+
+    FPSCameraManipulator& FPSCameraManipulator::setRayQueryService(RayQueryService* val) {
+        _rayQueries = val;
+        return *this;
+    }
+
     bool FPSCameraManipulator::performMovementLeftMouseButton(const double eventTimeDelta, const double dx, const double dy) {
         return false;
     }
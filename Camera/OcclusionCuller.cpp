@@ -0,0 +1,165 @@
+#include "../header/OcclusionCuller.h"
+#include "../header/TriangleCollector.h"
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/TriangleIndexFunctor>
+#include <osgUtil/CullVisitor>
+#include <osgUtil/RenderStage>
+#include <OpenThreads/ScopedLock>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        class TriangleCountVisitor : public NodeVisitor {
+        public:
+            TriangleCountVisitor() : NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN) {
+                collector.indices = &indices;
+            }
+            virtual void apply(Geode& geode) {
+                for (unsigned int i = 0; i < geode.getNumDrawables(); ++i)
+                    geode.getDrawable(i)->accept(collector);
+            }
+            unsigned int getNumTriangles() const {
+                return indices.size() / 3;
+            }
+            TriangleIndexFunctor<TriangleCollector> collector;
+            std::vector<unsigned int> indices;
+        };
+
+        //camera of the cull traversal, the passes of an osgFX effect traverse the node several times per camera
+        const Camera* getCullCamera(NodeVisitor* nv) {
+            osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+            return cv && cv->getCurrentRenderStage() ? cv->getCurrentRenderStage()->getCamera() : nullptr;
+        }
+
+        //on the OcclusionQueryNode, every camera reaching it is a test
+        class TestedCallback : public NodeCallback {
+        public:
+            TestedCallback(OcclusionCuller& culler) : _culler(culler) {}
+            virtual void operator()(Node* node, NodeVisitor* nv) {
+                _culler.countTested(node, getCullCamera(nv));
+                traverse(node, nv);
+            }
+        private:
+            OcclusionCuller& _culler;
+        };
+
+        //on the wrapped subgraph, only reached if the query passed
+        class PassedCallback : public NodeCallback {
+        public:
+            PassedCallback(OcclusionCuller& culler) : _culler(culler) {}
+            virtual void operator()(Node* node, NodeVisitor* nv) {
+                _culler.countPassed(node, getCullCamera(nv));
+                traverse(node, nv);
+            }
+        private:
+            OcclusionCuller& _culler;
+        };
+    }
+
+    OcclusionCuller::OcclusionCuller(unsigned int visibilityThreshold, unsigned int queryFrameCount) :
+        _visibilityThreshold(visibilityThreshold),
+        _queryFrameCount(queryFrameCount),
+        _enabled(true),
+        _lastTested(0),
+        _lastCulled(0) {}
+
+    bool OcclusionCuller::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa) {
+        if (ea.getEventType() == osgGA::GUIEventAdapter::FRAME) {
+            //the cull traversals of the last frame are done
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            _lastTested = _tested.size();
+            _lastCulled = _tested.size() - _passed.size();
+            _tested.clear();
+            _passed.clear();
+            return false;
+        }
+        if (ea.getEventType() == osgGA::GUIEventAdapter::KEYDOWN && ea.getKey() == osgGA::GUIEventAdapter::KEY_O) {
+            setQueriesEnabled(!_enabled);
+            OSG_ALWAYS << "Occlusion queries " << (_enabled ? "on" : "off") << ", " << _nodes.size() << " subgraphs, last frame "
+                << _lastCulled << " of " << _lastTested << " tests culled." << std::endl;
+            return true;
+        }
+        return false;
+    }
+
+    OcclusionQueryNode* OcclusionCuller::wrap(Node* node) {
+        if (!node)
+            return nullptr;
+        ref_ptr<OcclusionQueryNode> oqn = new OcclusionQueryNode;
+        oqn->setName(node->getName());
+        oqn->setVisibilityThreshold(_visibilityThreshold);
+        oqn->setQueryFrameCount(_queryFrameCount);
+        oqn->setQueriesEnabled(_enabled);
+        oqn->setDebugDisplay(false);
+        //keeps the node alive while it has no parent, the parent list changes while replacing
+        ref_ptr<Node> child = node;
+        Node::ParentList parents = node->getParents();
+        for (auto parent = parents.begin(); parent != parents.end(); ++parent)
+            (*parent)->replaceChild(node, oqn.get());
+        oqn->addChild(node);
+
+        oqn->addCullCallback(new TestedCallback(*this));
+        //outermost, so culling callbacks of the node itself (e.g. zones) do not count as occluded
+        ref_ptr<NodeCallback> passed = new PassedCallback(*this);
+        passed->setNestedCallback(node->getCullCallback());
+        node->setCullCallback(passed.get());
+        _nodes.push_back(oqn);
+        return oqn.get();
+    }
+
+    unsigned int OcclusionCuller::wrapHeavyChildren(Group* group, unsigned int minTriangles, float maxRadius) {
+        if (!group)
+            return 0;
+        //wrapping replaces the children, so collect first
+        std::vector<ref_ptr<Node>> heavy;
+        for (unsigned int i = 0; i < group->getNumChildren(); ++i) {
+            Node* child = group->getChild(i);
+            if (dynamic_cast<OcclusionQueryNode*>(child) || !child->getBound().valid() || child->getBound().radius() >= maxRadius)
+                continue;
+            TriangleCountVisitor counter;
+            child->accept(counter);
+            if (counter.getNumTriangles() >= minTriangles)
+                heavy.push_back(child);
+        }
+        for (auto child = heavy.begin(); child != heavy.end(); ++child)
+            wrap(child->get());
+        return heavy.size();
+    }
+
+    OcclusionCuller& OcclusionCuller::setQueriesEnabled(bool val) {
+        _enabled = val;
+        for (auto node = _nodes.begin(); node != _nodes.end(); ++node)
+            (*node)->setQueriesEnabled(val);
+        return *this;
+    }
+
+    bool OcclusionCuller::getQueriesEnabled() const {
+        return _enabled;
+    }
+
+    unsigned int OcclusionCuller::getNumWrapped() const {
+        return _nodes.size();
+    }
+
+    unsigned int OcclusionCuller::getNumTested() const {
+        return _lastTested;
+    }
+
+    unsigned int OcclusionCuller::getNumCulled() const {
+        return _lastCulled;
+    }
+
+    void OcclusionCuller::countTested(const osg::Node* node, const osg::Camera* camera) {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _tested.insert(std::make_pair(node, camera));
+    }
+
+    void OcclusionCuller::countPassed(const osg::Node* node, const osg::Camera* camera) {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _passed.insert(std::make_pair(node, camera));
+    }
+
+}
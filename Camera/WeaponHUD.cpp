@@ -60,6 +60,8 @@ namespace brtr {
         setViewMatrixAsLookAt(Vec3(), Vec3(0,1,0), Z_AXIS);
         getOrCreateStateSet()->setMode(GL_LIGHTING, StateAttribute::OFF | StateAttribute::PROTECTED | StateAttribute::OVERRIDE);
         addChild(celshade);
+
+        _portalGun = createPortalGun();
 	}
 
 	WeaponHUD::~WeaponHUD() {
@@ -70,7 +72,7 @@ namespace brtr {
         return _handler;
     }
 
-    void WeaponHUD::addPortalGun() {
+    ref_ptr<MatrixTransform> WeaponHUD::createPortalGun() {
         ref_ptr<Node> portalGun = osgDB::readNodeFile("../BlenderFiles/exports/Portalgun.ive");
 	/*
 	 * rotating and translating the portal gun to the lower
@@ -90,10 +92,20 @@ namespace brtr {
 	brtr::ModifyMaterialVisitor mmv;
         mmv.setAmbient(Vec4(1.3, 1.3, 1.3, 1)).setShininess(42).setSpecular(Vec4(0.4, 0.4, 0.4, 1));
         portalGun->accept(mmv);
+        return portalGunTransform;
+    }
+
+    void WeaponHUD::addPortalGun() {
+        //loaded with the HUD, so picking it up does not stall
         _switcher->setAllChildrenOff();
-        _switcher->addChild(portalGunTransform, true);
-        
+        if (_switcher->containsNode(_portalGun))
+            _switcher->setChildValue(_portalGun, true);
+        else
+            _switcher->addChild(_portalGun, true);
+    }
 
+    Node* WeaponHUD::getPortalGun() {
+        return _portalGun;
     }
 
 //WEAPON_SWITCH_HANDLER
@@ -0,0 +1,135 @@
+#include "../header/DataVarianceAuditor.h"
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osgViewer/View>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //visits every node (also inactive switch children), hands StateSets and Drawables to the auditor
+        class AuditVisitor : public NodeVisitor {
+        public:
+            AuditVisitor(DataVarianceAuditor& auditor) :
+                NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+                _auditor(auditor) {}
+
+            virtual void apply(Node& node) {
+                _auditor.checkStateSet(node.getStateSet(), getPath());
+                traverse(node);
+            }
+
+            virtual void apply(Geode& geode) {
+                _auditor.checkStateSet(geode.getStateSet(), getPath());
+                for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+                    Drawable* drawable = geode.getDrawable(i);
+                    _auditor.checkStateSet(drawable->getStateSet(), getPath() + "/" + drawable->className());
+                    _auditor.checkDrawable(drawable, getPath() + "/" + drawable->className());
+                }
+            }
+        private:
+            std::string getPath() const {
+                std::string path;
+                for (auto node = _nodePath.begin(); node != _nodePath.end(); ++node)
+                    path += "/" + ((*node)->getName().empty() ? std::string((*node)->className()) : (*node)->getName());
+                return path;
+            }
+            DataVarianceAuditor& _auditor;
+        };
+    }
+
+    DataVarianceAuditor::DataVarianceAuditor() :
+        _numViolations(0) {}
+
+    bool DataVarianceAuditor::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa) {
+        if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME)
+            return false;
+        osgViewer::View* view = dynamic_cast<osgViewer::View*>(aa.asView());
+        if (!view)
+            return false;
+        AuditVisitor av(*this);
+        //the camera itself holds a stateset too
+        view->getCamera()->accept(av);
+        return false;
+    }
+
+    void DataVarianceAuditor::checkStateSet(osg::StateSet* stateSet, const std::string& path) {
+        if (!stateSet)
+            return;
+        auto found = _stateSets.find(stateSet);
+        if (found == _stateSets.end()) {
+            StateSetSnapshot snapshot;
+            //own copies of the attributes, a shared material changed in place would change a shallow copy as well
+            snapshot.copy = new StateSet(*stateSet, CopyOp::DEEP_COPY_STATEATTRIBUTES);
+            snapshot.uniformCounts = getUniformCounts(stateSet);
+            snapshot.flagged = false;
+            _stateSets[stateSet] = snapshot;
+            return;
+        }
+        StateSetSnapshot& snapshot = found->second;
+        if (snapshot.flagged || stateSet->getDataVariance() == Object::DYNAMIC)
+            return;
+        if (snapshot.copy->compare(*stateSet, true) != 0 || snapshot.uniformCounts != getUniformCounts(stateSet)) {
+            snapshot.flagged = true;
+            report("StateSet", stateSet, path);
+        }
+    }
+
+    void DataVarianceAuditor::checkDrawable(osg::Drawable* drawable, const std::string& path) {
+        auto found = _drawables.find(drawable);
+        if (found == _drawables.end()) {
+            DrawableSnapshot snapshot;
+            snapshot.modifiedCounts = getModifiedCounts(drawable);
+            snapshot.bound = drawable->getBound();
+            snapshot.flagged = false;
+            _drawables[drawable] = snapshot;
+            return;
+        }
+        DrawableSnapshot& snapshot = found->second;
+        if (snapshot.flagged || drawable->getDataVariance() == Object::DYNAMIC)
+            return;
+        const BoundingBox& bound = drawable->getBound();
+        if (snapshot.modifiedCounts != getModifiedCounts(drawable)
+            || snapshot.bound._min != bound._min || snapshot.bound._max != bound._max) {
+            snapshot.flagged = true;
+            report("Drawable", drawable, path);
+        }
+    }
+
+    std::vector<unsigned int> DataVarianceAuditor::getUniformCounts(const osg::StateSet* stateSet) const {
+        std::vector<unsigned int> counts;
+        const StateSet::UniformList& uniforms = stateSet->getUniformList();
+        for (auto uniform = uniforms.begin(); uniform != uniforms.end(); ++uniform)
+            counts.push_back(uniform->second.first->getModifiedCount());
+        return counts;
+    }
+
+    std::vector<unsigned int> DataVarianceAuditor::getModifiedCounts(const osg::Drawable* drawable) const {
+        std::vector<unsigned int> counts;
+        const Geometry* geometry = drawable->asGeometry();
+        if (!geometry)
+            return counts;
+        const Array* arrays[] = { geometry->getVertexArray(), geometry->getNormalArray(), geometry->getColorArray() };
+        for (unsigned int i = 0; i < 3; ++i)
+            counts.push_back(arrays[i] ? arrays[i]->getModifiedCount() : 0);
+        for (unsigned int i = 0; i < geometry->getNumTexCoordArrays(); ++i)
+            counts.push_back(geometry->getTexCoordArray(i) ? geometry->getTexCoordArray(i)->getModifiedCount() : 0);
+        for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); ++i)
+            counts.push_back(geometry->getPrimitiveSet(i)->getModifiedCount());
+        return counts;
+    }
+
+    void DataVarianceAuditor::report(const char* type, const osg::Object* object, const std::string& path) {
+        _numViolations++;
+        OSG_ALWAYS << "DataVarianceAuditor: " << type << " mutated at runtime but not DYNAMIC ("
+            << (object->getDataVariance() == Object::STATIC ? "STATIC" : "UNSPECIFIED") << "): "
+            << path << std::endl;
+    }
+
+    unsigned int DataVarianceAuditor::getNumViolations() const {
+        return _numViolations;
+    }
+
+}
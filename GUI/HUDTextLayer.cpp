@@ -0,0 +1,69 @@
+#include "../header/HUDTextLayer.h"
+#include "../header/UtilFunctions.h"
+
+using namespace osg;
+
+namespace brtr {
+
+    HUDTextLayer::HUDTextLayer(int width, int height) {
+        _text = brtr::createText(Vec3d(width / 2.0 - 320, height / 2.0 - 110, 0), "", width * 0.02);
+        addDrawable(_text);
+        setDataVariance(Object::DYNAMIC);
+        setNodeMask(0);
+    }
+
+    HUDTextLayer* HUDTextLayer::getOrCreate(Camera* hudCam, int width, int height) {
+        for (unsigned int i = 0; i < hudCam->getNumChildren(); ++i) {
+            HUDTextLayer* layer = dynamic_cast<HUDTextLayer*>(hudCam->getChild(i));
+            if (layer)
+                return layer;
+        }
+        ref_ptr<HUDTextLayer> layer = new HUDTextLayer(width, height);
+        hudCam->addChild(layer);
+        return layer.get();
+    }
+
+    void HUDTextLayer::setMessage(const void* owner, const std::string& message) {
+        for (auto entry = _messages.begin(); entry != _messages.end(); ++entry) {
+            if (entry->first == owner) {
+                entry->second = message;
+                update();
+                return;
+            }
+        }
+        _messages.push_back(std::make_pair(owner, message));
+        update();
+    }
+
+    void HUDTextLayer::clearMessage(const void* owner) {
+        for (auto entry = _messages.begin(); entry != _messages.end(); ++entry) {
+            if (entry->first == owner) {
+                _messages.erase(entry);
+                update();
+                return;
+            }
+        }
+    }
+
+    bool HUDTextLayer::isEmpty() const {
+        return _shown.empty();
+    }
+
+    void HUDTextLayer::update() {
+        std::string joined;
+        for (auto entry = _messages.begin(); entry != _messages.end(); ++entry) {
+            if (entry->second.empty())
+                continue;
+            if (!joined.empty())
+                joined += "\n";
+            joined += entry->second;
+        }
+        //setText rebuilds the glyph quads, only do it for real changes
+        if (joined == _shown)
+            return;
+        _shown = joined;
+        _text->setText(_shown);
+        setNodeMask(_shown.empty() ? 0 : ~0);
+    }
+
+}
@@ -3,16 +3,24 @@
 #include <osgUtil/CullVisitor>
 #include <osgUtil/LineSegmentIntersector>
 #include <osg/ValueObject>
+#include <osg/Viewport>
 
 namespace brtr {
-    KeyHandler::KeyHandler(osg::Node* rootNode, osg::Camera* postProcessCam, std::vector<osg::ref_ptr<osg::Program>> programs) :
+    KeyHandler::KeyHandler(osg::Node* rootNode, osg::Camera* postProcessCam, std::vector<osg::ref_ptr<osg::Program>> programs, CelShading* toonEffect,
+                           DebugView* debugView) :
         _programs(programs),
         _postProcessCam(postProcessCam),
+        _toonEffect(toonEffect),
+        _debugView(debugView),
         _rootNode(rootNode),
         _isWireFrame(false),
-        _curProg(0){
+        _curProg(0),
+        _pickTicket(0){
         _wireFrameMode = new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::LINE);
         _normaleMode = new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::FILL);
+        //both statesets are changed in the event traversal, the draw thread may still use them
+        _rootNode->getOrCreateStateSet()->setDataVariance(osg::Object::DYNAMIC);
+        _postProcessCam->getOrCreateStateSet()->setDataVariance(osg::Object::DYNAMIC);
     }
 
 
@@ -59,7 +67,24 @@ namespace brtr {
             _isWireFrame = !_isWireFrame;
             return true;
         }//case KEY_C
+        case osgGA::GUIEventAdapter::KEY_P: {
+            if (!_toonEffect)
+                return false;
+            _toonEffect->setDepthPrePass(!_toonEffect->getDepthPrePass());
+            OSG_ALWAYS << "Depth pre-pass " << (_toonEffect->getDepthPrePass() ? "on" : "off") << std::endl;
+            return true;
+        }//case KEY_P
+        case osgGA::GUIEventAdapter::KEY_2: {
+            if (ea.getModKeyMask() == osgGA::GUIEventAdapter::MODKEY_LEFT_SHIFT && _debugView) {
+                _debugView->nextMode();
+                return true;
+            }
+            return false;
+        }//case KEY_2
         case osgGA::GUIEventAdapter::KEY_1:{
+            //the debug view has replaced the program, it restores it when switched off
+            if (_debugView && _debugView->getMode() != CelShading::DEBUG_OFF)
+                return false;
             if (ea.getModKeyMask() == osgGA::GUIEventAdapter::MODKEY_LEFT_SHIFT) {
                 _postProcessCam->getOrCreateStateSet()->removeAttribute(_programs[_curProg]);
                 _curProg++;
@@ -79,6 +104,23 @@ namespace brtr {
             return;
 
         osg::Vec3d eyeInWorld = osg::Vec3d() *osg::Matrixd::inverse(camera->getViewMatrix());
+        if (_rayQueries.valid()) {
+            //the ray of the last frame, the new one is resolved until the next frame
+            RayQueryService::Hit hit;
+            bool resolved = _rayQueries->getResult(_pickTicket, hit);
+            //the distance is measured from the eye the ray was cast from, not from the moved one
+            if (resolved && hit.valid)
+                pick((_pickEye - hit.point).length(), hit.drawable.get());
+            if (camera->getViewport()) {
+                osg::Matrixd windowToWorld = osg::Matrixd::inverse(camera->getViewMatrix() * camera->getProjectionMatrix()
+                                                                   * camera->getViewport()->computeWindowMatrix());
+                osg::Vec3d nearPoint = osg::Vec3d(_mouseEvent->getX(), _mouseEvent->getY(), 0.0) * windowToWorld;
+                osg::Vec3d farPoint = osg::Vec3d(_mouseEvent->getX(), _mouseEvent->getY(), 1.0) * windowToWorld;
+                _pickTicket = _rayQueries->submit(RayQueryService::Ray(nearPoint, farPoint, interactionMask));
+                _pickEye = eyeInWorld;
+            }
+            return;
+        }
         osg::ref_ptr<osgUtil::LineSegmentIntersector> lIntersector =
             new osgUtil::LineSegmentIntersector(osgUtil::Intersector::WINDOW, _mouseEvent->getX(), _mouseEvent->getY());
         lIntersector->setIntersectionLimit(osgUtil::Intersector::LIMIT_NEAREST);
@@ -87,17 +129,25 @@ namespace brtr {
         camera->accept(iv);
         if (lIntersector->containsIntersections()) {
             auto intersection = lIntersector->getIntersections().begin();           
-            double curDistance = (eyeInWorld - intersection->getWorldIntersectPoint()).length();
-            if (curDistance < 4.5 ) {
-                _curDrawable = intersection->drawable;
-                modifyText(true);
-            }//if (curDistance < distance)
-            else {//not the right distance, remove Text & drawable, if any were present
-                modifyText(false);
-            }//else
+            pick((eyeInWorld - intersection->getWorldIntersectPoint()).length(), intersection->drawable.get());
         }//if (intersector->containsIntersections()
     }//intersect()
 
+    void KeyHandler::pick(double distance, osg::Drawable* drawable) {
+        if (distance < 4.5 ) {
+            _curDrawable = drawable;
+            modifyText(true);
+        }//if (curDistance < distance)
+        else {//not the right distance, remove Text & drawable, if any were present
+            modifyText(false);
+        }//else
+    }//pick()
+
+    KeyHandler& KeyHandler::setRayQueryService(RayQueryService* val) {
+        _rayQueries = val;
+        return *this;
+    }
+
     brtr::BaseInteractionCallback* KeyHandler::modifyText(bool show) {
         brtr::BaseInteractionCallback* callback =nullptr;
         if (_curDrawable) {
@@ -4,6 +4,9 @@
 #include <osg/BlendFunc>
 #include <osg/ValueObject>
 #include <osgUtil/Optimizer>
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osg/ComputeBoundsVisitor>
 #include <string>
 #include <sstream>
 #include <iostream>
@@ -23,6 +26,23 @@
 #include "../header/AddInteractionCallbackToDrawableVisitor.h"
 #include "../header/ControlRoom.h"
 #include "../header/TrainSwitcherCallback.h"
+#include "../header/ReleaseCPUDataVisitor.h"
+#include "../header/CollisionProxyBuilder.h"
+#include "../header/DataVarianceAuditor.h"
+#include "../header/DynamicResolutionHandler.h"
+#include "../header/Config.h"
+#include "../header/StateSharingVisitor.h"
+#include "../header/VertexCacheVisitor.h"
+#include "../header/VertexCompressionVisitor.h"
+#include "../header/LODBuilder.h"
+#include "../header/ZoneManager.h"
+#include "../header/OcclusionCuller.h"
+#include "../header/CoreProfileVisitor.h"
+#include "../header/StaticBatchBuilder.h"
+#include "../header/TextureCookVisitor.h"
+#include "../header/ScenePrecompiler.h"
+#include "../header/JobSystem.h"
+#include "../header/RayQueryService.h"
 
 /**
 * @file
@@ -31,83 +51,216 @@
 
 using namespace osg;
 
-int main(void){
+int main(int argc, char** argv){
     //some vars
     osg::setNotifyLevel(FATAL);
+    osg::ArgumentParser arguments(&argc, argv);
+    //startup options from ../braintrain.cfg and the command line, see Config
+    brtr::Config config;
+    if (!config.read(arguments))
+        return EXIT_FAILURE;
+    //before any program is created
+    if (config.glCore) {
+        brtr::setCoreShaders(true);
+        brtr::CoreProfileVisitor::requestContext();
+    }
     Vec3f fogColor(.3219, 0.37, 0.3564);
-    unsigned int width, height;
+    unsigned int width = config.width, height = config.height;
     unsigned int oldWidth, oldHeight;
-    int screen = 0;  //for easy multimonitor switching while debugging
+    int screen = config.screen;  //for easy multimonitor switching while debugging
     std::string inputLine = "";
     int choose = 0;
-    std::vector<ref_ptr<Texture2D>> toonTexs;
-    toonTexs.push_back(brtr::createToonTex("2d_toons_brown.png"));
-    toonTexs.push_back(brtr::createToonTex("2d_toons_blue.png"));
-    toonTexs.push_back(brtr::createToonTex("2d_toons_red.png"));
-    toonTexs.push_back(brtr::createToonTex("2d_toons_violet.png"));
-    toonTexs.push_back(brtr::createToonTex("2d_toons_yellow.png"));
+    //all ramps in one texture array, switching only changes the toonIndex uniform
+    const char* toonTexNames[] = { "2d_toons_brown.png", "2d_toons_blue.png", "2d_toons_red.png", "2d_toons_violet.png",
+        "2d_toons_yellow.png", "2d_toons_darkbrown.png", "2d_toons_darkblue.png", "2d_toons_darkred.png",
+        "2d_toons_darkviolet.png", "2d_toons_darkyellow.png", "2d_toons_darkgreen.png",
+        "2d_toons_brown_hard.png", "2d_toons_blue_hard.png", "2d_toons_red_hard.png", "2d_toons_violet_hard.png",
+        "2d_toons_yellow_hard.png", "2d_toons_darkbrown_hard.png", "2d_toons_darkblue_hard.png", "2d_toons_darkred_hard.png",
+        "2d_toons_darkviolet_hard.png", "2d_toons_darkyellow_hard.png", "2d_-toons_darkgreen_hard.png" };
+    ref_ptr<Texture2DArray> toonTexs = brtr::createToonTexArray(
+        std::vector<std::string>(toonTexNames, toonTexNames + sizeof(toonTexNames) / sizeof(toonTexNames[0])));
     ref_ptr<GraphicsContext::WindowingSystemInterface> wsi = GraphicsContext::getWindowingSystemInterface();
 
-    OSG_ALWAYS << "Please choose the desired Display Resolution:" << std::endl;
-    OSG_ALWAYS << "\t(1): Full HD 1920x1080 (only with a decent Graphic Card!)" << std::endl;
-    OSG_ALWAYS << "\t(2): HD+ 1366x768 (should work with most Cards)" << std::endl;
-    OSG_ALWAYS << "\t(3): HD 1280x720 (choose this for best performance, but worst quality)" <<std::endl;
-    OSG_ALWAYS << "\t(4): Use Screen Resolution" <<std::endl; 
-    OSG_ALWAYS << "\t(5): quit the program without experiencing the forsaken station =(" << std::endl;
-    std::getline(std::cin, inputLine);
-    std::stringstream(inputLine) >> choose;
-    while (!(choose == 1 || choose == 2 || choose == 3 || choose == 4 || choose == 5)) {
-        OSG_ALWAYS << "Only (1), (2), (3), (4) or (5) are valid options!" <<std::endl;
-        OSG_ALWAYS << choose << std::endl;
+    if (config.useScreenResolution)
+        wsi->getScreenResolution(GraphicsContext::ScreenIdentifier(screen), width, height);
+    else if (!config.hasResolution()) {
+        OSG_ALWAYS << "Please choose the desired Display Resolution:" << std::endl;
+        OSG_ALWAYS << "\t(1): Full HD 1920x1080 (only with a decent Graphic Card!)" << std::endl;
+        OSG_ALWAYS << "\t(2): HD+ 1366x768 (should work with most Cards)" << std::endl;
+        OSG_ALWAYS << "\t(3): HD 1280x720 (choose this for best performance, but worst quality)" <<std::endl;
+        OSG_ALWAYS << "\t(4): Use Screen Resolution" <<std::endl; 
+        OSG_ALWAYS << "\t(5): quit the program without experiencing the forsaken station =(" << std::endl;
         std::getline(std::cin, inputLine);
         std::stringstream(inputLine) >> choose;
-    } 
-    switch (choose) {
-    case 1:
-        width = 1920;
-        height = 1080;
-        break;
-    case 2:
-        width = 1366;
-        height = 768;
-        break;
-    case 3:
-        width = 1280;
-        height = 720;
-        break;
-    case 4:
-        wsi->getScreenResolution(GraphicsContext::ScreenIdentifier(screen), width, height);
-        break;
-    case 5:
-        return EXIT_SUCCESS;
+        while (!(choose == 1 || choose == 2 || choose == 3 || choose == 4 || choose == 5)) {
+            OSG_ALWAYS << "Only (1), (2), (3), (4) or (5) are valid options!" <<std::endl;
+            OSG_ALWAYS << choose << std::endl;
+            std::getline(std::cin, inputLine);
+            std::stringstream(inputLine) >> choose;
+        } 
+        switch (choose) {
+        case 1:
+            width = 1920;
+            height = 1080;
+            break;
+        case 2:
+            width = 1366;
+            height = 768;
+            break;
+        case 3:
+            width = 1280;
+            height = 720;
+            break;
+        case 4:
+            wsi->getScreenResolution(GraphicsContext::ScreenIdentifier(screen), width, height);
+            break;
+        case 5:
+            return EXIT_SUCCESS;
+        }
     }
-      
-    
+
     OSG_ALWAYS << "Setting some options which should help with performance (but probably do not)" << std::endl;
     //this viewer will display our graph
     osgViewer::Viewer viewer;
+    viewer.setThreadingModel(config.threadingModel);
+    if (config.glCore)
+        viewer.setRealizeOperation(brtr::CoreProfileVisitor::createRealizeOperation());
     //Faster Intersection, hell yeah!
     osgDB::Registry::instance()->setBuildKdTreesHint(osgDB::Options::BUILD_KDTREES);
+    //image files are replaced by their cooked .dds before they are decoded
+    ref_ptr<brtr::CookedImageReadCallback> cookedImages = new brtr::CookedImageReadCallback;
+    osgDB::Registry::instance()->setReadFileCallback(cookedImages);
     //Get/Set Screen Resolution 
-    wsi->getScreenResolution(GraphicsContext::ScreenIdentifier(screen), oldWidth, oldHeight);
     OSG_ALWAYS << "This DisplaySettings will be used:" << std::endl;
     OSG_ALWAYS << width << "x" << height << std::endl;
-    wsi->setScreenResolution(GraphicsContext::ScreenIdentifier(screen), width, height);
-    //to make sure, we are using the right resolution, even if the set fails
-    wsi->getScreenResolution(GraphicsContext::ScreenIdentifier(screen), width, height);
+    if (config.changeDesktopMode) {
+        wsi->getScreenResolution(GraphicsContext::ScreenIdentifier(screen), oldWidth, oldHeight);
+        wsi->setScreenResolution(GraphicsContext::ScreenIdentifier(screen), width, height);
+        //to make sure, we are using the right resolution, even if the set fails
+        wsi->getScreenResolution(GraphicsContext::ScreenIdentifier(screen), width, height);
+    }
 
-    //Read IVEs, set Masks
+    //the models and procedural props do not depend on each other, they are built concurrently by the JobSystem,
+    //the graph is put together on the main thread afterwards
+    brtr::JobSystem& jobs = brtr::JobSystem::instance();
+    Timer_t assemblyStart = Timer::instance()->tick();
+    std::vector<ref_ptr<brtr::Job>> buildJobs;
     OSG_ALWAYS << "Reading IVE's, making cookies." << std::endl;
-    ref_ptr<Node> trainStation = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain6_1p25E_Lights.ive");
-    trainStation->setNodeMask(brtr::collisionMask);
-    ref_ptr<Node> trainStationHitbox = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain6_1p25E_Lights_Hitbox.osgt");
-    trainStationHitbox->setNodeMask(brtr::collisionMask);
-    ref_ptr<Node> bottleEmitter = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain_BottleParticles.osgt");
-    bottleEmitter->setNodeMask(~brtr::interactionAndCollisionMask);
-    ref_ptr<Node> drinkablebottleEmitter = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain_BottleParticlesDrinkable.osgt");
-    drinkablebottleEmitter->setNodeMask(brtr::interactionMask);
-    ref_ptr<Node> trainModel = osgDB::readNodeFile("../BlenderFiles/exports/Train.ive.0,0,-48.rot");
-    ref_ptr<Node> portalGunTrain = osgDB::readNodeFile("../BlenderFiles/exports/Portalgun_Big.ive.0,0,-48.rot");
+    ref_ptr<Node> trainStation, trainStationHitbox, bottleEmitter, drinkablebottleEmitter, trainModel, portalGunTrain;
+    ref_ptr<Node> ponyFlagSourceNode, portalGunSource;
+    //simplified levels for the heavy models, the far end of the station does not need full detail
+    //one builder per job, they count the simplified triangles
+    brtr::LODBuilder lodBuilders[3];
+    for (unsigned int i = 0; i < 3; ++i)
+        lodBuilders[i].addLevel(0.4f, 400.0f).addLevel(0.1f, 100.0f);
+    buildJobs.push_back(jobs.submit([&]() {
+        trainStation = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain6_1p25E_Lights.ive");
+        trainStation->setNodeMask(brtr::collisionMask);
+    }));
+    buildJobs.push_back(jobs.submit([&]() {
+        trainStationHitbox = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain6_1p25E_Lights_Hitbox.osgt");
+        trainStationHitbox->setNodeMask(brtr::collisionMask);
+    }));
+    ref_ptr<brtr::Job> bottleEmitterJob = jobs.submit([&]() {
+        bottleEmitter = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain_BottleParticles.osgt");
+        bottleEmitter->setNodeMask(~brtr::interactionAndCollisionMask);
+    });
+    ref_ptr<brtr::Job> drinkablebottleEmitterJob = jobs.submit([&]() {
+        drinkablebottleEmitter = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain_BottleParticlesDrinkable.osgt");
+        drinkablebottleEmitter->setNodeMask(brtr::interactionMask);
+    });
+    buildJobs.push_back(jobs.submit([&]() {
+        trainModel = lodBuilders[0].build(osgDB::readNodeFile("../BlenderFiles/exports/Train.ive.0,0,-48.rot"));
+    }));
+    buildJobs.push_back(jobs.submit([&]() {
+        portalGunTrain = lodBuilders[1].build(osgDB::readNodeFile("../BlenderFiles/exports/Portalgun_Big.ive.0,0,-48.rot"));
+    }));
+    buildJobs.push_back(jobs.submit([&]() {
+        //the zAnimation works on the simplified levels just as well
+        ponyFlagSourceNode = lodBuilders[2].build(osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain_Flag.ive"));
+    }));
+    buildJobs.push_back(jobs.submit([&]() {
+        portalGunSource = osgDB::readNodeFile("../BlenderFiles/exports/Portalgun.ive");
+    }));
+
+    ref_ptr<PositionAttitudeTransform> vase;
+    buildJobs.push_back(jobs.submit([&]() {
+        //vase on top of the ticketcorner
+        vase = brtr::createVaseWithFlower();
+        vase->setPosition(Vec3(-27.9, 17.4, 9.7));
+    }));
+
+    OSG_ALWAYS << "Placing bottles (and making some them drinkable)" << std::endl;
+    OSG_ALWAYS << "Do not drink and drive" << std::endl;
+    OSG_ALWAYS << "Actually, this drink is bad, so do not drink it at all." << std::endl;
+    //Create and make alpha Bottle
+    ref_ptr<Geometry> bottle;
+    ref_ptr<brtr::Job> placeBottles = new brtr::Job([&]() {
+        bottle = brtr::createRealBottle();
+        brtr::GeometryPlacerVisitor bottlePlacer(bottle);
+        bottleEmitter->accept(bottlePlacer);
+    });
+    placeBottles->dependsOn(bottleEmitterJob);
+    buildJobs.push_back(jobs.submit(placeBottles));
+    //Drinkable bottles
+    ref_ptr<Geometry> drinkablebottle;
+    ref_ptr<brtr::Job> placeDrinkableBottles = new brtr::Job([&]() {
+        drinkablebottle = brtr::createRealBottle();
+        brtr::GeometryPlacerVisitor drinkablebottlePlacer(drinkablebottle);
+        drinkablebottleEmitter->accept(drinkablebottlePlacer);
+    });
+    placeDrinkableBottles->dependsOn(drinkablebottleEmitterJob);
+    buildJobs.push_back(jobs.submit(placeDrinkableBottles));
+
+    //Placing Benches
+    OSG_ALWAYS << "Placing (uncomfortable) benches." << std::endl;
+    OSG_ALWAYS << "Lying, they are great!" << std::endl;
+    OSG_ALWAYS << "Na, that was a lie." << std::endl;
+    ref_ptr<PositionAttitudeTransform> leftBench, rightBench;
+    buildJobs.push_back(jobs.submit([&]() {
+        leftBench = new brtr::Bench(Vec3(49.5, -2.3, -0.6), 8);
+        leftBench->setAttitude(Quat(DegreesToRadians(167.0), Z_AXIS));
+        leftBench->setNodeMask(brtr::collisionMask);
+    }));
+    buildJobs.push_back(jobs.submit([&]() {
+        rightBench = new brtr::Bench(Vec3(-50, 14.3, -0.6), 14);
+        rightBench->setAttitude(Quat(DegreesToRadians(192.7), Z_AXIS));
+        rightBench->setNodeMask(brtr::collisionMask);
+    }));
+
+    OSG_ALWAYS << "Creating Lights. Nobody wants a creepy, dark station." << std::endl;
+    OSG_ALWAYS << "Except for the creators." << std::endl;
+    ref_ptr<LightSource> light1, light2, light3, light4, staircaseLight;
+    buildJobs.push_back(jobs.submit([&]() {
+        light1 = brtr::createLight(Vec3(-76.88403, -8.27441, 20.63965), 1);
+        light2 = brtr::createLight(Vec3(-26.8972, 1.97552, 20.02043), 2);
+        light3 = brtr::createLight(Vec3(24.33239, 2.49185, 21.58063), 3);
+        light4 = brtr::createLight(Vec3(74.73347, -8.83866, 21.33362), 4);
+        staircaseLight = brtr::createLight(Vec3(0, 110, 38), 5);
+        staircaseLight->getLight()->setQuadraticAttenuation(0.005);
+    }));
+
+    //HUD Cams
+    ref_ptr<brtr::WeaponHUD> weaponHUD;
+    buildJobs.push_back(jobs.submit([&]() {
+        weaponHUD = new brtr::WeaponHUD;
+    }));
+    ref_ptr<Geode> crosshair;
+    buildJobs.push_back(jobs.submit([&]() {
+        crosshair = brtr::createCrosshair(width, height);
+    }));
+
+    //the main thread helps until everything is built
+    for (auto job = buildJobs.begin(); job != buildJobs.end(); ++job)
+        jobs.wait(job->get());
+    OSG_ALWAYS << "Built the models and props in " << Timer::instance()->delta_s(assemblyStart, Timer::instance()->tick())
+        << " s with " << jobs.getNumWorkers() << " workers." << std::endl;
+    OSG_ALWAYS << "Inserted " << lodBuilders[0].getNumLODs() + lodBuilders[1].getNumLODs() + lodBuilders[2].getNumLODs()
+        << " LODs, simplified " << lodBuilders[0].getSimplifier().getNumTrianglesBefore() + lodBuilders[1].getSimplifier().getNumTrianglesBefore()
+            + lodBuilders[2].getSimplifier().getNumTrianglesBefore()
+        << " to " << lodBuilders[0].getSimplifier().getNumTrianglesAfter() + lodBuilders[1].getSimplifier().getNumTrianglesAfter()
+            + lodBuilders[2].getSimplifier().getNumTrianglesAfter() << " triangles." << std::endl;
+
     //Position "Trains" 
     ref_ptr<PositionAttitudeTransform> trainPosition = new PositionAttitudeTransform;
     trainPosition->setNodeMask(brtr::collisionMask);
@@ -133,29 +286,14 @@ int main(void){
     train->addChild(portalGuntrainPosition, false);
     train->addUpdateCallback(new brtr::TrainSwitcherCallback);
 
-    ref_ptr<Node> ponyFlagSourceNode = osgDB::readNodeFile("../BlenderFiles/exports/BrainTrain_Flag.ive");
     ref_ptr<brtr::CelShading> ponyFlag = new brtr::CelShading(false);
     ponyFlag->addChild(ponyFlagSourceNode);
     //let the flag move!
     ponyFlag->getOrCreateStateSet()->addUniform(new Uniform("zAnimation",true), StateAttribute::ON | StateAttribute::OVERRIDE);
-    ref_ptr<Node> portalGunSource = osgDB::readNodeFile("../BlenderFiles/exports/Portalgun.ive");
     ref_ptr<PositionAttitudeTransform> portalGunPlacer = new PositionAttitudeTransform;
     portalGunPlacer->addChild(portalGunSource);
     portalGunPlacer->setPosition(Vec3(-76.54, 5.28, 3.82));
-    //vase on top of the ticketcorner
-    ref_ptr<PositionAttitudeTransform> vase = brtr::createVaseWithFlower();
-    vase->setPosition(Vec3(-27.9, 17.4, 9.7));
-    
-    OSG_ALWAYS << "Placing bottles (and making some them drinkable)" << std::endl;
-    OSG_ALWAYS << "Do not drink and drive" << std::endl;
-    OSG_ALWAYS << "Actually, this drink is bad, so do not drink it at all." << std::endl;
-    //Create and make alpha Bottle
 
-    ref_ptr<Geometry> bottle = brtr::createRealBottle();
-    
-    //Drinkable bottles
-    ref_ptr<Geometry> drinkablebottle = brtr::createRealBottle();
-   
     //drunk one bottle, disable all! It's a Feature, not a bug ;)
     ref_ptr<Switch> drinableBottleSwitch = new Switch;
     drinableBottleSwitch->addChild(drinkablebottleEmitter, true);
@@ -166,26 +304,6 @@ int main(void){
     portalGunSwitch->addChild(portalGunPlacer, true);
     portalGunSwitch->setNodeMask(brtr::interactionMask);
 
-    //place bottle
-    brtr::GeometryPlacerVisitor bottlePlacer(bottle);
-    bottleEmitter->accept(bottlePlacer);
-    //place drinkablebottle
-    brtr::GeometryPlacerVisitor drinkablebottlePlacer(drinkablebottle);
-    drinkablebottleEmitter->accept(drinkablebottlePlacer);
-
-    //Placing Benches
-    OSG_ALWAYS << "Placing (uncomfortable) benches." << std::endl;
-    OSG_ALWAYS << "Lying, they are great!" << std::endl;
-    OSG_ALWAYS << "Na, that was a lie." << std::endl;
-
-	ref_ptr<PositionAttitudeTransform> leftBench = new brtr::Bench(Vec3(49.5, -2.3, -0.6), 8);
-    leftBench->setAttitude(Quat(DegreesToRadians(167.0), Z_AXIS));
-    leftBench->setNodeMask(brtr::collisionMask);
-
-	ref_ptr<PositionAttitudeTransform> rightBench = new brtr::Bench(Vec3(-50, 14.3, -0.6), 14);
-    rightBench->setAttitude(Quat(DegreesToRadians(192.7), Z_AXIS));
-    rightBench->setNodeMask(brtr::collisionMask);
-
     //a group for the whole station
     //needed for the createPipeLine Function
     ref_ptr<Group> rootForToon = new Group;
@@ -201,16 +319,6 @@ int main(void){
     rootForToon->setDataVariance(Object::STATIC);
 
 
-    OSG_ALWAYS << "Creating Lights. Nobody wants a creepy, dark station." << std::endl;
-    OSG_ALWAYS << "Except for the creators." << std::endl;
-    ref_ptr<LightSource> light1 = brtr::createLight(Vec3(-76.88403, -8.27441, 20.63965), 1);
-    ref_ptr<LightSource> light2 = brtr::createLight(Vec3(-26.8972, 1.97552, 20.02043), 2);
-    ref_ptr<LightSource> light3 = brtr::createLight(Vec3(24.33239, 2.49185, 21.58063), 3);
-    ref_ptr<LightSource> light4 = brtr::createLight(Vec3(74.73347, -8.83866, 21.33362), 4);
-    ref_ptr<LightSource> staircaseLight = brtr::createLight(Vec3(0, 110, 38), 5);
-    staircaseLight->getLight()->setQuadraticAttenuation(0.005);
-
-
     rootForToon->addChild(light1);
     rootForToon->addChild(light2);
     rootForToon->addChild(light3);
@@ -220,14 +328,29 @@ int main(void){
 
     OSG_ALWAYS << "Creating RenderingPipeline. ToonyLoony!" << std::endl;
     brtr::RenderingPipeline pipe;
-    brtr::createRenderingPipeline(width, height, *rootForToon, viewer, pipe,fogColor);
+    brtr::createRenderingPipeline(width, height, *rootForToon, viewer, pipe, fogColor, config.outlines, config.samples, config.postProgram, config.depthPrePass);
 
 
-    //HUD Cams
-    ref_ptr<brtr::WeaponHUD> weaponHUD = new brtr::WeaponHUD;
     ref_ptr<Camera> textHUD = brtr::createHUDCamera(0, width, 0, height);
-    textHUD->addChild(brtr::createCrosshair(width, height));
+    textHUD->addChild(crosshair);
     textHUD->getOrCreateStateSet()->setTextureMode(1, GL_TEXTURE_2D, StateAttribute::OFF);
+    if (config.glCore) {
+        //osgText, the crosshair and the station hitbox (drawn by the main camera) have no core programs
+        brtr::CoreProfileVisitor::useFixedFunction(*textHUD);
+        brtr::CoreProfileVisitor::useFixedFunction(*viewer.getCamera());
+    }
+
+    //the root node, which holds the cams (pass and HUDs) as siblings
+    ref_ptr<Group> sceneData = new Group;
+    //Control Room, the chess figures are built while the main thread finishes the station
+    ref_ptr<brtr::ToonTexSwitcherCallback> toonCallback = new brtr::ToonTexSwitcherCallback(sceneData, textHUD, width, height, toonTexs->getTextureDepth());
+    ref_ptr<brtr::ProgramSwitcherCallback> programCallback = new brtr::ProgramSwitcherCallback(pipe.pass_PostProcess, textHUD, width, height, pipe.programs);
+    ref_ptr<brtr::ControlRoom> controlRoom;
+    ref_ptr<brtr::Job> controlRoomJob = jobs.submit([&]() {
+        controlRoom = new brtr::ControlRoom(40, 50, *toonCallback, *programCallback);
+        controlRoom->setPosition(Vec3(0, 170.3, 23.2));
+    });
+
     //making bottles drinkable
     drinkablebottle->getOrCreateUserDataContainer()->addUserObject(new brtr::DrunkenInteractionCallback(viewer.getCamera(), textHUD, drinableBottleSwitch, width, height));
     ref_ptr<brtr::AddPortalGunInteractionCallback> portalGunCallback = new brtr::AddPortalGunInteractionCallback(weaponHUD, textHUD, portalGunSwitch, width, height);
@@ -242,8 +365,6 @@ int main(void){
     trainPosition->accept(mmv);
     portalGunSource->accept(mmv);
 
-    //the root node, which holds the cams (pass and HUDs) as siblings
-    ref_ptr<Group> sceneData = new Group;
     //add elements to sceneData
     OSG_ALWAYS << "Adding elements to scene root." << std::endl;
     OSG_ALWAYS << "I am soooo excited, we are nearly done!." << std::endl;
@@ -257,13 +378,14 @@ int main(void){
     //sceneData->getOrCreateStateSet()->setMode(GL_LIGHTING, StateAttribute::OFF | StateAttribute::OVERRIDE);
 
     //Set toonTex
-    sceneData->getOrCreateStateSet()->setTextureAttributeAndModes(1, toonTexs[0], osg::StateAttribute::ON);
+    //no mode, GL_TEXTURE_2D_ARRAY is for shaders only
+    sceneData->getOrCreateStateSet()->setTextureAttribute(1, toonTexs, osg::StateAttribute::ON);
 
-    //Control Room
-    ref_ptr<brtr::ToonTexSwitcherCallback> toonCallback = new brtr::ToonTexSwitcherCallback(sceneData, textHUD, width, height, toonTexs);
-    ref_ptr<brtr::ProgramSwitcherCallback> programCallback = new brtr::ProgramSwitcherCallback(pipe.pass_PostProcess, textHUD, width, height, pipe.programs);
-    ref_ptr<brtr::ControlRoom> controlRoom = new brtr::ControlRoom(40, 50, *toonCallback, *programCallback);
-    controlRoom->setPosition(Vec3(0, 170.3, 23.2));
+    jobs.wait(controlRoomJob);
+    //bounds for the zones, before batching and the collision proxies change the subgraphs
+    ComputeBoundsVisitor stationBounds, controlRoomBounds;
+    trainStation->accept(stationBounds);
+    controlRoom->accept(controlRoomBounds);
 
     //Adding "special-treatment nodes" (mainly no outlines) to first pass
     pipe.pass_0_color->addChild(ponyFlag);
@@ -274,32 +396,182 @@ int main(void){
     viewer.setSceneData(sceneData);
     osgUtil::Optimizer optimizer;
     optimizer.optimize(sceneData,osgUtil::Optimizer::STATIC_OBJECT_DETECTION);
+    //strips to cache friendly triangle lists, for the procedural and the loaded geometry
+    brtr::VertexCacheVisitor vcv;
+    sceneData->accept(vcv);
+    OSG_ALWAYS << "Optimized " << vcv.getNumOptimizedGeometries() << " geometries for the vertex cache ("
+        << vcv.getNumSkippedGeometries() << " skipped), ACMR " << vcv.getACMRBefore() << " -> " << vcv.getACMRAfter() << std::endl;
+
+    //simplified collision geometry, so collision costs do not grow with the visual detail
+    brtr::CollisionProxyBuilder proxyBuilder(2.0);
+    proxyBuilder.useBoxFor(leftBench);
+    proxyBuilder.useBoxFor(rightBench);
+    proxyBuilder.build(rootForToon);
+    if (config.staticBatching) {
+        //before the compression, the batches are compressed as a whole
+        brtr::StaticBatchBuilder batchBuilder(100.0f, config.gpuCulling);
+        batchBuilder.build(rootForToon);
+        OSG_ALWAYS << "Batched " << batchBuilder.getNumBatchedDrawables() << " drawables into " << batchBuilder.getNumBatches()
+            << " batches" << (config.gpuCulling ? " (GPU culling)." : ".") << std::endl;
+    }
+    if (config.compressVertices) {
+        //only the cel shaded parts can decode, collision goes through the proxies now
+        std::vector<unsigned int> intersectionMasks;
+        intersectionMasks.push_back(brtr::interactionMask);
+        intersectionMasks.push_back(brtr::collisionProxyMask);
+        brtr::VertexCompressionVisitor vcompv(intersectionMasks);
+        rootForToon->accept(vcompv);
+        ponyFlag->accept(vcompv);
+        controlRoom->accept(vcompv);
+        OSG_ALWAYS << "Compressed " << vcompv.getNumCompressedGeometries() << " geometries (" << vcompv.getNumQuantizedGeometries()
+            << " with quantized positions), " << vcompv.getBytesBefore() << " -> " << vcompv.getBytesAfter() << " bytes." << std::endl;
+    }
+    if (config.glCore) {
+        //lights and materials as uniform buffers, VBOs instead of display lists
+        brtr::CoreProfileVisitor cpv;
+        sceneData->accept(cpv);
+        cpv.build(*sceneData->getOrCreateStateSet());
+        OSG_ALWAYS << "Core profile: " << cpv.getNumLights() << " lights and " << cpv.getNumMaterials() << " materials in uniform buffers." << std::endl;
+    }
+    //compressed textures with mipmaps, the toon ramps stay as they are
+    brtr::TextureCookVisitor tcv(config.cookTextures);
+    sceneData->accept(tcv);
+    OSG_ALWAYS << "Textures: " << cookedImages->getNumRedirected() + tcv.getNumLoaded() << " cooked loaded, " << tcv.getNumCooked() << " cooked now ("
+        << tcv.getBytesBefore() << " -> " << tcv.getBytesAfter() << " bytes), " << tcv.getNumDriverCompressed()
+        << " compressed by the driver." << std::endl;
+    //equal materials, uniforms and statesets (e.g. one material per bench part) become shared instances
+    brtr::StateSharingVisitor ssv;
+    sceneData->accept(ssv);
+    OSG_ALWAYS << "Shared " << ssv.getNumSharedAttributes() << " attributes and " << ssv.getNumSharedUniforms() << " uniforms, "
+        << ssv.getNumStateSets() << " StateSets reduced to " << ssv.getNumUniqueStateSets() << "." << std::endl;
+    //zones and portals, standing on the platform never pays for the control room
+    ref_ptr<brtr::ZoneManager> zones = new brtr::ZoneManager(viewer.getCamera());
+    //the station is split at the staircase entrance, the staircase ends at the fakewall of the control room
+    const float staircaseEntrance = 60.0f;
+    const BoundingBox& station = stationBounds.getBoundingBox();
+    const BoundingBox& room = controlRoomBounds.getBoundingBox();
+    unsigned int hallZone = zones->addZone("hall",
+        BoundingBox(station.xMin(), station.yMin(), station.zMin(), station.xMax(), staircaseEntrance, station.zMax()));
+    unsigned int staircaseZone = zones->addZone("staircase",
+        BoundingBox(station.xMin(), staircaseEntrance, station.zMin(), station.xMax(), minimum(station.yMax(), room.yMin()), station.zMax()));
+    unsigned int controlRoomZone = zones->addZone("control room", room);
+    zones->addPortal(hallZone, staircaseZone, BoundingBox(-25, staircaseEntrance - 2, -10, 25, staircaseEntrance + 2, 60));
+    //the fakewall of the control room
+    zones->addPortal(staircaseZone, controlRoomZone,
+        BoundingBox(room.xMin() + 0.5f, room.yMin() - 0.5f, room.zMin() + 0.5f, room.xMax() - 0.5f, room.yMin() + 0.5f, room.zMax() - 0.5f));
+    zones->assign(controlRoom.get(), controlRoomZone);
+    unsigned int zonedGeodes = zones->assign(rootForToon.get()) + zones->assign(ponyFlag.get());
+    OSG_ALWAYS << "Bound " << zonedGeodes << " geodes and the control room to " << zones->getNumZones() << " zones." << std::endl;
+    //occlusion queries for the heavy parts, which are often hidden by the walls and pillars of the station
+    ref_ptr<brtr::OcclusionCuller> occlusionCuller = new brtr::OcclusionCuller;
+    if (config.occlusionCulling) {
+        occlusionCuller->wrap(train);
+        occlusionCuller->wrap(controlRoom);
+        //benches, bottles, vase... but not the station itself
+        occlusionCuller->wrapHeavyChildren(rootForToon, 1000, 150.0f);
+        OSG_ALWAYS << "Wrapped " << occlusionCuller->getNumWrapped() << " subgraphs in occlusion queries." << std::endl;
+    }
     
 
     //Manipulator and KeyHandler
     OSG_ALWAYS << "Adding Manipulator and KeyHandler. What could possible go wrong?." << std::endl;
-    viewer.setCameraManipulator(new brtr::FPSCameraManipulator(0.25, 7, rootForToon));
-    osg::ref_ptr<brtr::KeyHandler> keyHandler = new brtr::KeyHandler(sceneData, pipe.pass_PostProcess, pipe.programs);
+    ref_ptr<brtr::FPSCameraManipulator> manipulator = new brtr::FPSCameraManipulator(0.25, 7, rootForToon);
+    manipulator->setCollisionMask(brtr::collisionProxyMask);
+    viewer.setCameraManipulator(manipulator);
+    osg::ref_ptr<brtr::KeyHandler> keyHandler = new brtr::KeyHandler(sceneData, pipe.pass_PostProcess, pipe.programs, pipe.toonEffect,
+                                                                          new brtr::DebugView(pipe));
+    //collision and picking rays are resolved by the workers, one frame ahead
+    ref_ptr<brtr::RayQueryService> collisionRays;
+    ref_ptr<brtr::RayQueryService> pickRays;
+    if (config.asyncRays) {
+        collisionRays = new brtr::RayQueryService(rootForToon, brtr::collisionProxyMask);
+        pickRays = new brtr::RayQueryService(sceneData, brtr::interactionMask);
+        manipulator->setRayQueryService(collisionRays);
+        keyHandler->setRayQueryService(pickRays);
+        //before the KeyHandler and the manipulator, which read the results of the FRAME event
+        viewer.addEventHandler(collisionRays);
+        viewer.addEventHandler(pickRays);
+        OSG_ALWAYS << "Ray query snapshots: " << collisionRays->getNumEntries() << " collision geodes ("
+            << collisionRays->getNumDynamicEntries() << " dynamic), " << pickRays->getNumEntries() << " interaction geodes ("
+            << pickRays->getNumDynamicEntries() << " dynamic)." << std::endl;
+    }
     viewer.addEventHandler(weaponHUD->getWeaponHandler());
     viewer.addEventHandler(keyHandler);
+    if (config.occlusionCulling)
+        viewer.addEventHandler(occlusionCuller);
+    if (config.auditDataVariance)
+        viewer.addEventHandler(new brtr::DataVarianceAuditor);
+    if (config.resolutionBudget > 0.0)
+        viewer.addEventHandler(new brtr::DynamicResolutionHandler(pipe, config.resolutionBudget, config.resizeRTTTextures));
+
+    //GL objects are compiled before the render loop, the linked programs are cached
+    ref_ptr<brtr::ProgramBinaryCache> binaryCache = new brtr::ProgramBinaryCache;
+    ref_ptr<brtr::ScenePrecompiler> precompiler;
+    if (config.precompile) {
+        precompiler = new brtr::ScenePrecompiler(viewer, binaryCache);
+        for (unsigned int i = 0; i < sceneData->getNumChildren(); ++i) {
+            Node* child = sceneData->getChild(i);
+            precompiler->add(child, child->getName().empty() ? child->className() : child->getName());
+        }
+        precompiler->add(weaponHUD->getPortalGun(), "portal gun");
+        precompiler->addStateSet(sceneData->getStateSet());
+        viewer.setRealizeOperation(binaryCache->createRealizeOperation(viewer.getRealizeOperation()));
+    }
 
     OSG_ALWAYS << "Potato." << std::endl;
-    OSG_ALWAYS << "Finished! Press Enter to start the fun!" <<std::endl;
- 
-    getchar();
+    if (config.waitForEnter) {
+        OSG_ALWAYS << "Finished! Press Enter to start the fun!" << std::endl;
+        getchar();
+    }
     OSG_ALWAYS << "The cake is a lie." << std::endl;
-    viewer.setUpViewOnSingleScreen(screen);
+    if (config.windowed)
+        viewer.setUpViewInWindow(50, 50, width, height, screen);
+    else
+        viewer.setUpViewOnSingleScreen(screen);
+    viewer.realize();
     osgViewer::GraphicsWindow* window = dynamic_cast<osgViewer::GraphicsWindow*>(viewer.getCamera()->getGraphicsContext());
     if (window) {
         window->useCursor(false);
+        window->setSyncToVBlank(config.vsync);
     }
     else {
         OSG_ALWAYS << "WARNING: COULD NOT HIDE MOUSE CURSOR" << std::endl;
     }
+    if (precompiler.valid()) {
+        unsigned int frames = precompiler->compile();
+        OSG_ALWAYS << "Precompiled the scene in " << frames << " frames, " << binaryCache->getNumLoaded() << " of "
+            << binaryCache->getNumPrograms() << " programs loaded from the binary cache." << std::endl;
+    }
+
+    if (config.releaseCPUData) {
+        //first frame compiles everything, afterwards the cpu side data is not needed anymore
+        viewer.frame();
+        //the draw thread may still compile or draw this frame with the same arrays and images
+        viewer.stopThreading();
+        unsigned int contextID = viewer.getCamera()->getGraphicsContext()->getState()->getContextID();
+        brtr::ReleaseCPUDataVisitor rcdv(contextID);
+        sceneData->accept(rcdv);
+        viewer.startThreading();
+        OSG_ALWAYS << "Released " << rcdv.getReleasedGeometryBytes() / 1024 << " KiB geometry and "
+            << rcdv.getReleasedImageBytes() / 1024 << " KiB image data ("
+            << rcdv.getPendingImageBytes() / 1024 << " KiB more upon first use). "
+            << rcdv.getKeptDrawables() << " drawables kept for collision/interaction." << std::endl;
+    }
 
     while (!viewer.done())
         viewer.frame();
+
+    if (config.asyncRays) {
+        OSG_ALWAYS << "Rays resolved one frame ahead: " << collisionRays->getNumAsyncResults() + pickRays->getNumAsyncResults()
+            << ", synchronously: " << collisionRays->getNumSyncResults() + pickRays->getNumSyncResults() << "." << std::endl;
+    }
+    for (unsigned int i = 0; i <= jobs.getNumWorkers(); ++i) {
+        brtr::JobSystem::WorkerStats stats = jobs.getStats(i);
+        OSG_ALWAYS << (i < jobs.getNumWorkers() ? "Worker " : "Calling threads ") << i << ": " << stats.numJobs << " jobs ("
+            << stats.numStolen << " stolen), " << stats.utilization * 100.0 << "% busy." << std::endl;
+    }
  
-    wsi->setScreenResolution(GraphicsContext::ScreenIdentifier(screen), oldWidth, oldHeight);
+    if (config.changeDesktopMode)
+        wsi->setScreenResolution(GraphicsContext::ScreenIdentifier(screen), oldWidth, oldHeight);
     return EXIT_SUCCESS;
 }
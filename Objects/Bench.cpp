@@ -187,204 +187,117 @@ namespace brtr{
 		side->setTexCoordArray(0, texcoords.get());
 		return side;
 	}
-	ref_ptr<Group> Bench::createLeg(){
-
-		double length = 0.5;
-		double width = length;
-		double height = 4 * length;
-
-		ref_ptr<Group> leg = createCuboid(length, width, height);
-
-		//set Textures
+	ref_ptr<StateSet> Bench::createState(Material* material, const std::string& textureFile){
 		ref_ptr<Texture2D> texture = new Texture2D;
-		ref_ptr<Image> image = osgDB::readImageFile("../BlenderFiles/Texturen/iron.jpg");
+		ref_ptr<Image> image = osgDB::readImageFile(textureFile);
 		texture->setImage(image.get());
 		texture->setWrap(Texture::WRAP_S, Texture::MIRROR);
 		texture->setWrap(Texture::WRAP_T, Texture::MIRROR);
-		osg::ref_ptr<osg::StateSet> legs(leg->getOrCreateStateSet());
-
-		legs->setAttribute(createIronMaterial());
-		legs->setTextureAttributeAndModes(0, texture.get());
 
-		return leg;
+		ref_ptr<StateSet> state = new StateSet;
+		state->setAttribute(material);
+		state->setTextureAttributeAndModes(0, texture.get());
+		return state;
 	}
 
-	ref_ptr<Group> Bench::createSeat(const double width){
-		ref_ptr<Group> seat = new Group;
+	void Bench::createLeg(MeshBuilder& builder){
 
-		double length = width; //ratio of the seat is 1:1
-		double height = 0.1; 
+		double length = 0.5;
+		double width = length;
+		double height = 4 * length;
 
-		ref_ptr<Group> base = createCuboid(length, width, height);
-      
-		 //create the texture
-		ref_ptr<Texture2D> texturewood = new Texture2D;
-		ref_ptr<Image> imagewood = osgDB::readImageFile("../BlenderFiles/Texturen/wood.jpg");		
-		texturewood->setImage(imagewood.get());
-		texturewood->setWrap(Texture::WRAP_S, Texture::MIRROR);
-		texturewood->setWrap(Texture::WRAP_T, Texture::MIRROR);
+		builder.setStateSet(ironState);
+		builder.addCuboid(length, width, height);
+	}
 
+	void Bench::createSeat(MeshBuilder& builder, const double width){
+		MeshBuilder seat;
 
-		
-		base->getChild(0)->getOrCreateStateSet()->setAttribute(createWoodMaterial());
-		base->getChild(0)->getOrCreateStateSet()->setTextureAttributeAndModes(0, texturewood.get()); //Front
+		double length = width; //ratio of the seat is 1:1
+		double height = 0.1; 
 
-		base->getChild(1)->getOrCreateStateSet()->setAttribute(createWoodMaterial());				
-		base->getChild(1)->getOrCreateStateSet()->setTextureAttributeAndModes(0, texturewood.get()); //Back
-		
-		
+		//the whole seat is wood, the narrow sides too
+		seat.setStateSet(woodState);
+		seat.addCuboid(length, width, height);
 		//rotate the base to get the back of the seat
-		ref_ptr<MatrixTransform> seatback = new MatrixTransform();
-		seatback->setMatrix(Matrix::rotate(PI / 2 * 1.1, 1, 0, 0));
-		seatback->addChild(base.get());
-
-		//group the components
-		seat->addChild(base);
-		seat->addChild(seatback);
+		seat.pushTransform(Matrix::rotate(PI / 2 * 1.1, 1, 0, 0));
+		seat.addCuboid(length, width, height);
+		seat.popTransform();
 
 		//change the position
-		ref_ptr<PositionAttitudeTransform> seatpos = new PositionAttitudeTransform;
-		seatpos = wrapInPositionAttitudeTransform(seat,Vec3d(0, -(width - getDimensionOfNode(seat).y()), 0.0));
-
-		return seatpos;
-
+		Vec3 seatsize = seat.getBound()._max - seat.getBound()._min;
+		builder.pushTransform(Matrix::translate(0, -(width - seatsize.y()), 0.0));
+		builder.addMesh(seat);
+		builder.popTransform();
 	}
-	ref_ptr<Group> Bench::createArmrest(double radius, double width, double length, double totalwidth){
-		ref_ptr<Group> armrest = new Group;
-
-		ref_ptr<Group> armrest_arch = new Group;
-		//creates the components for the armrest_arch
-		ref_ptr<Geode> front = new Geode;
-		front->addDrawable(createArmrestSidesFrontBack(radius, width, 10, 10, false));
-		ref_ptr<Geode> back = new Geode;
-		back->addDrawable(createArmrestSidesFrontBack(radius + length, width, 10, 10, true));
-		ref_ptr<Geode> leftside = new Geode;
-		leftside->addDrawable(createArmrestSidesLeftRight(radius, radius + length, 10, 10, true));
-		ref_ptr<Geode> rigthside = new Geode;
-		rigthside->addDrawable(createArmrestSidesLeftRight(radius, radius + length, 10, 10, false));
-
-		ref_ptr<PositionAttitudeTransform> leftsiderotated = new PositionAttitudeTransform;
-		leftsiderotated->setAttitude(Quat(DegreesToRadians(180.0), X_AXIS));
-		leftsiderotated->addChild(leftside);
-		
-		ref_ptr<PositionAttitudeTransform> rigthsiderotated = new PositionAttitudeTransform;
-		rigthsiderotated->setPosition(Vec3d(0, width, 0));
-		rigthsiderotated->addChild(rigthside);
-
-		
-		
-		ref_ptr<Geode> topshape = new Geode;
-		topshape->addDrawable(brtr::createRectangleWithTexcoords(length, width, 20, 20));
-		ref_ptr<PositionAttitudeTransform> top = wrapInPositionAttitudeTransform(topshape,Vec3d(-(radius + length), 0, 0));
-
-
-		ref_ptr <MatrixTransform> bottom = new MatrixTransform;
-		bottom->setMatrix(Matrix::rotate(PI / 2, 0, 1, 0)*Matrix::translate(0, 0, -radius));
-		bottom->addChild(topshape);
 
+	void Bench::createArmrest(MeshBuilder& builder, double radius, double width, double length, double totalwidth){
+		builder.setStateSet(ironState);
 
-		
+		//the armrest_arch
+		builder.pushTransform(Matrix::translate(radius + length, 0, radius + length));
+		builder.addGeometry(*createArmrestSidesFrontBack(radius, width, 10, 10, false));
+		builder.addGeometry(*createArmrestSidesFrontBack(radius + length, width, 10, 10, true));
 
-		armrest_arch->addChild(front);
-		armrest_arch->addChild(back);
-		armrest_arch->addChild(leftsiderotated);
-		armrest_arch->addChild(rigthsiderotated);
-		armrest_arch->addChild(top);
-		armrest_arch->addChild(bottom);
-		
-		//Positioning the armrest_arch
-		armrest_arch = wrapInPositionAttitudeTransform(armrest_arch, Vec3d(radius + length, 0, radius + length));
-		
-		double height = 0.5;
-		ref_ptr<Group> bar_up = brtr::createCuboid(length, width, height);
-		ref_ptr<Group> barontop = brtr::createCuboid(width, totalwidth, width / 2);
-		
-		bar_up = wrapInPositionAttitudeTransform(bar_up, Vec3d(0.0, 0.0, radius + length));
-		barontop = wrapInPositionAttitudeTransform(barontop, Vec3d(-width / 4, -(totalwidth) / 2 + width / 2, radius + length + height));
+		builder.pushTransform(Matrix::rotate(Quat(DegreesToRadians(180.0), X_AXIS)));
+		builder.addGeometry(*createArmrestSidesLeftRight(radius, radius + length, 10, 10, true));
+		builder.popTransform();
 
-		ref_ptr<Group> bars = new Group;
-		bars->addChild(barontop);
-		bars->addChild(bar_up);
+		builder.pushTransform(Matrix::translate(0, width, 0));
+		builder.addGeometry(*createArmrestSidesLeftRight(radius, radius + length, 10, 10, false));
+		builder.popTransform();
 
+		//top and bottom
+		builder.pushTransform(Matrix::translate(-(radius + length), 0, 0));
+		builder.addRectangle(length, width, 20, 20);
+		builder.popTransform();
 
+		builder.pushTransform(Matrix::rotate(PI / 2, 0, 1, 0)*Matrix::translate(0, 0, -radius));
+		builder.addRectangle(length, width, 20, 20);
+		builder.popTransform();
+		builder.popTransform();
 
-		armrest->addChild(armrest_arch);
-		armrest->addChild(bars);
-
-
-		ref_ptr<Texture2D> texture = new Texture2D;
-		ref_ptr<Image> image = osgDB::readImageFile("../BlenderFiles/Texturen/iron.jpg");
-		texture->setImage(image.get());
-		texture->setWrap(Texture::WRAP_S, Texture::MIRROR);
-		texture->setWrap(Texture::WRAP_T, Texture::MIRROR);
-
-		osg::ref_ptr<osg::StateSet> armrest_state(armrest->getOrCreateStateSet());
-
-		armrest_state->setAttribute(createIronMaterial());
-		armrest_state->setTextureAttributeAndModes(0, texture.get());
+		//the bars
+		double height = 0.5;
+		builder.pushTransform(Matrix::translate(0.0, 0.0, radius + length));
+		builder.addCuboid(length, width, height);
+		builder.popTransform();
 
-		return armrest;
+		builder.pushTransform(Matrix::translate(-width / 4, -(totalwidth) / 2 + width / 2, radius + length + height));
+		builder.addCuboid(width, totalwidth, width / 2);
+		builder.popTransform();
 	}
 
 
 
-	ref_ptr<Group> Bench::createBar(){
+	void Bench::createBar(MeshBuilder& builder){
 
 		double width = 0.5;
 		double height = width;
 		double length = (this->length);
 
-
-		ref_ptr<Group> bar = brtr::createCuboid(length, width, height);
-
-
-		//set Textures
-		ref_ptr<Texture2D> texture = new Texture2D;
-		ref_ptr<Image> image =
-			osgDB::readImageFile("../BlenderFiles/Texturen/iron.jpg");
-		texture->setImage(image.get());
-		texture->setWrap(Texture::WRAP_S, Texture::MIRROR);
-		texture->setWrap(Texture::WRAP_T, Texture::MIRROR);
-
-		osg::ref_ptr<osg::StateSet> nodess(bar->getOrCreateStateSet());
-
-
-		nodess->setAttribute(createIronMaterial());
-		nodess->setTextureAttributeAndModes(0, texture.get());
-
-
-		return bar;
+		builder.setStateSet(ironState);
+		builder.addCuboid(length, width, height);
 	}
 
 
 	void Bench::initBench(const double plength){
-		ref_ptr<Group> leg = createLeg();
+		//one stateset per material, so the whole bench needs one draw call per material
+		ironState = createState(createIronMaterial(), "../BlenderFiles/Texturen/iron.jpg");
+		woodState = createState(createWoodMaterial(), "../BlenderFiles/Texturen/wood.jpg");
 
+		MeshBuilder leg;
+		createLeg(leg);
 		double legdistance = 0.05;
 
-		//create the legs
-		ref_ptr<PositionAttitudeTransform> leg1 = new PositionAttitudeTransform;
-		ref_ptr<PositionAttitudeTransform> leg2 = new PositionAttitudeTransform;
-		leg1->addChild(leg.get());
-		leg2->addChild(leg.get());
-
-		ref_ptr<Group> legs = new Group;
-		legs->addChild(leg1.get());
-		legs->addChild(leg2.get());
-
 		//save the dimension
-		Vec3 legssize = getDimensionOfNode(legs);
+		Vec3 legssize = leg.getBound()._max - leg.getBound()._min;
 
 
 		//create the bar
-		ref_ptr<Group> bar = createBar();
-		ref_ptr<PositionAttitudeTransform> bar1 = new PositionAttitudeTransform;
-		bar1->addChild(bar.get());
-		ref_ptr<Group> bars = new Group;
-		ref_ptr<PositionAttitudeTransform> armrest1 = new PositionAttitudeTransform;
-		
-		
-		Vec3 barssize = getDimensionOfNode(bar);
+		MeshBuilder bar;
+		createBar(bar);
+		Vec3 barssize = bar.getBound()._max - bar.getBound()._min;
 
 
 	  
@@ -397,65 +310,58 @@ namespace brtr{
 
 		double radiusarmrest = 0.2;
 
-		ref_ptr<Group> armrest = createArmrest(radiusarmrest, barssize.y() / 2, barssize.z() / 4, seatwidth);
-
-
-
-		armrest1->addChild(armrest);
-		
-		armrest1->setPosition(Vec3d(-(radiusarmrest + barssize.z() / 4), (barssize.y() / 4), (barssize.z() / 2) - (barssize.z() / 8)));
-		
-
-		ref_ptr <MatrixTransform> armrest2 = new MatrixTransform;
-		armrest2->setMatrix(Matrix::translate(-(radiusarmrest + (barssize.z() / 2) / 2), 0, 0)*Matrix::rotate(PI, 0, 0, 1));
-		armrest2->addChild(armrest);
-		
-		ref_ptr<PositionAttitudeTransform> armrest22 = new PositionAttitudeTransform;
-		armrest22->setPosition(Vec3d(barssize.x(), (barssize.y() / 4) + barssize.y() / 2, (barssize.z() / 2) - (barssize.z() / 8)));
-		armrest22->addChild(armrest2);
-
-		bar1->addChild(armrest1);
-		bar1->addChild(armrest22);
-
-		bars->addChild(bar1.get());
-		Vec3 armrestsize = getDimensionOfNode(armrest);
+		MeshBuilder armrest;
+		createArmrest(armrest, radiusarmrest, barssize.y() / 2, barssize.z() / 4, seatwidth);
+		Vec3 armrestsize = armrest.getBound()._max - armrest.getBound()._min;
 
 
 
 
 		//creating the seats
-		ref_ptr<Group> seat = createSeat(seatwidth);
+		MeshBuilder seat;
+		createSeat(seat, seatwidth);
 
-		Vec3 seatsize = getDimensionOfNode(seat);
+		Vec3 seatsize = seat.getBound()._max - seat.getBound()._min;
 		double middle = (seatsize.y() - seatwidth) + (seatwidth / 2) - barssize.y() / 2;
-		//Position the stuff
-		leg1->setPosition(Vec3d(legdistance*plength, middle, 0.0));
-		leg2->setPosition(Vec3d((1 - legdistance)*plength - getDimensionOfNode(leg).x(), middle, 0.0));
-		bar1->setPosition(Vec3d(0, middle, legssize.z()));
+
+		//bundle all components together, the transforms are baked into the vertices
+		MeshBuilder builder(16384, 65536);
+		builder.pushTransform(Matrix::translate(armrestsize.x(), 0, 0));
+
+		//the legs
+		builder.pushTransform(Matrix::translate(legdistance*plength, middle, 0.0));
+		builder.addMesh(leg);
+		builder.popTransform();
+		builder.pushTransform(Matrix::translate((1 - legdistance)*plength - legssize.x(), middle, 0.0));
+		builder.addMesh(leg);
+		builder.popTransform();
+
+		//the bar with both armrests
+		builder.pushTransform(Matrix::translate(0, middle, legssize.z()));
+		builder.addMesh(bar);
+
+		builder.pushTransform(Matrix::translate(-(radiusarmrest + barssize.z() / 4), (barssize.y() / 4), (barssize.z() / 2) - (barssize.z() / 8)));
+		builder.addMesh(armrest);
+		builder.popTransform();
+
+		builder.pushTransform(Matrix::translate(barssize.x(), (barssize.y() / 4) + barssize.y() / 2, (barssize.z() / 2) - (barssize.z() / 8)));
+		builder.pushTransform(Matrix::translate(-(radiusarmrest + (barssize.z() / 2) / 2), 0, 0)*Matrix::rotate(PI, 0, 0, 1));
+		builder.addMesh(armrest);
+		builder.popTransform();
+		builder.popTransform();
+		builder.popTransform();
 
 		//duplicate the seats
-		PositionAttitudeTransform *sitze[20]; //maximum of 20 seats
-		ref_ptr<Group> sitze_all = new Group;
 		for (int i = 0; i < anzahl_sitze; i++){
-			sitze[i] = new PositionAttitudeTransform;
 			double posx = (plength / anzahl_sitze) * i + ((plength / anzahl_sitze) - (seatsize.x())) / 2; //calcute the position for each seat
-			sitze[i]->setPosition(Vec3d(posx, 0, legssize.z() + barssize.z()));
-			sitze[i]->addChild(seat.get());
-			sitze_all->addChild(sitze[i]);
+			builder.pushTransform(Matrix::translate(posx, 0, legssize.z() + barssize.z()));
+			builder.addMesh(seat);
+			builder.popTransform();
 		}
 
-		//bundle all components together into one group
 		ref_ptr<Group> bench = new Group;
-		bench->addChild(legs.get());
-		bench->addChild(bars.get());
-		bench->addChild(sitze_all.get());
-		
-		//position
-		ref_ptr<PositionAttitudeTransform> benchpos = new PositionAttitudeTransform;
-		benchpos = wrapInPositionAttitudeTransform(bench,Vec3d(armrestsize.x(), 0, 0));
-	  
-		
-		this->bench = benchpos;
+		bench->addChild(builder.build());
+		this->bench = bench;
 	}
 
 
@@ -1,6 +1,7 @@
 #include "../header/ControlRoom.h"
 #include "../header/UtilFunctions.h"
 #include "../header/CelShading.h"
+#include "../header/MeshBuilder.h"
 
 #include <osg/Geode>
 #include <osg/MatrixTransform>
@@ -24,69 +25,61 @@ namespace brtr{
     }
 
     ref_ptr<Group> ControlRoom::createRoomSurrounding(double roomSize, int lod) {
-        ref_ptr<Geode> floorGeode = new Geode;
-        floorGeode->addDrawable(brtr::createRectangle(roomSize, roomSize, lod, lod));
-        ref_ptr<MatrixTransform> floor = new MatrixTransform;
-        floor->setMatrix(Matrix::translate(-roomSize / 2, -roomSize / 2, 0));
-        floor->addChild(floorGeode);
-
-        ref_ptr<Geode> ceilingGeode = new Geode;
-        ceilingGeode->addDrawable(brtr::createRectangle(roomSize, roomSize, lod, lod));
-        ref_ptr<MatrixTransform> ceiling = new MatrixTransform;
-        ceiling->setMatrix(Matrix::translate(-roomSize / 2, -roomSize / 2, -roomSize / 2)
+        //floor, ceiling and three walls in one drawable, the fakewall needs its own node mask
+        MeshBuilder walls((lod + 1) * (lod + 1) * 5, lod * lod * 6 * 5);
+        MeshBuilder fakeWall((lod + 1) * (lod + 1), lod * lod * 6);
+
+        //floor
+        walls.pushTransform(Matrix::translate(-roomSize / 2, -roomSize / 2, 0));
+        walls.addRectangle(roomSize, roomSize, lod, lod, false);
+        walls.popTransform();
+
+        //ceiling
+        walls.pushTransform(Matrix::translate(-roomSize / 2, -roomSize / 2, -roomSize / 2)
             * Matrix::rotate(DegreesToRadians(180.0), X_AXIS));
-        ceiling->addChild(ceilingGeode);
+        walls.addRectangle(roomSize, roomSize, lod, lod, false);
+        walls.popTransform();
 
-        ref_ptr<Geode> firstWallGeode = new Geode;
-        firstWallGeode->addDrawable(brtr::createRectangle(roomSize / 2, roomSize, lod, lod));
-        ref_ptr<MatrixTransform> firstWall = new MatrixTransform;
-        firstWall->setMatrix(
+        walls.pushTransform(
             Matrix::translate(-roomSize / 2, -roomSize / 2, 0)
             *Matrix::rotate(DegreesToRadians(90.0), Y_AXIS)
             *Matrix::translate(-roomSize / 2, 0, 0)
             );
-        firstWall->addChild(firstWallGeode);
+        walls.addRectangle(roomSize / 2, roomSize, lod, lod, false);
+        walls.popTransform();
 
-        ref_ptr<Geode> secondWallGeode = new Geode;
-        secondWallGeode->addDrawable(brtr::createRectangle(roomSize / 2, roomSize, lod, lod));
-        ref_ptr<MatrixTransform> secondWall = new MatrixTransform;
-        secondWall->setMatrix(
+        walls.pushTransform(
             Matrix::translate(-roomSize / 2, -roomSize / 2, 0)
             *Matrix::rotate(DegreesToRadians(-90.0), Y_AXIS)
             *Matrix::translate(roomSize / 2, 0, roomSize / 2)
             );
-        secondWall->addChild(secondWallGeode);
+        walls.addRectangle(roomSize / 2, roomSize, lod, lod, false);
+        walls.popTransform();
 
-        ref_ptr<Geode> thirdWallGeode = new Geode;
-        thirdWallGeode->addDrawable(brtr::createRectangle(roomSize, roomSize / 2, lod, lod));
-        ref_ptr<MatrixTransform> thirdWall = new MatrixTransform;
-        thirdWall->setMatrix(
+        //this is the fakewall
+        fakeWall.pushTransform(
             Matrix::translate(-roomSize / 2, -roomSize / 2, 0)
             *Matrix::rotate(DegreesToRadians(-90.0), X_AXIS)
             *Matrix::translate(0, -roomSize / 2, 0)
             );
-        thirdWall->addChild(thirdWallGeode);
+        fakeWall.addRectangle(roomSize, roomSize / 2, lod, lod, false);
+        fakeWall.popTransform();
 
-        ref_ptr<Geode> fourthWallGeode = new Geode;
-        fourthWallGeode->addDrawable(brtr::createRectangle(roomSize, roomSize / 2, lod, lod));
-        ref_ptr<MatrixTransform> fourthWall = new MatrixTransform;
-        fourthWall->setMatrix(
+        walls.pushTransform(
             Matrix::translate(-roomSize / 2, -roomSize / 2, 0)
             *Matrix::rotate(DegreesToRadians(90.0), X_AXIS)
             *Matrix::translate(0, roomSize / 2, roomSize / 2)
             );
-        fourthWall->addChild(thirdWallGeode);
+        walls.addRectangle(roomSize, roomSize / 2, lod, lod, false);
+        walls.popTransform();
+
+        ref_ptr<Geode> fakeWallGeode = fakeWall.build();
+        fakeWallGeode->setNodeMask(~brtr::interactionAndCollisionMask);
 
         ref_ptr<Group> roomRoot = new Group;
-        roomRoot->addChild(floor);
-        roomRoot->addChild(ceiling);
-        roomRoot->addChild(firstWall);
-        roomRoot->addChild(secondWall);
-        roomRoot->addChild(thirdWall);
-        roomRoot->addChild(fourthWall);
+        roomRoot->addChild(walls.build());
+        roomRoot->addChild(fakeWallGeode);
         roomRoot->setNodeMask(brtr::collisionMask);
-        //this is the fakewall
-        thirdWall->setNodeMask(~brtr::interactionAndCollisionMask);
 
         //material for the whole room
         ref_ptr<Material> roomMaterial = createMaterial(Vec4(0.3, 0.3, 0.3, 1.0), Vec4(0.4, 0.4, 0.4, 1.0), Vec4(0.9, 0.9, 0.9, 1.0), 42);     
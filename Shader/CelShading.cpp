@@ -10,8 +10,60 @@
 #include "osg/TexEnv"
 #include "osg/PolygonMode"
 #include "osg/CullFace"
+#include "osg/ColorMask"
+#include "osg/Depth"
+#include "osg/BlendFunc"
+#include "../header/VertexCompressionVisitor.h"
+#include "../header/CoreProfileVisitor.h"
+#include "../header/UtilFunctions.h"
 
 namespace brtr{
+    namespace {
+        //defaults of the celShader.vert uniforms, the children override them
+        void addVertexUniforms(osg::StateSet& ss) {
+            ss.addUniform(new osg::Uniform("zAnimation", false));
+            ss.addUniform(new osg::Uniform("xAnimation", false));
+            ss.addUniform(new osg::Uniform("yAnimation", false));
+            ss.addUniform(new osg::Uniform("compressedNormals", false));
+            ss.addUniform(new osg::Uniform("compressedTexCoords", false));
+            ss.addUniform(new osg::Uniform("quantizedPositions", false));
+        }
+
+        osg::ref_ptr<osg::Program> createProgram(const std::string& vertSource, const std::string& fragSource) {
+            osg::ref_ptr<osg::Program> program = new osg::Program;
+            program->addShader(osgDB::readShaderFile(shaderFile(vertSource)));
+            program->addShader(osgDB::readShaderFile(shaderFile(fragSource)));
+            VertexCompressionVisitor::bindAttributes(*program);
+            if (getCoreShaders())
+                CoreProfileVisitor::bindUniformBlocks(*program);
+            return program;
+        }
+
+        //depth only, same vertex shader, therefore exactly the same depth values (invariant gl_Position)
+        osg::ref_ptr<osg::StateSet> createDepthOnlyStateSet(const std::string& vertSource) {
+            osg::ref_ptr<osg::StateSet> ss = new osg::StateSet;
+            ss->setAttributeAndModes(createProgram(vertSource, "depthOnly.frag"), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+            ss->setAttributeAndModes(new osg::ColorMask(false, false, false, false), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+            ss->setAttributeAndModes(new osg::Depth(osg::Depth::LESS, 0.0, 1.0, true), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+            addVertexUniforms(*ss);
+            return ss;
+        }
+
+        //back faces as lines, see osgFX::Cartoon
+        void setOutlineModes(osg::StateSet& ss, osg::LineWidth* lineWidth) {
+            osg::ref_ptr<osg::PolygonMode> polymode = new osg::PolygonMode;
+            polymode->setMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::LINE);
+            ss.setAttributeAndModes(polymode.get(), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+
+            osg::ref_ptr<osg::CullFace> cf = new osg::CullFace;
+            cf->setMode(osg::CullFace::FRONT);
+            ss.setAttributeAndModes(cf.get(), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+
+            ss.setAttributeAndModes(lineWidth, osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+            ss.addUniform(new osg::Uniform("quantizedPositions", false));
+        }
+    }
+
     /**
     *  @brief       The Technique for the cel-shading effect
     *  @author      Gleb Ostrowski
@@ -21,23 +73,30 @@ namespace brtr{
     */
     class CelShadingTechnique : public osgFX::Technique {
     public:
-        CelShadingTechnique(osg::Material* material, osg::LineWidth *lineWidth, bool secondPass, std::string vertSource)
+        CelShadingTechnique(osg::Material* material, osg::LineWidth *lineWidth, bool secondPass, std::string vertSource, bool depthPrePass)
             : Technique(), 
             _material(material),
             _lineWidth(lineWidth),
             _secondPass(secondPass),
-            _vertSource(vertSource){}
+            _vertSource(vertSource),
+            _depthPrePass(depthPrePass){}
 
     protected:
 
         void define_passes() {
+            // implement pass #0 (depth only)
+            if (_depthPrePass)
+                addPass(createDepthOnlyStateSet(_vertSource));
             // implement pass #1 (solid surfaces)
                 {
-                    osg::ref_ptr<osg::Shader> toonFrag = osgDB::readShaderFile("../Shader/celShader.frag");
-                    osg::ref_ptr<osg::Shader> toonVert = osgDB::readShaderFile("../Shader/" +  _vertSource);
+                    osg::ref_ptr<osg::Shader> toonFrag = osgDB::readShaderFile(shaderFile("celShader.frag"));
+                    osg::ref_ptr<osg::Shader> toonVert = osgDB::readShaderFile(shaderFile(_vertSource));
                     osg::ref_ptr<osg::Program> celShadingProgram = new osg::Program;
                     celShadingProgram->addShader(toonFrag);
                     celShadingProgram->addShader(toonVert);
+                    VertexCompressionVisitor::bindAttributes(*celShadingProgram);
+                    if (getCoreShaders())
+                        CoreProfileVisitor::bindUniformBlocks(*celShadingProgram);
 
                     osg::ref_ptr<osg::StateSet> ss = new osg::StateSet;
 
@@ -48,37 +107,45 @@ namespace brtr{
                     ss->addUniform(new osg::Uniform("zAnimation", false));
                     ss->addUniform(new osg::Uniform("xAnimation", false));
                     ss->addUniform(new osg::Uniform("yAnimation", false));
+                    //uncompressed vertices, unless the geometry says otherwise
+                    ss->addUniform(new osg::Uniform("compressedNormals", false));
+                    ss->addUniform(new osg::Uniform("compressedTexCoords", false));
+                    ss->addUniform(new osg::Uniform("quantizedPositions", false));
+                    //only the visible fragment survives, the depth is already there
+                    if (_depthPrePass)
+                        ss->setAttributeAndModes(new osg::Depth(osg::Depth::EQUAL, 0.0, 1.0, false), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
                     addPass(ss);
                 }
 
             // implement pass #2 (outlines) copy/paste from osgFX::Cartoon 
             if(_secondPass){
                 osg::ref_ptr<osg::StateSet> ss = new osg::StateSet;
-                osg::ref_ptr<osg::PolygonMode> polymode = new osg::PolygonMode;
-                polymode->setMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::LINE);
-                ss->setAttributeAndModes(polymode.get(), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
-
-                osg::ref_ptr<osg::CullFace> cf = new osg::CullFace;
-                cf->setMode(osg::CullFace::FRONT);
-                ss->setAttributeAndModes(cf.get(), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+                setOutlineModes(*ss, _lineWidth.get());
 
-                ss->setAttributeAndModes(_lineWidth.get(), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+                //fixed function would not understand quantized positions
+                osg::ref_ptr<osg::Program> outlineProgram = new osg::Program;
+                outlineProgram->addShader(osgDB::readShaderFile(shaderFile("celOutline.vert")));
+                outlineProgram->addShader(osgDB::readShaderFile(shaderFile("celOutline.frag")));
+                ss->setAttributeAndModes(outlineProgram, osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
 
-                _material->setColorMode(osg::Material::OFF);
-                _material->setDiffuse(osg::Material::FRONT_AND_BACK, osg::Vec4(0, 0, 0, 1));
-                _material->setAmbient(osg::Material::FRONT_AND_BACK, osg::Vec4(0, 0, 0, 1));
-                _material->setSpecular(osg::Material::FRONT_AND_BACK, osg::Vec4(0, 0, 0, 1));
+                //the core outline shader is black anyway, there is no fixed function state to set
+                if (!getCoreShaders()) {
+                    _material->setColorMode(osg::Material::OFF);
+                    _material->setDiffuse(osg::Material::FRONT_AND_BACK, osg::Vec4(0, 0, 0, 1));
+                    _material->setAmbient(osg::Material::FRONT_AND_BACK, osg::Vec4(0, 0, 0, 1));
+                    _material->setSpecular(osg::Material::FRONT_AND_BACK, osg::Vec4(0, 0, 0, 1));
 
-                // set by outline colour so no need to set here.
-                _material->setEmission(osg::Material::FRONT_AND_BACK, osg::Vec4(0, 0, 0, 1));
+                    // set by outline colour so no need to set here.
+                    _material->setEmission(osg::Material::FRONT_AND_BACK, osg::Vec4(0, 0, 0, 1));
 
-                ss->setAttributeAndModes(_material.get(), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+                    ss->setAttributeAndModes(_material.get(), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
 
-                ss->setMode(GL_LIGHTING, osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
-                ss->setTextureMode(0, GL_TEXTURE_1D, osg::StateAttribute::OVERRIDE | osg::StateAttribute::OFF);
-                ss->setTextureMode(0, GL_TEXTURE_2D, osg::StateAttribute::OVERRIDE | osg::StateAttribute::OFF);
-                ss->setTextureMode(1, GL_TEXTURE_1D, osg::StateAttribute::OVERRIDE | osg::StateAttribute::OFF);
-                ss->setTextureMode(1, GL_TEXTURE_2D, osg::StateAttribute::OVERRIDE | osg::StateAttribute::OFF);
+                    ss->setMode(GL_LIGHTING, osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+                    ss->setTextureMode(0, GL_TEXTURE_1D, osg::StateAttribute::OVERRIDE | osg::StateAttribute::OFF);
+                    ss->setTextureMode(0, GL_TEXTURE_2D, osg::StateAttribute::OVERRIDE | osg::StateAttribute::OFF);
+                    ss->setTextureMode(1, GL_TEXTURE_1D, osg::StateAttribute::OVERRIDE | osg::StateAttribute::OFF);
+                    ss->setTextureMode(1, GL_TEXTURE_2D, osg::StateAttribute::OVERRIDE | osg::StateAttribute::OFF);
+                }
 
                  addPass(ss.get());
             }
@@ -90,25 +157,136 @@ namespace brtr{
         std::string _toonTex;
         bool _secondPass;
         std::string _vertSource;
+        bool _depthPrePass;
+    };
+
+    /**
+    *  @brief       Debug views of the cel-shading effect, see CelShading::DebugMode
+    *  @details     The counts are written to the red channel as count/255, added up by blending, see DebugView.
+    */
+    class CelShadingDebugTechnique : public osgFX::Technique {
+    public:
+        CelShadingDebugTechnique(CelShading::DebugMode mode, osg::LineWidth *lineWidth, bool secondPass, std::string vertSource)
+            : Technique(),
+            _mode(mode),
+            _lineWidth(lineWidth),
+            _secondPass(secondPass),
+            _vertSource(vertSource){}
+
+    protected:
+
+        void define_passes() {
+            switch (_mode) {
+            case CelShading::DEBUG_OVERDRAW: {
+                //every fragment passing the depth test is shaded, the outlines too
+                osg::ref_ptr<osg::StateSet> ss = createCountStateSet(createProgram(_vertSource, "debugCount.frag"));
+                addVertexUniforms(*ss);
+                addPass(ss);
+                if (_secondPass)
+                    addPass(createOutlineCountStateSet());
+                break;
+            }
+            case CelShading::DEBUG_LIGHTS: {
+                //only the visible surface, otherwise the overdraw would be counted too
+                addPass(createDepthOnlyStateSet(_vertSource));
+                osg::ref_ptr<osg::StateSet> ss = new osg::StateSet;
+                ss->setAttributeAndModes(createProgram(_vertSource, "debugLights.frag"), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+                ss->setAttributeAndModes(new osg::Depth(osg::Depth::EQUAL, 0.0, 1.0, false), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+                addVertexUniforms(*ss);
+                addPass(ss);
+                break;
+            }
+            case CelShading::DEBUG_OUTLINES:
+                //the surfaces still hide the outlines behind them
+                addPass(createDepthOnlyStateSet(_vertSource));
+                if (_secondPass)
+                    addPass(createOutlineCountStateSet());
+                break;
+            default:
+                break;
+            }
+        }
+
+    private:
+        osg::ref_ptr<osg::StateSet> createCountStateSet(osg::Program* program) {
+            osg::ref_ptr<osg::StateSet> ss = new osg::StateSet;
+            ss->setAttributeAndModes(program, osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+            ss->setAttributeAndModes(new osg::BlendFunc(GL_ONE, GL_ONE), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON);
+            ss->addUniform(new osg::Uniform("debugCount", 1.0f));
+            return ss;
+        }
+
+        osg::ref_ptr<osg::StateSet> createOutlineCountStateSet() {
+            osg::ref_ptr<osg::Program> program = new osg::Program;
+            program->addShader(osgDB::readShaderFile(shaderFile("celOutline.vert")));
+            program->addShader(osgDB::readShaderFile(shaderFile("debugCount.frag")));
+            osg::ref_ptr<osg::StateSet> ss = createCountStateSet(program);
+            setOutlineModes(*ss, _lineWidth.get());
+            return ss;
+        }
+
+        CelShading::DebugMode _mode;
+        osg::ref_ptr<osg::LineWidth> _lineWidth;
+        bool _secondPass;
+        std::string _vertSource;
     };
 
     ///////////////////////////////////////////////////////////////////////////
 
-    CelShading::CelShading(bool secondPass, std::string vertSource)
+    CelShading::CelShading(bool secondPass, std::string vertSource, bool depthPrePass)
         : Effect(),
         _material(new osg::Material),
         _lineWidth(new osg::LineWidth(3.0f)),
         _secondPass(secondPass),
-        _vertSource(vertSource){}
+        _vertSource(vertSource),
+        _depthPrePass(depthPrePass),
+        _debugMode(DEBUG_OFF){
+        setDepthPrePass(depthPrePass);
+    }
 
     CelShading::CelShading(const CelShading& copy, const osg::CopyOp& copyop /*= osg::CopyOp::SHALLOW_COPY*/): 
         osgFX::Effect(copy, copyop),
         _material(static_cast<osg::Material*>(copyop(copy._material.get()))),
-        _lineWidth(static_cast<osg::LineWidth *>(copyop(copy._lineWidth.get()))) {}
+        _lineWidth(static_cast<osg::LineWidth *>(copyop(copy._lineWidth.get()))),
+        _secondPass(copy._secondPass),
+        _vertSource(copy._vertSource),
+        _depthPrePass(copy._depthPrePass),
+        _debugMode(copy._debugMode) {}
 
 
     bool CelShading::define_techniques() {
-        addTechnique(new CelShadingTechnique(_material, _lineWidth, _secondPass, _vertSource));
+        //technique 0 without, technique 1 with depth pre-pass, see setDepthPrePass()
+        addTechnique(new CelShadingTechnique(_material, _lineWidth, _secondPass, _vertSource, false));
+        addTechnique(new CelShadingTechnique(_material, _lineWidth, _secondPass, _vertSource, true));
+        //technique 1 + mode, see setDebugMode()
+        addTechnique(new CelShadingDebugTechnique(DEBUG_OVERDRAW, _lineWidth, _secondPass, _vertSource));
+        addTechnique(new CelShadingDebugTechnique(DEBUG_LIGHTS, _lineWidth, _secondPass, _vertSource));
+        addTechnique(new CelShadingDebugTechnique(DEBUG_OUTLINES, _lineWidth, _secondPass, _vertSource));
         return true;
     }
+
+    void CelShading::setDepthPrePass(bool depthPrePass) {
+        _depthPrePass = depthPrePass;
+        updateTechnique();
+    }
+
+    void CelShading::setDebugMode(DebugMode mode) {
+        _debugMode = mode;
+        updateTechnique();
+    }
+
+    CelShading::DebugMode CelShading::getDebugMode() const {
+        return _debugMode;
+    }
+
+    void CelShading::updateTechnique() {
+        if (_debugMode != DEBUG_OFF)
+            selectTechnique(1 + _debugMode);
+        else
+            selectTechnique(_depthPrePass ? 1 : 0);
+    }
+
+    bool CelShading::getDepthPrePass() const {
+        return _depthPrePass;
+    }
 }
\ No newline at end of file
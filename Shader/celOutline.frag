@@ -0,0 +1,6 @@
+#version 120
+//outline pass of CelShading, the material color from celOutline.vert
+void main()
+{
+	gl_FragColor = gl_Color;
+}
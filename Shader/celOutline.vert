@@ -0,0 +1,12 @@
+#version 120
+//outline pass of CelShading, fixed function transform and material color, but decodes quantized positions
+uniform bool quantizedPositions;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+void main()
+{
+	vec4 vertexPos = quantizedPositions ? vec4(positionOffset + gl_Vertex.xyz * positionScale, 1.0) : gl_Vertex;
+	gl_FrontColor = gl_FrontMaterial.emission;
+	gl_BackColor = gl_BackMaterial.emission;
+	gl_Position = gl_ModelViewProjectionMatrix * vertexPos;
+}
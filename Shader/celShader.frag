@@ -1,8 +1,10 @@
 //author Gleb Ostrowski
 #version 120 
+#extension GL_EXT_texture_array : enable
 #define NUM_LIGHTS 6
 uniform sampler2D texture0;
-uniform sampler2D toonTex;
+uniform sampler2DArray toonTex;
+uniform int toonIndex;	//layer of the toon ramp
 uniform float osg_FrameTime;
 uniform bool tex;
 varying vec3 normalModelView;
@@ -33,8 +35,8 @@ vec4 calculateLightFromLightSource(int lightIndex, bool front){
 	float specularBack = pow(max(dot(reflectedBack, eye), 0.0), gl_BackMaterial.shininess);
 	//Toon-Shading
 	//2D Toon http://www.cs.rpi.edu/~cutler/classes/advancedgraphics/S12/final_projects/hutchins_kim.pdf		
-	vec4 toonColor = texture2D(toonTex,vec2(intensity,specular));
-	vec4 toonColorBack = texture2D(toonTex,vec2(intensityBack,specularBack));
+	vec4 toonColor = texture2DArray(toonTex,vec3(intensity,specular,float(toonIndex)));
+	vec4 toonColorBack = texture2DArray(toonTex,vec3(intensityBack,specularBack,float(toonIndex)));
 	if(front){	
 		color += gl_FrontMaterial.ambient * gl_LightSource[lightIndex].ambient;
 		if(intensity > 0.0){
@@ -6,13 +6,24 @@ uniform bool zAnimation;
 uniform bool xAnimation;
 uniform bool yAnimation;
 uniform float osg_FrameTime;
+//see VertexCompressionVisitor
+attribute vec4 packedNormal;
+attribute vec2 packedTexCoord;
+uniform bool compressedNormals;
+uniform bool compressedTexCoords;
+uniform bool quantizedPositions;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+//the depth pre-pass uses this shader with another fragment shader, GL_EQUAL needs bitwise equal positions
+invariant gl_Position;
 void main()
 {	
-	normalModelView = gl_NormalMatrix * gl_Normal;
+	vec3 normal = compressedNormals ? packedNormal.xyz : gl_Normal;
+	normalModelView = gl_NormalMatrix * normal;
 
-	gl_TexCoord[0] = gl_MultiTexCoord0;
+	gl_TexCoord[0] = compressedTexCoords ? vec4(packedTexCoord, 0.0, 1.0) : gl_MultiTexCoord0;
 
-	vec4 vertexPos = gl_Vertex;
+	vec4 vertexPos = quantizedPositions ? vec4(positionOffset + gl_Vertex.xyz * positionScale, 1.0) : gl_Vertex;
 	if(zAnimation){
 		vertexPos.z += sin(2.5*vertexPos.z + osg_FrameTime)*0.25;	
 	}
@@ -0,0 +1,7 @@
+#version 330
+//core profile variant of ../celOutline.frag, the outlines are always black
+out vec4 fragColor;
+void main()
+{
+	fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+}
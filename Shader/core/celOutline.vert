@@ -0,0 +1,12 @@
+#version 330
+//core profile variant of ../celOutline.vert
+in vec4 osg_Vertex;
+uniform mat4 osg_ModelViewProjectionMatrix;
+uniform bool quantizedPositions;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+void main()
+{
+	vec4 vertexPos = quantizedPositions ? vec4(positionOffset + osg_Vertex.xyz * positionScale, 1.0) : osg_Vertex;
+	gl_Position = osg_ModelViewProjectionMatrix * vertexPos;
+}
@@ -0,0 +1,67 @@
+#version 330
+//core profile variant of ../celShader.frag, lights and material come from uniform blocks, see CoreProfileVisitor
+#define NUM_LIGHTS 6
+struct Light {
+	vec4 position;		//world space
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	vec4 attenuation;	//constant, linear, quadratic
+};
+layout(std140) uniform LightBlock {
+	Light lights[NUM_LIGHTS];
+};
+layout(std140) uniform MaterialBlock {
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	vec4 emission;
+	vec4 shininess;		//x
+} material;
+uniform mat4 lightViewMatrix;	//world to view space of the drawing camera, see CoreProfileVisitor
+uniform sampler2D texture0;
+uniform sampler2DArray toonTex;
+uniform int toonIndex;	//layer of the toon ramp
+uniform bool tex;
+in vec3 normalModelView;
+in vec4 vertexModelView;
+in vec2 texCoord;
+out vec4 fragColor;
+
+vec4 calculateLightFromLightSource(int lightIndex, vec3 n){
+	vec3 eye = normalize(-vertexModelView.xyz);
+	vec4 curLightPos = lightViewMatrix * lights[lightIndex].position;
+	vec3 lightDir = normalize(curLightPos.xyz - vertexModelView.xyz);
+
+	float dist = distance(curLightPos, vertexModelView);
+	vec4 att = lights[lightIndex].attenuation;
+	float attenuation = 1.0 / (att.x + att.y * dist + att.z * dist * dist);
+
+	float intensity = dot(n,lightDir); //NdotL, Lambert
+	//-Phong Modell
+	vec3 reflected = normalize(reflect( -lightDir, n));
+	float specular = pow(max(dot(reflected, eye), 0.0), material.shininess.x);
+	//Toon-Shading
+	//2D Toon http://www.cs.rpi.edu/~cutler/classes/advancedgraphics/S12/final_projects/hutchins_kim.pdf
+	vec4 toonColor = texture(toonTex,vec3(intensity,specular,float(toonIndex)));
+	vec4 color = material.ambient * lights[lightIndex].ambient;
+	if(intensity > 0.0){
+		color += material.diffuse * lights[lightIndex].diffuse * intensity * attenuation;
+		color += material.specular * lights[lightIndex].specular * specular * attenuation;
+	}
+	return color * toonColor;
+}
+
+void main(void) {
+	vec4 color = vec4(0.0);
+	//sampled outside of the non-uniform flow, see ../celShader.frag
+	vec4 texColor = texture(texture0, texCoord);
+	vec3 n = normalize(gl_FrontFacing ? normalModelView : -normalModelView);
+	for(int i = 0; i< NUM_LIGHTS; i++){
+		color += calculateLightFromLightSource(i, n);
+	}
+	if(tex)
+		fragColor = color * texColor;
+	else
+		fragColor = color;
+}
@@ -0,0 +1,47 @@
+#version 330
+//core profile variant of ../celShader.vert, see CoreProfileVisitor
+in vec4 osg_Vertex;
+in vec3 osg_Normal;
+in vec4 osg_MultiTexCoord0;
+uniform mat4 osg_ModelViewMatrix;
+uniform mat4 osg_ModelViewProjectionMatrix;
+uniform mat3 osg_NormalMatrix;
+out vec3 normalModelView;
+out vec4 vertexModelView;
+out vec2 texCoord;
+uniform bool zAnimation;
+uniform bool xAnimation;
+uniform bool yAnimation;
+uniform float osg_FrameTime;
+//see VertexCompressionVisitor
+in vec4 packedNormal;
+in vec2 packedTexCoord;
+uniform bool compressedNormals;
+uniform bool compressedTexCoords;
+uniform bool quantizedPositions;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+//the depth pre-pass uses this shader with another fragment shader, GL_EQUAL needs bitwise equal positions
+invariant gl_Position;
+void main()
+{
+	vec3 normal = compressedNormals ? packedNormal.xyz : osg_Normal;
+	normalModelView = osg_NormalMatrix * normal;
+
+	texCoord = compressedTexCoords ? packedTexCoord : osg_MultiTexCoord0.xy;
+
+	vec4 vertexPos = quantizedPositions ? vec4(positionOffset + osg_Vertex.xyz * positionScale, 1.0) : osg_Vertex;
+	if(zAnimation){
+		vertexPos.z += sin(2.5*vertexPos.z + osg_FrameTime)*0.25;
+	}
+	if(xAnimation){
+		vertexPos.x += sin(vertexPos.z + osg_FrameTime);
+		vertexPos.y += cos(vertexPos.z +osg_FrameTime);
+	}
+	if(yAnimation){
+		vertexPos.x += -sin(vertexPos.z + osg_FrameTime);
+		vertexPos.y += -cos(vertexPos.z +osg_FrameTime);
+	}
+	vertexModelView = osg_ModelViewMatrix * vertexPos;
+	gl_Position = osg_ModelViewProjectionMatrix * vertexPos;
+}
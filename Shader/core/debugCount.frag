@@ -0,0 +1,8 @@
+#version 330
+//core profile variant of ../debugCount.frag
+uniform float debugCount;
+out vec4 fragColor;
+void main()
+{
+	fragColor = vec4(debugCount / 255.0, 0.0, 0.0, 0.0);
+}
@@ -0,0 +1,18 @@
+#version 330
+//core profile variant of ../debugHeatmap.frag
+uniform sampler2D texture0;
+uniform float debugMaxCount;
+in vec2 texCoord;
+out vec4 fragColor;
+
+void main(void){
+	float count = floor(texture(texture0, texCoord).r * 255.0 + 0.5);
+	if(count < 0.5){
+		fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+	float t = clamp((count - 1.0) / max(debugMaxCount - 1.0, 1.0), 0.0, 1.0);
+	vec3 heat = t < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), t * 2.0)
+	                    : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), t * 2.0 - 1.0);
+	fragColor = vec4(heat, 1.0);
+}
@@ -0,0 +1,36 @@
+#version 330
+//core profile variant of ../debugLights.frag
+#define NUM_LIGHTS 6
+struct Light {
+	vec4 position;
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	vec4 attenuation;
+};
+layout(std140) uniform LightBlock {
+	Light lights[NUM_LIGHTS];
+};
+uniform mat4 lightViewMatrix;	//world to view space of the drawing camera, see CoreProfileVisitor
+in vec3 normalModelView;
+in vec4 vertexModelView;
+out vec4 fragColor;
+
+void main(void) {
+	vec3 n = normalize(gl_FrontFacing ? normalModelView : -normalModelView);
+	float count = 0.0;
+	for(int i = 0; i < NUM_LIGHTS; i++){
+		vec4 lightPos = lightViewMatrix * lights[i].position;
+		vec3 lightDir = normalize(lightPos.xyz - vertexModelView.xyz);
+		float dist = distance(lightPos, vertexModelView);
+		vec4 att = lights[i].attenuation;
+		float attenuation = 1.0 / (att.x + att.y * dist + att.z * dist * dist);
+		float intensity = dot(n, lightDir);
+		if(intensity > 0.0){
+			vec3 light = (lights[i].diffuse.rgb * intensity + lights[i].specular.rgb) * attenuation;
+			if(max(light.r, max(light.g, light.b)) > 1.0 / 255.0)
+				count += 1.0;
+		}
+	}
+	fragColor = vec4(count / 255.0, 0.0, 0.0, 0.0);
+}
@@ -0,0 +1,7 @@
+#version 330
+//core profile variant of ../depthOnly.frag
+out vec4 fragColor;
+void main()
+{
+	fragColor = vec4(0.0);
+}
@@ -0,0 +1,23 @@
+#version 330
+//core profile variant of ../fogShader.frag
+in vec2 texCoord;
+out vec4 fragColor;
+uniform sampler2D texture0;
+uniform sampler2D deepth;
+uniform vec3 fogColor;
+uniform float zNear;
+uniform float zFar;
+uniform float fogStart;
+uniform float fogEnd;
+
+//distance along the view axis
+float linearDepth(float z){
+    return 2.0 * zNear * zFar / ((zFar + zNear) - (2.0 * z - 1.0) * (zFar - zNear));
+}
+
+void main(void){
+	float z = linearDepth(texture(deepth, texCoord).x);
+	float fogFactor = clamp((fogEnd - z) / (fogEnd - fogStart), 0.0, 1.0);
+	vec4 texColor = texture(texture0, texCoord);
+	fragColor = mix(vec4(fogColor,1.0), texColor,fogFactor);
+}
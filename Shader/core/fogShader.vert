@@ -0,0 +1,16 @@
+#version 330
+//core profile variant of ../fogShader.vert
+in vec4 osg_Vertex;
+in vec4 osg_MultiTexCoord0;
+uniform mat4 osg_ModelViewMatrix;
+uniform mat4 osg_ModelViewProjectionMatrix;
+out vec4 vertexModelView;
+out vec2 texCoord;
+//part of the first pass textures which was rendered to
+uniform vec2 rttScale;
+void main()
+{
+	gl_Position = osg_ModelViewProjectionMatrix * osg_Vertex;
+	vertexModelView = osg_ModelViewMatrix * osg_Vertex;
+	texCoord = osg_MultiTexCoord0.xy * rttScale;
+}
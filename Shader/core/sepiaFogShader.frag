@@ -0,0 +1,30 @@
+#version 330
+//core profile variant of ../sepiaFogShader.frag
+in vec2 texCoord;
+out vec4 fragColor;
+uniform sampler2D texture0;
+uniform sampler2D deepth;
+uniform vec3 fogColor;
+uniform float zNear;
+uniform float zFar;
+uniform float fogStart;
+uniform float fogEnd;
+
+//distance along the view axis
+float linearDepth(float z){
+    return 2.0 * zNear * zFar / ((zFar + zNear) - (2.0 * z - 1.0) * (zFar - zNear));
+}
+
+void main(void){
+	float z = linearDepth(texture(deepth, texCoord).x);
+	float fogFactor = clamp((fogEnd - z) / (fogEnd - fogStart), 0.0, 1.0);
+	vec4 texColor = texture(texture0, texCoord);
+
+	//SEPIA  http://wiki.delphigl.com/index.php/shader_sepia
+	vec4 Sepia1 = vec4( 0.2, 0.05, 0.0, 1.0 );
+	vec4 Sepia2 = vec4( 1.0, 0.9, 0.5, 1.0 );
+	float SepiaMix = dot(vec3(0.3, 0.59, 0.11), vec3(texColor));
+	texColor = mix(Sepia1, Sepia2, SepiaMix);
+
+	fragColor = mix(vec4(fogColor,1.0), texColor,fogFactor);
+}
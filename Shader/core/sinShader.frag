@@ -0,0 +1,28 @@
+#version 330
+//core profile variant of ../sinShader.frag
+in vec2 texCoord;
+out vec4 fragColor;
+uniform sampler2D texture0;
+uniform sampler2D deepth;
+uniform vec3 fogColor;
+uniform float zNear;
+uniform float zFar;
+uniform float fogStart;
+uniform float fogEnd;
+uniform float osg_FrameTime;
+uniform vec2 rttScale;
+
+//distance along the view axis
+float linearDepth(float z){
+    return 2.0 * zNear * zFar / ((zFar + zNear) - (2.0 * z - 1.0) * (zFar - zNear));
+}
+
+void main(void){
+	//waves in screen space, independent of the rendered part of the texture
+	vec2 coord = texCoord;
+	coord.x += sin(coord.y / rttScale.y * 4.0 * 2.0 * 3.14159 + osg_FrameTime) / 100.0 * rttScale.x;
+	float z = linearDepth(texture(deepth, coord).x);
+	float fogFactor = clamp((fogEnd - z) / (fogEnd - fogStart), 0.0, 1.0);
+	vec4 texColor = texture(texture0, coord);
+	fragColor = mix(vec4(fogColor,1.0), texColor,fogFactor);
+}
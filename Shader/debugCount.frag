@@ -0,0 +1,7 @@
+#version 120
+//debug views of CelShading, adds debugCount to the red channel (additive blending), see DebugView
+uniform float debugCount;
+void main()
+{
+	gl_FragColor = vec4(debugCount / 255.0, 0.0, 0.0, 0.0);
+}
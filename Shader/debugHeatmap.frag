@@ -0,0 +1,17 @@
+#version 120
+//postprocess of the CelShading debug views, the red channel holds count/255, see DebugView
+uniform sampler2D texture0;
+uniform float debugMaxCount;
+
+void main(void){
+	float count = floor(texture2D(texture0, gl_TexCoord[0].xy).r * 255.0 + 0.5);
+	if(count < 0.5){
+		gl_FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+	//1 = blue, debugMaxCount/2 = green, debugMaxCount and more = red
+	float t = clamp((count - 1.0) / max(debugMaxCount - 1.0, 1.0), 0.0, 1.0);
+	vec3 heat = t < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), t * 2.0)
+	                    : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), t * 2.0 - 1.0);
+	gl_FragColor = vec4(heat, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 120
+//debug view of CelShading, number of lights visibly contributing to the surface (same attenuation as celShader.frag)
+#define NUM_LIGHTS 6
+varying vec3 normalModelView;
+varying vec4 vertexModelView;
+
+void main(void) {
+	vec3 n = normalize(gl_FrontFacing ? normalModelView : -normalModelView);
+	float count = 0.0;
+	for(int i = 0; i < NUM_LIGHTS; i++){
+		vec3 lightDir = normalize(gl_LightSource[i].position.xyz - vertexModelView.xyz);
+		float dist = distance(gl_LightSource[i].position, vertexModelView);
+		float attenuation = 1.0 / (gl_LightSource[i].constantAttenuation
+					+ gl_LightSource[i].linearAttenuation * dist
+					+ gl_LightSource[i].quadraticAttenuation * dist * dist);
+		float intensity = dot(n, lightDir);
+		if(intensity > 0.0){
+			vec3 light = (gl_LightSource[i].diffuse.rgb * intensity + gl_LightSource[i].specular.rgb) * attenuation;
+			//less than one step of the color buffer is invisible
+			if(max(light.r, max(light.g, light.b)) > 1.0 / 255.0)
+				count += 1.0;
+		}
+	}
+	gl_FragColor = vec4(count / 255.0, 0.0, 0.0, 0.0);
+}
@@ -0,0 +1,6 @@
+#version 120
+//depth pre-pass of CelShading, the color mask is off anyway
+void main()
+{
+	gl_FragColor = vec4(0.0);
+}
@@ -6,9 +6,12 @@ uniform sampler2D deepth;
 uniform vec3 fogColor;
 uniform float zNear;
 uniform float zFar;
+uniform float fogStart;
+uniform float fogEnd;
 
+//distance along the view axis
 float linearDepth(float z){
-    return (2.0 * (zNear+zFar)) / ((zFar + zNear) - z * (zFar - zNear));// -1.0;	
+    return 2.0 * zNear * zFar / ((zFar + zNear) - (2.0 * z - 1.0) * (zFar - zNear));
 }
 
 void main(void){
@@ -18,7 +21,7 @@ void main(void){
 	float z = texture2D(deepth, deepthPoint).x;
 	//fogFactor = (end - z) / (end - start)
 	z = linearDepth(z); 
-		float fogFactor = (4000*4-z) / (4000*4 - 30*4);
+		float fogFactor = (fogEnd - z) / (fogEnd - fogStart);
 	fogFactor = clamp(fogFactor, 0.0, 1.0);
 
 	vec4 texColor = texture2D(texture0,gl_TexCoord[0].xy);
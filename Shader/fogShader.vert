@@ -1,9 +1,11 @@
 //author Gleb Ostrowski
 #version 120
 varying vec4 vertexModelView;
+//part of the first pass textures which was rendered to
+uniform vec2 rttScale;
 void main()
 {	
   gl_Position = ftransform();		
   vertexModelView = gl_ModelViewMatrix * gl_Vertex;
-  gl_TexCoord[0] = gl_MultiTexCoord0;
+  gl_TexCoord[0] = vec4(gl_MultiTexCoord0.xy * rttScale, gl_MultiTexCoord0.zw);
 }
\ No newline at end of file
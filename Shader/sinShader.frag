@@ -6,10 +6,14 @@ uniform sampler2D deepth;
 uniform vec3 fogColor;
 uniform float zNear;
 uniform float zFar;
+uniform float fogStart;
+uniform float fogEnd;
 uniform float osg_FrameTime;
+uniform vec2 rttScale;
 
+//distance along the view axis
 float linearDepth(float z){
-    return (2.0 * (zNear+zFar)) / ((zFar + zNear) - z * (zFar - zNear));// -1.0;	
+    return 2.0 * zNear * zFar / ((zFar + zNear) - (2.0 * z - 1.0) * (zFar - zNear));
 }
 
 void main(void){
@@ -17,12 +21,13 @@ void main(void){
 	//http://www.ozone3d.net/tutorials/glsl_fog/p04.php and depth_of_field example OSG Cookbook
      //http://en.wikibooks.org/wiki/OpenGL_Programming/Post-Processing
 	vec4 texCoord = gl_TexCoord[0];
-    texCoord.x +=  sin(texCoord.y * 4*2*3.14159 + osg_FrameTime) / 100;
+    //waves in screen space, independent of the rendered part of the texture
+    texCoord.x +=  sin(texCoord.y / rttScale.y * 4*2*3.14159 + osg_FrameTime) / 100 * rttScale.x;
     vec2 deepthPoint = texCoord.xy;
 	float z = texture2D(deepth, deepthPoint).x;
 	//fogFactor = (end - z) / (end - start)
 	z = linearDepth(z); 
-	float fogFactor = (4000*4-z) / (4000*4 - 30*4);
+	float fogFactor = (fogEnd - z) / (fogEnd - fogStart);
 	fogFactor = clamp(fogFactor, 0.0, 1.0);
 
 	vec4 texColor = texture2D(texture0,texCoord.xy);
@@ -0,0 +1,249 @@
+#include "../header/CollisionProxyBuilder.h"
+#include "../header/UtilFunctions.h"
+#include "../header/TriangleCollector.h"
+#include <osg/TriangleFunctor>
+#include <osg/ComputeBoundsVisitor>
+#include <osg/KdTree>
+#include <osg/LOD>
+#include <cmath>
+#include <cfloat>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        struct Cell {
+            int x, y, z;
+            bool operator<(const Cell& other) const {
+                if (x != other.x) return x < other.x;
+                if (y != other.y) return y < other.y;
+                return z < other.z;
+            }
+        };
+
+        struct Triangle {
+            unsigned int a, b, c;
+            bool operator<(const Triangle& other) const {
+                if (a != other.a) return a < other.a;
+                if (b != other.b) return b < other.b;
+                return c < other.c;
+            }
+        };
+    }
+
+    CollisionProxyBuilder::CollisionProxyBuilder(double cellSize, double boxThreshold) :
+        _cellSize(cellSize),
+        _boxThreshold(boxThreshold),
+        _onCollisionPath(true),
+        _numSourceTriangles(0),
+        _numProxyTriangles(0) {
+        setTraversalMode(NodeVisitor::TRAVERSE_ALL_CHILDREN);
+    }
+
+    void CollisionProxyBuilder::useBoxFor(osg::Node* node) {
+        _boxNodes.insert(node);
+    }
+
+    void CollisionProxyBuilder::build(osg::Node* root) {
+        root->accept(*this);
+        //adding children while traversing would invalidate the child iterators
+        KdTreeBuilder kdTreeBuilder;
+        for (auto pending = _pendingProxies.begin(); pending != _pendingProxies.end(); ++pending) {
+            //LOD::addChild(Node*) would give the proxy a range, which is never active (see LODBuilder)
+            LOD* lod = dynamic_cast<LOD*>(pending->first.get());
+            if (lod)
+                lod->addChild(pending->second, 0.0f, FLT_MAX);
+            else
+                pending->first->addChild(pending->second);
+            pending->second->accept(kdTreeBuilder);
+        }
+        _pendingProxies.clear();
+        OSG_ALWAYS << "Collision proxies: " << _numSourceTriangles << " triangles reduced to "
+            << _numProxyTriangles << std::endl;
+    }
+
+    void CollisionProxyBuilder::apply(osg::Node& node) {
+        bool onCollisionPath = _onCollisionPath && (node.getNodeMask() & collisionMask);
+        if (!onCollisionPath) {
+            //e.g. fakewalls, must not be reachable by a proxy intersection either
+            node.setNodeMask(node.getNodeMask() & ~collisionProxyMask);
+            traverseWithFlag(node, false);
+            return;
+        }
+        node.setNodeMask(node.getNodeMask() | collisionProxyMask);
+
+        if (_boxNodes.count(&node) && node.asGroup()) {
+            ComputeBoundsVisitor cbv;
+            Group* group = node.asGroup();
+            for (unsigned int i = 0; i < group->getNumChildren(); ++i)
+                group->getChild(i)->accept(cbv);
+            if (cbv.getBoundingBox().valid()) {
+                ref_ptr<Geode> proxy = createProxyGeode();
+                proxy->addDrawable(createBox(cbv.getBoundingBox()));
+                _pendingProxies.push_back(std::make_pair(ref_ptr<Group>(group), ref_ptr<Node>(proxy)));
+            }
+            //the render subtree is only represented by the box
+            traverseWithFlag(node, false);
+            return;
+        }
+        traverseWithFlag(node, true);
+    }
+
+    void CollisionProxyBuilder::apply(osg::Geode& geode) {
+        bool onCollisionPath = _onCollisionPath && (geode.getNodeMask() & collisionMask);
+        geode.setNodeMask(geode.getNodeMask() & ~collisionProxyMask);
+        //the proxy is added below all parents at once, a geode with several parents is reached by several paths
+        if (!onCollisionPath || !_visitedGeodes.insert(&geode).second)
+            return;
+
+        //cell size and box threshold are world units, the models are scaled differently
+        Vec3d scale = computeLocalToWorld(getNodePath()).getScale();
+        ref_ptr<Geode> proxy = createProxyGeode();
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            ref_ptr<Geometry> proxyGeometry = createProxy(geode.getDrawable(i), scale);
+            if (proxyGeometry.valid())
+                proxy->addDrawable(proxyGeometry);
+        }
+        if (proxy->getNumDrawables() == 0)
+            return;
+        for (unsigned int i = 0; i < geode.getNumParents(); ++i)
+            _pendingProxies.push_back(std::make_pair(ref_ptr<Group>(geode.getParent(i)), ref_ptr<Node>(proxy)));
+    }
+
+    void CollisionProxyBuilder::traverseWithFlag(osg::Node& node, bool onCollisionPath) {
+        bool saved = _onCollisionPath;
+        _onCollisionPath = onCollisionPath;
+        traverse(node);
+        _onCollisionPath = saved;
+    }
+
+    ref_ptr<Geode> CollisionProxyBuilder::createProxyGeode() {
+        ref_ptr<Geode> proxy = new Geode;
+        proxy->setName("CollisionProxy");
+        proxy->setNodeMask(collisionProxyMask);
+        return proxy;
+    }
+
+    ref_ptr<Geometry> CollisionProxyBuilder::createProxy(osg::Drawable* drawable, const osg::Vec3d& scale) {
+        auto key = std::make_pair(drawable, scale);
+        auto cached = _proxyCache.find(key);
+        if (cached != _proxyCache.end())
+            return cached->second;
+
+        ref_ptr<Geometry> proxy;
+        const BoundingBox& bb = drawable->getBound();
+        Vec3d extent = bb._max - bb._min;
+        double worldDiagonal = Vec3d(extent.x() * scale.x(), extent.y() * scale.y(), extent.z() * scale.z()).length();
+        Geometry* geometry = drawable->asGeometry();
+        if (!geometry) {
+            //e.g. ShapeDrawables, no triangles to cluster
+            if (bb.valid())
+                proxy = createBox(bb);
+        }
+        else if (bb.valid() && worldDiagonal < _boxThreshold) {
+            TriangleFunctor<TriangleVertexCollector> counter;
+            geometry->accept(counter);
+            _numSourceTriangles += counter.vertices.size() / 3;
+            proxy = createBox(bb);
+        }
+        else
+            proxy = createClusteredMesh(geometry, Vec3d(_cellSize / scale.x(), _cellSize / scale.y(), _cellSize / scale.z()));
+        _proxyCache[key] = proxy;
+        return proxy;
+    }
+
+    ref_ptr<Geometry> CollisionProxyBuilder::createClusteredMesh(osg::Geometry* geometry, const osg::Vec3d& cellSize) {
+        TriangleFunctor<TriangleVertexCollector> collector;
+        geometry->accept(collector);
+        _numSourceTriangles += collector.vertices.size() / 3;
+        if (collector.vertices.empty())
+            return nullptr;
+
+        //one representative (the average) vertex per grid cell
+        std::map<Cell, unsigned int> cellIndices;
+        std::vector<Vec3d> sums;
+        std::vector<unsigned int> counts;
+        std::vector<unsigned int> remap(collector.vertices.size());
+        for (unsigned int i = 0; i < collector.vertices.size(); ++i) {
+            const Vec3& v = collector.vertices[i];
+            Cell cell = { (int)std::floor(v.x() / cellSize.x()), (int)std::floor(v.y() / cellSize.y()), (int)std::floor(v.z() / cellSize.z()) };
+            auto found = cellIndices.find(cell);
+            if (found == cellIndices.end()) {
+                found = cellIndices.insert(std::make_pair(cell, (unsigned int)sums.size())).first;
+                sums.push_back(Vec3d());
+                counts.push_back(0);
+            }
+            sums[found->second] += Vec3d(v);
+            counts[found->second]++;
+            remap[i] = found->second;
+        }
+
+        //triangles collapsing into less than three cells are degenerated
+        std::set<Triangle> triangles;
+        for (unsigned int i = 0; i + 2 < remap.size(); i += 3) {
+            unsigned int a = remap[i], b = remap[i + 1], c = remap[i + 2];
+            if (a == b || b == c || a == c)
+                continue;
+            //rotate the smallest index to the front, keeps the winding but finds duplicates
+            if (b < a && b < c) { unsigned int t = a; a = b; b = c; c = t; }
+            else if (c < a && c < b) { unsigned int t = c; c = b; b = a; a = t; }
+            Triangle triangle = { a, b, c };
+            triangles.insert(triangle);
+        }
+        if (triangles.empty())
+            return nullptr;
+
+        ref_ptr<Vec3Array> vertices = new Vec3Array;
+        vertices->reserve(sums.size());
+        for (unsigned int i = 0; i < sums.size(); ++i)
+            vertices->push_back(sums[i] / counts[i]);
+        ref_ptr<DrawElementsUInt> indices = new DrawElementsUInt(GL_TRIANGLES);
+        indices->reserve(triangles.size() * 3);
+        for (auto triangle = triangles.begin(); triangle != triangles.end(); ++triangle) {
+            indices->push_back(triangle->a);
+            indices->push_back(triangle->b);
+            indices->push_back(triangle->c);
+        }
+        _numProxyTriangles += triangles.size();
+
+        ref_ptr<Geometry> proxy = new Geometry;
+        proxy->setVertexArray(vertices);
+        proxy->addPrimitiveSet(indices);
+        //never rendered, the arrays are only needed for intersecting
+        proxy->setUseDisplayList(false);
+        return proxy;
+    }
+
+    ref_ptr<Geometry> CollisionProxyBuilder::createBox(const osg::BoundingBox& bb) {
+        ref_ptr<Vec3Array> vertices = new Vec3Array;
+        for (unsigned int i = 0; i < 8; ++i)
+            vertices->push_back(bb.corner(i));
+        //corner(i): bit 0 = x, bit 1 = y, bit 2 = z
+        const GLushort faces[] = {
+            0, 2, 3, 0, 3, 1,  //bottom
+            4, 5, 7, 4, 7, 6,  //top
+            0, 1, 5, 0, 5, 4,  //front
+            2, 6, 7, 2, 7, 3,  //back
+            0, 4, 6, 0, 6, 2,  //left
+            1, 3, 7, 1, 7, 5   //right
+        };
+        ref_ptr<DrawElementsUShort> indices = new DrawElementsUShort(GL_TRIANGLES, 36, faces);
+        _numProxyTriangles += 12;
+
+        ref_ptr<Geometry> box = new Geometry;
+        box->setVertexArray(vertices);
+        box->addPrimitiveSet(indices);
+        box->setUseDisplayList(false);
+        return box;
+    }
+
+    unsigned int CollisionProxyBuilder::getNumSourceTriangles() const {
+        return _numSourceTriangles;
+    }
+
+    unsigned int CollisionProxyBuilder::getNumProxyTriangles() const {
+        return _numProxyTriangles;
+    }
+
+}
@@ -0,0 +1,228 @@
+#include "../header/Config.h"
+#include <osg/Notify>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace brtr {
+
+    namespace {
+        const char* valueOptions[] = { "resolution", "screen", "vsync", "msaa", "threading", "post-program",
+            "outlines", "wait", "dynamic-resolution", "occlusion-culling", "depth-prepass", "gl-core",
+            "static-batching", "precompile", "async-rays" };
+        const char* flagOptions[] = { "windowed", "change-desktop-mode", "no-wait", "release-cpu-data",
+            "audit-data-variance", "dynamic-resolution-textures", "compress-vertices", "cook-textures" };
+
+        std::string trim(const std::string& str) {
+            size_t begin = str.find_first_not_of(" \t\r");
+            if (begin == std::string::npos)
+                return "";
+            size_t end = str.find_last_not_of(" \t\r");
+            return str.substr(begin, end - begin + 1);
+        }
+
+        bool toBool(const std::string& value, bool& result) {
+            if (value.empty() || value == "on" || value == "true" || value == "1" || value == "yes")
+                result = true;
+            else if (value == "off" || value == "false" || value == "0" || value == "no")
+                result = false;
+            else
+                return false;
+            return true;
+        }
+
+        template<class T>
+        bool toNumber(const std::string& value, T& result) {
+            std::stringstream stream(value);
+            T number;
+            if (!(stream >> number) || !stream.eof())
+                return false;
+            result = number;
+            return true;
+        }
+    }
+
+    Config::Config() :
+        width(0),
+        height(0),
+        useScreenResolution(false),
+        screen(0),
+        windowed(false),
+        changeDesktopMode(false),
+        vsync(true),
+        samples(0),
+        threadingModel(osgViewer::ViewerBase::DrawThreadPerContext),
+        postProgram(0),
+        outlines(true),
+        waitForEnter(true),
+        releaseCPUData(false),
+        auditDataVariance(false),
+        resolutionBudget(0.0),
+        resizeRTTTextures(false),
+        compressVertices(false),
+        cookTextures(false),
+        occlusionCulling(false),
+        depthPrePass(false),
+        glCore(false),
+        staticBatching(false),
+        gpuCulling(false),
+        precompile(false),
+        asyncRays(false),
+        _waitSet(false) {}
+
+    bool Config::read(osg::ArgumentParser& arguments) {
+        bool valid = true;
+        std::string fileName;
+        if (arguments.read("--config", fileName))
+            valid = readFile(fileName);
+        else {
+            std::ifstream defaultFile("../braintrain.cfg");
+            if (defaultFile)
+                valid = readFile("../braintrain.cfg");
+        }
+
+        for (unsigned int i = 0; i < sizeof(valueOptions) / sizeof(valueOptions[0]); ++i) {
+            std::string value;
+            while (arguments.read(std::string("--") + valueOptions[i], value))
+                valid = set(valueOptions[i], value) && valid;
+        }
+        for (unsigned int i = 0; i < sizeof(flagOptions) / sizeof(flagOptions[0]); ++i) {
+            while (arguments.read(std::string("--") + flagOptions[i]))
+                valid = set(flagOptions[i], "") && valid;
+        }
+        //typos must not silently fall back to the defaults
+        arguments.reportRemainingOptionsAsUnrecognized();
+        if (arguments.errors()) {
+            arguments.writeErrorMessages(std::cout);
+            valid = false;
+        }
+        //unattended, if everything needed is given
+        if (!_waitSet)
+            waitForEnter = !hasResolution();
+        return valid;
+    }
+
+    bool Config::readFile(const std::string& fileName) {
+        std::ifstream file(fileName.c_str());
+        if (!file) {
+            OSG_ALWAYS << "Could not open config file " << fileName << std::endl;
+            return false;
+        }
+        bool valid = true;
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+            size_t separator = line.find('=');
+            std::string key = trim(line.substr(0, separator));
+            std::string value = separator == std::string::npos ? "" : trim(line.substr(separator + 1));
+            if (!set(key, value)) {
+                OSG_ALWAYS << fileName << ":" << lineNumber << ": ignoring invalid line \"" << line << "\"" << std::endl;
+                valid = false;
+            }
+        }
+        return valid;
+    }
+
+    bool Config::hasResolution() const {
+        return useScreenResolution || (width > 0 && height > 0);
+    }
+
+    bool Config::set(const std::string& key, const std::string& value) {
+        bool ok = true;
+        if (key == "resolution") {
+            if (value == "screen")
+                useScreenResolution = true;
+            else {
+                size_t x = value.find('x');
+                ok = x != std::string::npos
+                    && toNumber(value.substr(0, x), width)
+                    && toNumber(value.substr(x + 1), height);
+                useScreenResolution = false;
+            }
+        }
+        else if (key == "screen")
+            ok = toNumber(value, screen);
+        else if (key == "windowed")
+            ok = toBool(value, windowed);
+        else if (key == "change-desktop-mode")
+            ok = toBool(value, changeDesktopMode);
+        else if (key == "vsync")
+            ok = toBool(value, vsync);
+        else if (key == "msaa")
+            ok = toNumber(value, samples);
+        else if (key == "threading") {
+            if (value == "SingleThreaded")
+                threadingModel = osgViewer::ViewerBase::SingleThreaded;
+            else if (value == "CullDrawThreadPerContext")
+                threadingModel = osgViewer::ViewerBase::CullDrawThreadPerContext;
+            else if (value == "DrawThreadPerContext")
+                threadingModel = osgViewer::ViewerBase::DrawThreadPerContext;
+            else if (value == "CullThreadPerCameraDrawThreadPerContext")
+                threadingModel = osgViewer::ViewerBase::CullThreadPerCameraDrawThreadPerContext;
+            else
+                ok = false;
+        }
+        else if (key == "post-program") {
+            //same order as the program vector of createRenderingPipeline
+            if (value == "fog")
+                postProgram = 0;
+            else if (value == "sepia")
+                postProgram = 1;
+            else if (value == "waves")
+                postProgram = 2;
+            else
+                ok = false;
+        }
+        else if (key == "outlines")
+            ok = toBool(value, outlines);
+        else if (key == "wait") {
+            ok = toBool(value, waitForEnter);
+            _waitSet = ok;
+        }
+        else if (key == "no-wait") {
+            bool noWait = true;
+            ok = toBool(value, noWait);
+            waitForEnter = !noWait;
+            _waitSet = ok;
+        }
+        else if (key == "release-cpu-data")
+            ok = toBool(value, releaseCPUData);
+        else if (key == "audit-data-variance")
+            ok = toBool(value, auditDataVariance);
+        else if (key == "dynamic-resolution")
+            ok = toNumber(value, resolutionBudget);
+        else if (key == "dynamic-resolution-textures")
+            ok = toBool(value, resizeRTTTextures);
+        else if (key == "compress-vertices")
+            ok = toBool(value, compressVertices);
+        else if (key == "cook-textures")
+            ok = toBool(value, cookTextures);
+        else if (key == "occlusion-culling")
+            ok = toBool(value, occlusionCulling);
+        else if (key == "depth-prepass")
+            ok = toBool(value, depthPrePass);
+        else if (key == "gl-core")
+            ok = toBool(value, glCore);
+        else if (key == "precompile")
+            ok = toBool(value, precompile);
+        else if (key == "async-rays")
+            ok = toBool(value, asyncRays);
+        else if (key == "static-batching") {
+            gpuCulling = value == "gpu";
+            staticBatching = true;
+            if (!gpuCulling)
+                ok = toBool(value, staticBatching);
+        }
+        else
+            ok = false;
+
+        if (!ok)
+            OSG_ALWAYS << "Invalid option " << key << " = \"" << value << "\"" << std::endl;
+        return ok;
+    }
+
+}
@@ -0,0 +1,198 @@
+#include "../header/CoreProfileVisitor.h"
+#include <osg/BufferObject>
+#include <osg/BufferIndexBinding>
+#include <osg/DisplaySettings>
+#include <osg/GL>
+#include <osgUtil/CullVisitor>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //std140: 4 vec4 colors and the shininess as vec4
+        const unsigned int materialVec4s = 5;
+        //GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT is at most 256
+        const unsigned int materialStride = 256 / sizeof(Vec4);
+        //position, ambient, diffuse, specular, attenuation
+        const unsigned int lightVec4s = 5;
+
+        void writeMaterial(Vec4Array& data, unsigned int index, const Material& material) {
+            unsigned int offset = index * materialStride;
+            data[offset + 0] = material.getAmbient(Material::FRONT);
+            data[offset + 1] = material.getDiffuse(Material::FRONT);
+            data[offset + 2] = material.getSpecular(Material::FRONT);
+            data[offset + 3] = material.getEmission(Material::FRONT);
+            data[offset + 4] = Vec4(material.getShininess(Material::FRONT), 0.0f, 0.0f, 0.0f);
+        }
+
+        class CoreProfileRealizeOperation : public GraphicsOperation {
+        public:
+            CoreProfileRealizeOperation() : GraphicsOperation("CoreProfileRealizeOperation", false) {}
+            virtual void operator()(GraphicsContext* gc) {
+                //osg_ModelViewMatrix, osg_Vertex... instead of the compatibility built-ins
+                gc->getState()->setUseModelViewAndProjectionUniforms(true);
+                gc->getState()->setUseVertexAttributeAliasing(true);
+            }
+        };
+
+        class FixedFunctionDrawCallback : public Camera::DrawCallback {
+        public:
+            FixedFunctionDrawCallback(bool fixedFunction) : _fixedFunction(fixedFunction) {}
+            virtual void operator()(RenderInfo& renderInfo) const {
+                State* state = renderInfo.getState();
+                //arrays enabled with the other aliasing would stay enabled
+                state->disableAllVertexArrays();
+                state->setUseModelViewAndProjectionUniforms(!_fixedFunction);
+                state->setUseVertexAttributeAliasing(!_fixedFunction);
+            }
+        private:
+            bool _fixedFunction;
+        };
+
+        //sets lightViewMatrix of the camera to the view of the current cull traversal
+        class LightViewCallback : public NodeCallback {
+        public:
+            LightViewCallback(Uniform* lightViewMatrix) : _lightViewMatrix(lightViewMatrix) {}
+            virtual void operator()(Node* node, NodeVisitor* nv) {
+                //the camera has pushed its view, RELATIVE_RF cameras on top of the parent view (WeaponHUD: only its own)
+                osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+                if (cv)
+                    _lightViewMatrix->set(Matrixf(*cv->getModelViewMatrix()));
+                traverse(node, nv);
+            }
+        private:
+            ref_ptr<Uniform> _lightViewMatrix;
+        };
+    }
+
+    CoreProfileVisitor::CoreProfileVisitor() :
+        NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _lightData(numLights * lightVec4s) {
+        setNodeMaskOverride(0xffffffff);
+        //empty slots: black, constant attenuation keeps the shader from dividing by zero
+        for (unsigned int i = 0; i < numLights; ++i)
+            _lightData[i * lightVec4s + 4] = Vec4(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    void CoreProfileVisitor::apply(Node& node) {
+        collectMaterial(node.getStateSet());
+        traverse(node);
+    }
+
+    void CoreProfileVisitor::apply(Camera& camera) {
+        //every camera has its own view, the uniform is set while it is culled
+        ref_ptr<Uniform> lightViewMatrix = new Uniform(Uniform::FLOAT_MAT4, "lightViewMatrix");
+        lightViewMatrix->setDataVariance(Object::DYNAMIC);
+        camera.getOrCreateStateSet()->addUniform(lightViewMatrix.get());
+        camera.addCullCallback(new LightViewCallback(lightViewMatrix.get()));
+        apply(static_cast<Node&>(camera));
+    }
+
+    void CoreProfileVisitor::apply(Geode& geode) {
+        collectMaterial(geode.getStateSet());
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            Drawable* drawable = geode.getDrawable(i);
+            collectMaterial(drawable->getStateSet());
+            //there are no display lists in the core profile
+            drawable->setUseDisplayList(false);
+            drawable->setUseVertexBufferObjects(true);
+        }
+    }
+
+    void CoreProfileVisitor::apply(LightSource& lightSource) {
+        const Light* light = lightSource.getLight();
+        if (light && light->getLightNum() >= 0 && (unsigned int)light->getLightNum() < numLights) {
+            Matrix localToWorld = lightSource.getReferenceFrame() == LightSource::RELATIVE_RF
+                ? computeLocalToWorld(getNodePath())
+                : Matrix::identity();
+            unsigned int offset = light->getLightNum() * lightVec4s;
+            _lightData[offset + 0] = light->getPosition() * localToWorld;
+            _lightData[offset + 1] = light->getAmbient();
+            _lightData[offset + 2] = light->getDiffuse();
+            _lightData[offset + 3] = light->getSpecular();
+            _lightData[offset + 4] = Vec4(light->getConstantAttenuation(), light->getLinearAttenuation(), light->getQuadraticAttenuation(), 0.0f);
+            //the color and the depth pass share the lights
+            _lightNums.insert(light->getLightNum());
+        }
+        apply(static_cast<Group&>(lightSource));
+    }
+
+    void CoreProfileVisitor::collectMaterial(StateSet* stateSet) {
+        if (!stateSet)
+            return;
+        Material* material = dynamic_cast<Material*>(stateSet->getAttribute(StateAttribute::MATERIAL));
+        if (!material)
+            return;
+        if (_materialIndices.find(material) == _materialIndices.end()) {
+            //index 0 is the default material
+            _materialIndices[material] = _materials.size() + 1;
+            _materials.push_back(material);
+        }
+        _materialStateSets.push_back(stateSet);
+    }
+
+    void CoreProfileVisitor::build(StateSet& root) {
+        ref_ptr<Vec4Array> materialData = new Vec4Array((_materials.size() + 1) * materialStride);
+        ref_ptr<Material> defaultMaterial = new Material;
+        writeMaterial(*materialData, 0, *defaultMaterial);
+        for (unsigned int i = 0; i < _materials.size(); ++i)
+            writeMaterial(*materialData, i + 1, *_materials[i]);
+        ref_ptr<UniformBufferObject> materialBuffer = new UniformBufferObject;
+        materialData->setBufferObject(materialBuffer.get());
+
+        GLsizeiptr materialSize = materialVec4s * sizeof(Vec4);
+        std::map<unsigned int, ref_ptr<UniformBufferBinding>> bindings;
+        for (auto stateSet = _materialStateSets.begin(); stateSet != _materialStateSets.end(); ++stateSet) {
+            StateSet::RefAttributePair* pair = (*stateSet)->getAttributePair(StateAttribute::MATERIAL);
+            if (!pair)
+                continue;
+            unsigned int index = _materialIndices[static_cast<Material*>(pair->first.get())];
+            ref_ptr<UniformBufferBinding>& binding = bindings[index];
+            if (!binding)
+                binding = new UniformBufferBinding(materialBlockBinding, materialBuffer.get(), index * materialStride * sizeof(Vec4), materialSize);
+            StateAttribute::OverrideValue value = pair->second;
+            (*stateSet)->removeAttribute(StateAttribute::MATERIAL);
+            (*stateSet)->setAttribute(binding.get(), value);
+        }
+        root.setAttribute(new UniformBufferBinding(materialBlockBinding, materialBuffer.get(), 0, materialSize));
+
+        ref_ptr<Vec4Array> lightData = new Vec4Array(_lightData.begin(), _lightData.end());
+        ref_ptr<UniformBufferObject> lightBuffer = new UniformBufferObject;
+        lightData->setBufferObject(lightBuffer.get());
+        root.setAttribute(new UniformBufferBinding(lightBlockBinding, lightBuffer.get(), 0, lightData->getTotalDataSize()));
+    }
+
+    void CoreProfileVisitor::bindUniformBlocks(Program& program) {
+        program.addBindUniformBlock("LightBlock", lightBlockBinding);
+        program.addBindUniformBlock("MaterialBlock", materialBlockBinding);
+    }
+
+    void CoreProfileVisitor::requestContext() {
+#if defined(OSG_GL3_AVAILABLE)
+        DisplaySettings::instance()->setGLContextVersion("3.3");
+        //GL_CONTEXT_COMPATIBILITY_PROFILE_BIT, the text HUD and the crosshair still use the fixed function pipeline
+        DisplaySettings::instance()->setGLContextProfileMask(0x2);
+#else
+        OSG_ALWAYS << "OpenSceneGraph is not built for GL3, the core shaders run in a compatibility context." << std::endl;
+#endif
+    }
+
+    GraphicsOperation* CoreProfileVisitor::createRealizeOperation() {
+        return new CoreProfileRealizeOperation;
+    }
+
+    void CoreProfileVisitor::useFixedFunction(Camera& camera) {
+        camera.setPreDrawCallback(new FixedFunctionDrawCallback(true));
+        camera.setPostDrawCallback(new FixedFunctionDrawCallback(false));
+    }
+
+    unsigned int CoreProfileVisitor::getNumMaterials() const {
+        return _materials.size();
+    }
+
+    unsigned int CoreProfileVisitor::getNumLights() const {
+        return _lightNums.size();
+    }
+
+}
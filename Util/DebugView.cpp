@@ -0,0 +1,93 @@
+#include "../header/DebugView.h"
+#include <osg/NodeVisitor>
+#include <osg/ValueObject>
+#include <osgDB/ReadFile>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //all effects, also the flag and the control room, which are not below pipe.toonEffect
+        class CelShadingCollector : public NodeVisitor {
+        public:
+            CelShadingCollector() : NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN) {
+                setNodeMaskOverride(0xffffffff);
+            }
+            virtual void apply(Node& node) {
+                CelShading* effect = dynamic_cast<CelShading*>(&node);
+                if (effect)
+                    effects.push_back(effect);
+                traverse(node);
+            }
+            std::vector<ref_ptr<CelShading>> effects;
+        };
+
+        const char* modeNames[] = { "off", "overdraw", "lights per pixel", "outline coverage" };
+        //count shown red in the heatmap
+        const float maxCounts[] = { 1.0f, 8.0f, 6.0f, 3.0f };
+    }
+
+    DebugView::DebugView(const RenderingPipeline& pipe, unsigned int readbackInterval) :
+        _colorCam(pipe.pass_0_color),
+        _postProcessCam(pipe.pass_PostProcess),
+        _replacedValue(StateAttribute::OVERRIDE | StateAttribute::ON),
+        _mode(CelShading::DEBUG_OFF) {
+        _heatmapProgram = new Program;
+        _heatmapProgram->addShader(osgDB::readShaderFile(shaderFile("fogShader.vert")));
+        _heatmapProgram->addShader(osgDB::readShaderFile(shaderFile("debugHeatmap.frag")));
+        _maxCount = new Uniform("debugMaxCount", 1.0f);
+        _maxCount->setDataVariance(Object::DYNAMIC);
+        _postProcessCam->getOrCreateStateSet()->addUniform(_maxCount);
+
+        _readback = new DebugReadbackCallback(pipe.colorTexture, pipe.pass_0_color, readbackInterval);
+        _colorCam->setFinalDrawCallback(_readback);
+    }
+
+    DebugView::~DebugView() {}
+
+    void DebugView::setMode(CelShading::DebugMode mode) {
+        if (mode == _mode)
+            return;
+        CelShadingCollector collector;
+        _colorCam->accept(collector);
+        for (auto effect = collector.effects.begin(); effect != collector.effects.end(); ++effect)
+            (*effect)->setDebugMode(mode);
+
+        StateSet* stateSet = _postProcessCam->getOrCreateStateSet();
+        if (_mode == CelShading::DEBUG_OFF) {
+            const StateSet::RefAttributePair* active = stateSet->getAttributePair(StateAttribute::PROGRAM);
+            _replacedProgram = active ? dynamic_cast<Program*>(active->first.get()) : nullptr;
+            if (active)
+                _replacedValue = active->second;
+            float fogStart, fogEnd;
+            if (_replacedProgram && _replacedProgram->getUserValue("fogStart", fogStart) && _replacedProgram->getUserValue("fogEnd", fogEnd)) {
+                _heatmapProgram->setUserValue("fogStart", fogStart);
+                _heatmapProgram->setUserValue("fogEnd", fogEnd);
+            }
+        }
+        if (mode == CelShading::DEBUG_OFF) {
+            stateSet->removeAttribute(_heatmapProgram);
+            if (_replacedProgram)
+                stateSet->setAttributeAndModes(_replacedProgram, _replacedValue);
+            _replacedProgram = nullptr;
+        }
+        else {
+            stateSet->setAttributeAndModes(_heatmapProgram, _replacedValue);
+            _maxCount->set(maxCounts[mode]);
+        }
+        _readback->setMode(mode);
+        _mode = mode;
+        OSG_ALWAYS << "Debug view: " << modeNames[mode] << " (" << collector.effects.size() << " effects)" << std::endl;
+    }
+
+    CelShading::DebugMode DebugView::getMode() const {
+        return _mode;
+    }
+
+    CelShading::DebugMode DebugView::nextMode() {
+        setMode(static_cast<CelShading::DebugMode>((_mode + 1) % CelShading::NUM_DEBUG_MODES));
+        return _mode;
+    }
+
+}
@@ -0,0 +1,49 @@
+#include "../header/FontManager.h"
+#include <OpenThreads/ScopedLock>
+
+using namespace osg;
+
+namespace brtr {
+
+    FontManager& FontManager::instance() {
+        static FontManager manager;
+        return manager;
+    }
+
+    osgText::Font* FontManager::getFont(const std::string& fileName) {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        auto found = _fonts.find(fileName);
+        if (found != _fonts.end())
+            return found->second.get();
+
+        ref_ptr<osgText::Font> font = osgText::readFontFile(fileName);
+        if (!font) {
+            OSG_ALWAYS << "Could not read font " << fileName << std::endl;
+            return nullptr;
+        }
+        //one page for all glyphs, so the HUD binds only one texture
+        font->setTextureSizeHint(atlasSize, atlasSize);
+        std::string ascii;
+        for (char c = 32; c < 127; ++c)
+            ascii += c;
+        preloadGlyphs(font, ascii);
+        _fonts[fileName] = font;
+        return font.get();
+    }
+
+    void FontManager::preloadGlyphs(const std::string& fileName, const std::string& characters) {
+        osgText::Font* font = getFont(fileName);
+        if (!font)
+            return;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        preloadGlyphs(font, characters);
+    }
+
+    void FontManager::preloadGlyphs(osgText::Font* font, const std::string& characters) {
+        osgText::FontResolution resolution(glyphResolution, glyphResolution);
+        for (auto c = characters.begin(); c != characters.end(); ++c)
+            //getGlyph rasterizes the glyph and places it in the font's glyph texture
+            font->getGlyph(resolution, (unsigned char)*c);
+    }
+
+}
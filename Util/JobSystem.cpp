@@ -0,0 +1,210 @@
+#include "../header/JobSystem.h"
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+
+using namespace osg;
+
+namespace brtr {
+
+    Job::Job(const std::function<void()>& work) :
+        _work(work),
+        _pending(1),
+        _done(false) {}
+
+    void Job::dependsOn(Job* dependency) {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(dependency->_mutex);
+        if (dependency->_done)
+            return;
+        ++_pending;
+        dependency->_dependents.push_back(this);
+    }
+
+    bool Job::isDone() const {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        return _done;
+    }
+
+    class JobSystem::Worker : public OpenThreads::Thread {
+    public:
+        Worker(JobSystem& system, unsigned int index) : _system(system), _index(index) {}
+        unsigned int getIndex() const { return _index; }
+        virtual void run() {
+            while (!_system._quit) {
+                if (_system.runOne(_index))
+                    continue;
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_system._wakeMutex);
+                //the timeout covers a job queued between the check and the wait
+                if (_system._numQueued == 0 && !_system._quit)
+                    _system._wake.wait(&_system._wakeMutex, 10);
+            }
+        }
+    private:
+        JobSystem& _system;
+        unsigned int _index;
+    };
+
+    JobSystem& JobSystem::instance() {
+        static JobSystem system;
+        return system;
+    }
+
+    JobSystem::JobSystem() :
+        _numQueued(0),
+        _nextSlot(0),
+        _quit(false),
+        _statsStart(Timer::instance()->tick()) {
+        //the main thread helps while waiting
+        unsigned int numWorkers = std::max(OpenThreads::GetNumberOfProcessors() - 1, 1);
+        for (unsigned int i = 0; i <= numWorkers; ++i) {
+            _slots.push_back(new Slot);
+            _slots.back()->stats = WorkerStats();
+        }
+        for (unsigned int i = 0; i < numWorkers; ++i) {
+            _workers.push_back(new Worker(*this, i));
+            _workers.back()->start();
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_wakeMutex);
+            _quit = true;
+            _wake.broadcast();
+        }
+        for (auto worker = _workers.begin(); worker != _workers.end(); ++worker) {
+            (*worker)->join();
+            delete *worker;
+        }
+        for (auto slot = _slots.begin(); slot != _slots.end(); ++slot)
+            delete *slot;
+    }
+
+    ref_ptr<Job> JobSystem::submit(Job* job) {
+        //referenced before it is queued, a worker may be done with it before submit returns
+        ref_ptr<Job> submitted = job;
+        if (--job->_pending == 0)
+            enqueue(job);
+        return submitted;
+    }
+
+    ref_ptr<Job> JobSystem::submit(const std::function<void()>& work) {
+        return submit(new Job(work));
+    }
+
+    void JobSystem::enqueue(Job* job) {
+        unsigned int worker = getCurrentWorker();
+        if (worker == _workers.size())
+            worker = (_nextSlot++) % _workers.size();
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_slots[worker]->mutex);
+            _slots[worker]->jobs.push_back(job);
+        }
+        ++_numQueued;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_wakeMutex);
+        _wake.signal();
+    }
+
+    bool JobSystem::runOne(unsigned int worker) {
+        ref_ptr<Job> job;
+        bool stolen = false;
+        if (worker < _workers.size()) {
+            Slot& own = *_slots[worker];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(own.mutex);
+            if (!own.jobs.empty()) {
+                job = own.jobs.back();
+                own.jobs.pop_back();
+            }
+        }
+        //steal the oldest job, starting at the neighbour to spread the thieves
+        for (unsigned int i = 1; !job.valid() && i <= _workers.size(); ++i) {
+            Slot& victim = *_slots[(worker + i) % _workers.size()];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = victim.jobs.front();
+                victim.jobs.pop_front();
+                stolen = worker < _workers.size();
+            }
+        }
+        if (!job.valid())
+            return false;
+        --_numQueued;
+
+        Timer_t start = Timer::instance()->tick();
+        //the job must finish in any case, wait() would spin forever
+        if (!job->_exception) {
+            try {
+                job->_work();
+            }
+            catch (...) {
+                job->_exception = std::current_exception();
+            }
+        }
+        double busy = Timer::instance()->delta_s(start, Timer::instance()->tick());
+        finish(job.get());
+
+        Slot& slot = *_slots[worker];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(slot.mutex);
+        slot.stats.numJobs++;
+        slot.stats.numStolen += stolen ? 1 : 0;
+        slot.stats.busyTime += busy;
+        return true;
+    }
+
+    void JobSystem::finish(Job* job) {
+        std::vector<ref_ptr<Job>> dependents;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(job->_mutex);
+            job->_done = true;
+            dependents.swap(job->_dependents);
+        }
+        for (auto dependent = dependents.begin(); dependent != dependents.end(); ++dependent) {
+            if (job->_exception) {
+                //other dependencies may fail at the same time
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*dependent)->_mutex);
+                if (!(*dependent)->_exception)
+                    (*dependent)->_exception = job->_exception;
+            }
+            if (--(*dependent)->_pending == 0)
+                enqueue(dependent->get());
+        }
+    }
+
+    void JobSystem::wait(Job* job) {
+        unsigned int worker = getCurrentWorker();
+        while (!job->isDone()) {
+            if (!runOne(worker))
+                OpenThreads::Thread::YieldCurrentThread();
+        }
+        //isDone() locked the mutex finish() wrote _done under, the exception is visible
+        if (job->_exception)
+            std::rethrow_exception(job->_exception);
+    }
+
+    unsigned int JobSystem::getCurrentWorker() const {
+        Worker* worker = dynamic_cast<Worker*>(OpenThreads::Thread::CurrentThread());
+        return worker && worker->getIndex() < _workers.size() && _workers[worker->getIndex()] == worker
+            ? worker->getIndex() : _workers.size();
+    }
+
+    unsigned int JobSystem::getNumWorkers() const {
+        return _workers.size();
+    }
+
+    JobSystem::WorkerStats JobSystem::getStats(unsigned int worker) const {
+        Slot& slot = *_slots[std::min(worker, (unsigned int)_workers.size())];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(slot.mutex);
+        WorkerStats stats = slot.stats;
+        double elapsed = Timer::instance()->delta_s(_statsStart, Timer::instance()->tick());
+        stats.utilization = elapsed > 0.0 ? stats.busyTime / elapsed : 0.0;
+        return stats;
+    }
+
+    void JobSystem::resetStats() {
+        for (auto slot = _slots.begin(); slot != _slots.end(); ++slot) {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock((*slot)->mutex);
+            (*slot)->stats = WorkerStats();
+        }
+        _statsStart = Timer::instance()->tick();
+    }
+
+}
@@ -0,0 +1,106 @@
+#include "../header/LODBuilder.h"
+#include "../header/UtilFunctions.h"
+#include <osg/LOD>
+#include <osg/NodeVisitor>
+#include <osg/TriangleIndexFunctor>
+#include <cfloat>
+#include <set>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        struct GeodeCollector : public NodeVisitor {
+            GeodeCollector() : NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+            virtual void apply(Geode& geode) {
+                //shared geodes only once
+                if (visited.insert(&geode).second)
+                    geodes.push_back(&geode);
+            }
+            std::vector<ref_ptr<Geode>> geodes;
+            std::set<Geode*> visited;
+        };
+
+        struct TriangleCounter {
+            unsigned int count;
+            TriangleCounter() : count(0) {}
+            void operator()(unsigned int, unsigned int, unsigned int) {
+                count++;
+            }
+        };
+    }
+
+    LODBuilder::LODBuilder(unsigned int minTriangles) :
+        _minTriangles(minTriangles),
+        _numLODs(0) {}
+
+    LODBuilder& LODBuilder::addLevel(float ratio, float pixelSize) {
+        Level level;
+        level.ratio = ratio;
+        level.pixelSize = pixelSize;
+        _levels.push_back(level);
+        return *this;
+    }
+
+    ref_ptr<Node> LODBuilder::build(Node* root) {
+        ref_ptr<Node> result = root;
+        if (!root || _levels.empty())
+            return result;
+        GeodeCollector collector;
+        root->accept(collector);
+
+        for (auto geode = collector.geodes.begin(); geode != collector.geodes.end(); ++geode) {
+            if (countTriangles(**geode) < _minTriangles)
+                continue;
+            ref_ptr<LOD> lod = new LOD;
+            lod->setName((*geode)->getName());
+            lod->setRangeMode(LOD::PIXEL_SIZE_ON_SCREEN);
+            //the parent list changes while replacing
+            Node::ParentList parents = (*geode)->getParents();
+            for (auto parent = parents.begin(); parent != parents.end(); ++parent)
+                (*parent)->replaceChild(geode->get(), lod.get());
+            if (geode->get() == root)
+                result = lod;
+
+            lod->addChild(geode->get(), _levels.front().pixelSize, FLT_MAX);
+            for (unsigned int i = 0; i < _levels.size(); ++i) {
+                //own arrays, the VertexCacheVisitor skips shared ones
+                ref_ptr<Geode> level = new Geode(**geode, CopyOp::DEEP_COPY_DRAWABLES | CopyOp::DEEP_COPY_ARRAYS
+                                                 | CopyOp::DEEP_COPY_PRIMITIVES);
+                for (unsigned int j = 0; j < level->getNumDrawables(); ++j) {
+                    Geometry* geometry = level->getDrawable(j)->asGeometry();
+                    if (!geometry)
+                        continue;
+                    _simplifier.simplify(*geometry, _levels[i].ratio);
+                    //coarse levels are never intersected
+                    geometry->setShape(nullptr);
+                }
+                level->setNodeMask((*geode)->getNodeMask() & ~interactionAndCollisionMask);
+                float minPixelSize = i + 1 < _levels.size() ? _levels[i + 1].pixelSize : 0.0f;
+                lod->addChild(level, minPixelSize, _levels[i].pixelSize);
+            }
+            _numLODs++;
+        }
+        return result;
+    }
+
+    unsigned int LODBuilder::countTriangles(Geode& geode) const {
+        TriangleIndexFunctor<TriangleCounter> counter;
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            Geometry* geometry = geode.getDrawable(i)->asGeometry();
+            if (geometry)
+                geometry->accept(counter);
+        }
+        return counter.count;
+    }
+
+    unsigned int LODBuilder::getNumLODs() const {
+        return _numLODs;
+    }
+
+    const MeshSimplifier& LODBuilder::getSimplifier() const {
+        return _simplifier;
+    }
+
+}
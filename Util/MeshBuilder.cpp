@@ -0,0 +1,207 @@
+#include "../header/MeshBuilder.h"
+#include "../header/UtilFunctions.h"
+#include "../header/TriangleCollector.h"
+#include <osg/TriangleIndexFunctor>
+
+using namespace osg;
+
+namespace brtr {
+
+    MeshBuilder::MeshBuilder(unsigned int reserveVertices, unsigned int reserveIndices) :
+        _reserveVertices(reserveVertices),
+        _reserveIndices(reserveIndices),
+        _current(0) {
+        _transforms.push_back(Matrix::identity());
+        setStateSet(nullptr);
+    }
+
+    MeshBuilder& MeshBuilder::setStateSet(StateSet* stateSet) {
+        for (unsigned int i = 0; i < _batches.size(); ++i) {
+            if (_batches[i].stateSet == stateSet) {
+                _current = i;
+                return *this;
+            }
+        }
+        Batch batch;
+        batch.stateSet = stateSet;
+        batch.vertices = new Vec3Array;
+        batch.vertices->reserve(_reserveVertices);
+        batch.normals = new Vec3Array;
+        batch.normals->reserve(_reserveVertices);
+        batch.indices = new DrawElementsUInt(GL_TRIANGLES);
+        batch.indices->reserve(_reserveIndices);
+        _batches.push_back(batch);
+        _current = _batches.size() - 1;
+        return *this;
+    }
+
+    MeshBuilder& MeshBuilder::pushTransform(const Matrix& matrix) {
+        _transforms.push_back(matrix * _transforms.back());
+        return *this;
+    }
+
+    MeshBuilder& MeshBuilder::popTransform() {
+        if (_transforms.size() > 1)
+            _transforms.pop_back();
+        return *this;
+    }
+
+    const Matrix& MeshBuilder::getTransform() const {
+        return _transforms.back();
+    }
+
+    MeshBuilder& MeshBuilder::addRectangle(double length, double width, int lsteps, int wsteps, bool texcoords) {
+        ref_ptr<Vec3Array> vertices = new Vec3Array;
+        ref_ptr<Vec3Array> normals = new Vec3Array;
+        ref_ptr<Vec2Array> coords = texcoords ? new Vec2Array : nullptr;
+        vertices->reserve((lsteps + 1) * (wsteps + 1));
+        normals->reserve((lsteps + 1) * (wsteps + 1));
+        if (coords)
+            coords->reserve((lsteps + 1) * (wsteps + 1));
+
+        double xstep = length / lsteps;
+        double ystep = width / wsteps;
+        //texture coordinates like createRectangleWithTexcoords
+        double coordlen = width / length < 0.25 ? 1 : length;
+        double coordwid = length / width < 0.25 ? 1 : width;
+        for (int i = 0; i <= lsteps; i++) {
+            for (int j = 0; j <= wsteps; j++) {
+                vertices->push_back(Vec3(i * xstep, j * ystep, 0));
+                normals->push_back(Vec3(0, 0, 1));
+                if (coords)
+                    coords->push_back(Vec2(i * xstep / coordlen, j * ystep / coordwid));
+            }
+        }
+
+        //two triangles per cell, same winding as the strips of createRectangle
+        std::vector<unsigned int> indices;
+        indices.reserve(lsteps * wsteps * 6);
+        for (int i = 0; i < lsteps; i++) {
+            for (int j = 0; j < wsteps; j++) {
+                unsigned int a0 = i * (wsteps + 1) + j;
+                unsigned int b0 = (i + 1) * (wsteps + 1) + j;
+                indices.push_back(a0);
+                indices.push_back(b0);
+                indices.push_back(a0 + 1);
+                indices.push_back(a0 + 1);
+                indices.push_back(b0);
+                indices.push_back(b0 + 1);
+            }
+        }
+        append(*vertices, normals.get(), coords.get(), indices);
+        return *this;
+    }
+
+    MeshBuilder& MeshBuilder::addCuboid(double length, double width, double height, double factor) {
+        int lsteps = (int)(length * factor) + 1;
+        int wsteps = (int)(width * factor) + 1;
+        int hsteps = (int)(height * factor) + 1;
+
+        pushTransform(Matrix::translate(0, 0, height));
+        addRectangle(length, width, lsteps, wsteps);
+        popTransform();
+        pushTransform(Matrix::rotate((3 / 2)*PI, 1, 0, 0)*Matrix::translate(0.0f, width, 0));
+        addRectangle(length, width, lsteps, wsteps);
+        popTransform();
+
+        pushTransform(Matrix::rotate(PI / 2, 0, 1, 0)*Matrix::translate(length, 0, height));
+        addRectangle(height, width, hsteps, wsteps);
+        popTransform();
+        pushTransform(Matrix::rotate((PI / 2) * 3, 0, 1, 0));
+        addRectangle(height, width, hsteps, wsteps);
+        popTransform();
+
+        pushTransform(Matrix::rotate((PI / 2), 0, 0, 1)*Matrix::rotate((PI / 2), 1, 0, 0)*Matrix::translate(length, 0, 0));
+        addRectangle(height, length, hsteps, lsteps);
+        popTransform();
+        pushTransform(Matrix::rotate((PI / 2) * 3, 0, 0, 1)*Matrix::rotate((PI / 2) * 3, 1, 0, 0)*Matrix::translate(0, width, 0));
+        addRectangle(height, length, hsteps, lsteps);
+        popTransform();
+        return *this;
+    }
+
+    MeshBuilder& MeshBuilder::addGeometry(const Geometry& geometry) {
+        const Vec3Array* vertices = dynamic_cast<const Vec3Array*>(geometry.getVertexArray());
+        if (!vertices)
+            return *this;
+        const Vec3Array* normals = dynamic_cast<const Vec3Array*>(geometry.getNormalArray());
+        if (normals && normals->size() != vertices->size())
+            normals = nullptr;
+        const Vec2Array* texcoords = dynamic_cast<const Vec2Array*>(geometry.getTexCoordArray(0));
+        if (texcoords && texcoords->size() != vertices->size())
+            texcoords = nullptr;
+
+        std::vector<unsigned int> indices;
+        TriangleIndexFunctor<TriangleCollector> collector;
+        collector.indices = &indices;
+        geometry.accept(collector);
+        append(*vertices, normals, texcoords, indices);
+        return *this;
+    }
+
+    MeshBuilder& MeshBuilder::addMesh(const MeshBuilder& mesh) {
+        for (auto batch = mesh._batches.begin(); batch != mesh._batches.end(); ++batch) {
+            if (batch->vertices->empty())
+                continue;
+            setStateSet(batch->stateSet.get());
+            std::vector<unsigned int> indices(batch->indices->begin(), batch->indices->end());
+            append(*batch->vertices, batch->normals.get(), batch->texcoords.get(), indices);
+        }
+        return *this;
+    }
+
+    void MeshBuilder::append(const Vec3Array& vertices, const Vec3Array* normals, const Vec2Array* texcoords,
+                             const std::vector<unsigned int>& indices) {
+        Batch& batch = _batches[_current];
+        const Matrix& matrix = _transforms.back();
+        //normals are transformed with the inverse transpose
+        Matrix inverse = Matrix::inverse(matrix);
+        unsigned int base = batch.vertices->size();
+
+        for (unsigned int i = 0; i < vertices.size(); ++i) {
+            Vec3 vertex = vertices[i] * matrix;
+            batch.vertices->push_back(vertex);
+            _bound.expandBy(vertex);
+            Vec3 normal = Matrix::transform3x3(inverse, normals ? (*normals)[i] : Vec3(0, 0, 1));
+            normal.normalize();
+            batch.normals->push_back(normal);
+        }
+
+        //texture coordinates only for batches which need them, the others get zeros
+        if (texcoords && !batch.texcoords)
+            batch.texcoords = new Vec2Array(base);
+        if (batch.texcoords) {
+            for (unsigned int i = 0; i < vertices.size(); ++i)
+                batch.texcoords->push_back(texcoords ? (*texcoords)[i] : Vec2());
+        }
+
+        for (auto index = indices.begin(); index != indices.end(); ++index)
+            batch.indices->push_back(base + *index);
+    }
+
+    const BoundingBox& MeshBuilder::getBound() const {
+        return _bound;
+    }
+
+    ref_ptr<Geode> MeshBuilder::build() const {
+        ref_ptr<Geode> geode = new Geode;
+        for (auto batch = _batches.begin(); batch != _batches.end(); ++batch) {
+            if (batch->indices->empty())
+                continue;
+            ref_ptr<Geometry> geometry = new Geometry;
+            //copies, so the builder can go on
+            geometry->setVertexArray(new Vec3Array(*batch->vertices));
+            geometry->setNormalArray(new Vec3Array(*batch->normals));
+            //i know, deprecated, but osg 3.0.1
+            geometry->setNormalBinding(Geometry::BIND_PER_VERTEX);
+            if (batch->texcoords)
+                geometry->setTexCoordArray(0, new Vec2Array(*batch->texcoords));
+            geometry->addPrimitiveSet(new DrawElementsUInt(*batch->indices));
+            if (batch->stateSet)
+                geometry->setStateSet(batch->stateSet.get());
+            geode->addDrawable(geometry);
+        }
+        return geode;
+    }
+
+}
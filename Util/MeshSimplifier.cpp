@@ -0,0 +1,295 @@
+#include "../header/MeshSimplifier.h"
+#include "../header/TriangleCollector.h"
+#include <osg/TriangleIndexFunctor>
+#include <map>
+#include <set>
+#include <queue>
+#include <vector>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //symmetric 4x4 matrix of the plane equations, only the upper triangle is stored
+        struct Quadric {
+            double q[10];
+            Quadric() {
+                for (unsigned int i = 0; i < 10; ++i)
+                    q[i] = 0.0;
+            }
+            Quadric(const Vec3d& n, double d, double weight) {
+                q[0] = n.x() * n.x() * weight; q[1] = n.x() * n.y() * weight; q[2] = n.x() * n.z() * weight;
+                q[3] = n.x() * d * weight;     q[4] = n.y() * n.y() * weight; q[5] = n.y() * n.z() * weight;
+                q[6] = n.y() * d * weight;     q[7] = n.z() * n.z() * weight; q[8] = n.z() * d * weight;
+                q[9] = d * d * weight;
+            }
+            Quadric& operator+=(const Quadric& other) {
+                for (unsigned int i = 0; i < 10; ++i)
+                    q[i] += other.q[i];
+                return *this;
+            }
+            double error(const Vec3d& v) const {
+                double x = v.x(), y = v.y(), z = v.z();
+                return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                    + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                    + q[7] * z * z + 2 * q[8] * z
+                    + q[9];
+            }
+        };
+
+        struct Collapse {
+            double cost;
+            unsigned int from;
+            unsigned int to;
+            unsigned int fromVersion;
+            unsigned int toVersion;
+            //priority_queue is a max heap, the cheapest collapse has to be on top
+            bool operator<(const Collapse& other) const { return cost > other.cost; }
+        };
+
+        bool isTriangleMode(GLenum mode) {
+            return mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN
+                || mode == GL_QUADS || mode == GL_QUAD_STRIP || mode == GL_POLYGON;
+        }
+    }
+
+    MeshSimplifier::MeshSimplifier(double boundaryWeight) :
+        _boundaryWeight(boundaryWeight),
+        _trianglesBefore(0),
+        _trianglesAfter(0) {}
+
+    bool MeshSimplifier::simplify(Geometry& geometry, float ratio) {
+        Vec3Array* vertices = dynamic_cast<Vec3Array*>(geometry.getVertexArray());
+        if (!vertices || geometry.getDataVariance() == Object::DYNAMIC || !geometry.suitableForOptimization())
+            return false;
+        for (unsigned int i = 0; i < geometry.getNumPrimitiveSets(); ++i) {
+            if (!isTriangleMode(geometry.getPrimitiveSet(i)->getMode()))
+                return false;
+        }
+        std::vector<unsigned int> corners;
+        TriangleIndexFunctor<TriangleCollector> collector;
+        collector.indices = &corners;
+        geometry.accept(collector);
+        unsigned int numTriangles = corners.size() / 3;
+        unsigned int targetTriangles = maximum(1u, (unsigned int)(numTriangles * ratio));
+        if (targetTriangles >= numTriangles)
+            return false;
+
+        //topology works on welded positions, corners keep the original vertex for the attributes
+        std::map<Vec3, unsigned int> positionIds;
+        std::vector<unsigned int> positionId(vertices->size());
+        std::vector<Vec3d> positions;
+        for (unsigned int i = 0; i < vertices->size(); ++i) {
+            auto inserted = positionIds.insert(std::make_pair((*vertices)[i], (unsigned int)positions.size()));
+            if (inserted.second)
+                positions.push_back(Vec3d((*vertices)[i]));
+            positionId[i] = inserted.first->second;
+        }
+        std::vector<unsigned int> welded(corners.size());
+        for (unsigned int i = 0; i < corners.size(); ++i)
+            welded[i] = positionId[corners[i]];
+
+        std::vector<bool> deleted(numTriangles, false);
+        std::vector<std::vector<unsigned int>> vertexTriangles(positions.size());
+        std::vector<Quadric> quadrics(positions.size());
+        std::vector<Vec3d> normals(numTriangles);
+        unsigned int liveTriangles = 0;
+        for (unsigned int t = 0; t < numTriangles; ++t) {
+            unsigned int* w = &welded[3 * t];
+            if (w[0] == w[1] || w[1] == w[2] || w[0] == w[2]) {
+                deleted[t] = true;
+                continue;
+            }
+            liveTriangles++;
+            Vec3d normal = (positions[w[1]] - positions[w[0]]) ^ (positions[w[2]] - positions[w[0]]);
+            double area = normal.normalize() * 0.5;
+            normals[t] = normal;
+            Quadric quadric(normal, -(normal * positions[w[0]]), area);
+            for (unsigned int k = 0; k < 3; ++k) {
+                quadrics[w[k]] += quadric;
+                vertexTriangles[w[k]].push_back(t);
+            }
+        }
+
+        //edges with only one triangle are borders, perpendicular planes keep them in place
+        std::map<std::pair<unsigned int, unsigned int>, unsigned int> edges;
+        for (unsigned int t = 0; t < numTriangles; ++t) {
+            if (deleted[t])
+                continue;
+            for (unsigned int k = 0; k < 3; ++k) {
+                unsigned int a = welded[3 * t + k], b = welded[3 * t + (k + 1) % 3];
+                edges[std::make_pair(minimum(a, b), maximum(a, b))]++;
+            }
+        }
+        for (unsigned int t = 0; t < numTriangles; ++t) {
+            if (deleted[t])
+                continue;
+            for (unsigned int k = 0; k < 3; ++k) {
+                unsigned int a = welded[3 * t + k], b = welded[3 * t + (k + 1) % 3];
+                if (edges[std::make_pair(minimum(a, b), maximum(a, b))] != 1)
+                    continue;
+                Vec3d edge = positions[b] - positions[a];
+                Vec3d normal = edge ^ normals[t];
+                if (normal.normalize() == 0.0)
+                    continue;
+                Quadric quadric(normal, -(normal * positions[a]), _boundaryWeight * edge.length2());
+                quadrics[a] += quadric;
+                quadrics[b] += quadric;
+            }
+        }
+
+        std::vector<unsigned int> version(positions.size(), 0);
+        std::vector<bool> removed(positions.size(), false);
+        std::priority_queue<Collapse> heap;
+        auto pushCollapse = [&](unsigned int a, unsigned int b) {
+            Quadric quadric = quadrics[a];
+            quadric += quadrics[b];
+            double errorA = quadric.error(positions[a]);
+            double errorB = quadric.error(positions[b]);
+            Collapse collapse;
+            collapse.from = errorA <= errorB ? b : a;
+            collapse.to = errorA <= errorB ? a : b;
+            collapse.cost = minimum(errorA, errorB);
+            collapse.fromVersion = version[collapse.from];
+            collapse.toVersion = version[collapse.to];
+            heap.push(collapse);
+        };
+        for (auto edge = edges.begin(); edge != edges.end(); ++edge)
+            pushCollapse(edge->first.first, edge->first.second);
+
+        const Vec3Array* vertexNormals = dynamic_cast<const Vec3Array*>(geometry.getNormalArray());
+        if (vertexNormals && (geometry.getNormalBinding() != Geometry::BIND_PER_VERTEX || vertexNormals->size() != vertices->size()))
+            vertexNormals = nullptr;
+
+        while (liveTriangles > targetTriangles && !heap.empty()) {
+            Collapse collapse = heap.top();
+            heap.pop();
+            unsigned int from = collapse.from, to = collapse.to;
+            if (removed[from] || removed[to] || version[from] != collapse.fromVersion || version[to] != collapse.toVersion)
+                continue;
+
+            //reject collapses which flip (or nearly flip) a remaining triangle
+            bool valid = true;
+            std::vector<unsigned int>& fromTriangles = vertexTriangles[from];
+            for (auto t = fromTriangles.begin(); t != fromTriangles.end() && valid; ++t) {
+                const unsigned int* w = &welded[3 * *t];
+                if (deleted[*t] || w[0] == to || w[1] == to || w[2] == to)
+                    continue;
+                Vec3d p[3];
+                for (unsigned int k = 0; k < 3; ++k)
+                    p[k] = positions[w[k] == from ? to : w[k]];
+                Vec3d normal = (p[1] - p[0]) ^ (p[2] - p[0]);
+                valid = normal.normalize() > 0.0 && normal * normals[*t] > 0.2;
+            }
+            if (!valid)
+                continue;
+
+            //original vertices at the target position, preferably the partner on a collapsed triangle
+            std::set<unsigned int> candidates;
+            std::vector<unsigned int>& toTriangles = vertexTriangles[to];
+            for (auto t = toTriangles.begin(); t != toTriangles.end(); ++t) {
+                for (unsigned int k = 0; !deleted[*t] && k < 3; ++k) {
+                    if (welded[3 * *t + k] == to)
+                        candidates.insert(corners[3 * *t + k]);
+                }
+            }
+            if (candidates.empty())
+                continue;
+            std::map<unsigned int, unsigned int> partners;
+            for (auto t = fromTriangles.begin(); t != fromTriangles.end(); ++t) {
+                unsigned int* w = &welded[3 * *t];
+                if (deleted[*t] || (w[0] != to && w[1] != to && w[2] != to))
+                    continue;
+                unsigned int fromCorner = 0, toCorner = 0;
+                for (unsigned int k = 0; k < 3; ++k) {
+                    if (w[k] == from)
+                        fromCorner = corners[3 * *t + k];
+                    else if (w[k] == to)
+                        toCorner = corners[3 * *t + k];
+                }
+                partners[fromCorner] = toCorner;
+                deleted[*t] = true;
+                liveTriangles--;
+            }
+
+            for (auto t = fromTriangles.begin(); t != fromTriangles.end(); ++t) {
+                if (deleted[*t])
+                    continue;
+                for (unsigned int k = 0; k < 3; ++k) {
+                    if (welded[3 * *t + k] != from)
+                        continue;
+                    unsigned int corner = corners[3 * *t + k];
+                    auto partner = partners.find(corner);
+                    unsigned int replacement = partner != partners.end() ? partner->second : *candidates.begin();
+                    if (partner == partners.end() && vertexNormals) {
+                        //the candidate with the most similar normal, keeps hard edges hard
+                        double best = -2.0;
+                        for (auto candidate = candidates.begin(); candidate != candidates.end(); ++candidate) {
+                            double similarity = (*vertexNormals)[corner] * (*vertexNormals)[*candidate];
+                            if (similarity > best) {
+                                best = similarity;
+                                replacement = *candidate;
+                            }
+                        }
+                    }
+                    corners[3 * *t + k] = replacement;
+                    welded[3 * *t + k] = to;
+                }
+                Vec3d normal = (positions[welded[3 * *t + 1]] - positions[welded[3 * *t]])
+                    ^ (positions[welded[3 * *t + 2]] - positions[welded[3 * *t]]);
+                normal.normalize();
+                normals[*t] = normal;
+                toTriangles.push_back(*t);
+            }
+            fromTriangles.clear();
+            quadrics[to] += quadrics[from];
+            removed[from] = true;
+            version[to]++;
+
+            //the costs of all edges at the target changed
+            std::vector<unsigned int> liveToTriangles;
+            std::set<unsigned int> neighbours;
+            for (auto t = toTriangles.begin(); t != toTriangles.end(); ++t) {
+                if (deleted[*t])
+                    continue;
+                liveToTriangles.push_back(*t);
+                for (unsigned int k = 0; k < 3; ++k) {
+                    if (welded[3 * *t + k] != to)
+                        neighbours.insert(welded[3 * *t + k]);
+                }
+            }
+            toTriangles.swap(liveToTriangles);
+            for (auto neighbour = neighbours.begin(); neighbour != neighbours.end(); ++neighbour)
+                pushCollapse(to, *neighbour);
+        }
+
+        ref_ptr<DrawElementsUInt> triangles = new DrawElementsUInt(GL_TRIANGLES);
+        triangles->reserve(liveTriangles * 3);
+        for (unsigned int t = 0; t < numTriangles; ++t) {
+            if (deleted[t])
+                continue;
+            for (unsigned int k = 0; k < 3; ++k)
+                triangles->push_back(corners[3 * t + k]);
+        }
+        _trianglesBefore += numTriangles;
+        _trianglesAfter += liveTriangles;
+
+        geometry.removePrimitiveSet(0, geometry.getNumPrimitiveSets());
+        geometry.addPrimitiveSet(triangles.get());
+        //the KdTree stores the old triangles
+        geometry.setShape(nullptr);
+        geometry.dirtyDisplayList();
+        geometry.dirtyBound();
+        return true;
+    }
+
+    unsigned int MeshSimplifier::getNumTrianglesBefore() const {
+        return _trianglesBefore;
+    }
+
+    unsigned int MeshSimplifier::getNumTrianglesAfter() const {
+        return _trianglesAfter;
+    }
+
+}
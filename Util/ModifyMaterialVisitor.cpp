@@ -14,7 +14,11 @@ namespace brtr{
     void ModifyMaterialVisitor::apply(osg::Geode& geode) {
         for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
             osg::Drawable* drawable = geode.getDrawable(i);
-            osg::Material* materialPtr = dynamic_cast<osg::Material*>(drawable->getOrCreateStateSet()->getAttribute(osg::StateAttribute::Type::MATERIAL));
+            //no StateSet means no Material, do not create an empty one
+            osg::StateSet* stateSet = drawable->getStateSet();
+            if (!stateSet)
+                continue;
+            osg::Material* materialPtr = dynamic_cast<osg::Material*>(stateSet->getAttribute(osg::StateAttribute::MATERIAL));
             if (materialPtr) {
                 osg::Material& material = *materialPtr;
                 if (_ambientFlag)
@@ -0,0 +1,173 @@
+#include "../header/ProgramBinaryCache.h"
+#include <osg/GL2Extensions>
+#include <osg/Notify>
+#include <osgDB/FileUtils>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //FNV-1a, unlike std::hash the same in every run
+        unsigned long long fnv1a(const std::string& text) {
+            unsigned long long hash = 14695981039346656037ULL;
+            for (auto c = text.begin(); c != text.end(); ++c) {
+                hash ^= (unsigned char)*c;
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+    }
+
+    class ProgramBinaryLoadOperation : public GraphicsOperation {
+    public:
+        ProgramBinaryLoadOperation(ProgramBinaryCache* cache, Operation* next) :
+            GraphicsOperation("ProgramBinaryLoadOperation", false),
+            _cache(cache),
+            _next(next) {}
+        virtual void operator()(GraphicsContext* gc) {
+            if (_next.valid())
+                (*_next)(gc);
+            _cache->load(*gc);
+        }
+    private:
+        ref_ptr<ProgramBinaryCache> _cache;
+        ref_ptr<Operation> _next;
+    };
+
+    class ProgramBinarySaveOperation : public GraphicsOperation {
+    public:
+        ProgramBinarySaveOperation(ProgramBinaryCache* cache) :
+            GraphicsOperation("ProgramBinarySaveOperation", false),
+            _cache(cache) {}
+        virtual void operator()(GraphicsContext* gc) {
+            _cache->save(*gc);
+        }
+    private:
+        ref_ptr<ProgramBinaryCache> _cache;
+    };
+
+    ProgramBinaryCache::ProgramBinaryCache(const std::string& path) :
+        _path(path),
+        _numLoaded(0),
+        _numSaved(0) {}
+
+    void ProgramBinaryCache::add(Program* program) {
+        if (program && program->getNumShaders() > 0 && !_programs.count(program))
+            _programs[program] = getKey(*program);
+    }
+
+    std::string ProgramBinaryCache::getKey(const Program& program) const {
+        std::ostringstream source;
+        for (unsigned int i = 0; i < program.getNumShaders(); ++i)
+            source << program.getShader(i)->getType() << program.getShader(i)->getShaderSource();
+        //the attribute locations are part of the link
+        const Program::AttribBindingList& bindings = program.getAttribBindingList();
+        for (auto binding = bindings.begin(); binding != bindings.end(); ++binding)
+            source << binding->first << binding->second;
+        std::ostringstream key;
+        key << std::hex << fnv1a(source.str());
+        return key.str();
+    }
+
+    std::string ProgramBinaryCache::getSignature() const {
+        std::ostringstream signature;
+        signature << glGetString(GL_VENDOR) << "\n" << glGetString(GL_RENDERER) << "\n" << glGetString(GL_VERSION) << "\n";
+        return signature.str();
+    }
+
+    void ProgramBinaryCache::load(GraphicsContext& gc) {
+        unsigned int contextID = gc.getState()->getContextID();
+        if (!GL2Extensions::Get(contextID, true)->isGetProgramBinarySupported()) {
+            OSG_ALWAYS << "No GL_ARB_get_program_binary, the programs are not cached." << std::endl;
+            return;
+        }
+        std::ifstream signatureFile((_path + "/signature.txt").c_str(), std::ios::binary);
+        std::string signature((std::istreambuf_iterator<char>(signatureFile)), std::istreambuf_iterator<char>());
+        if (signature != getSignature()) {
+            //written by another driver, a program failing to link now must not find its old binary next time
+            for (auto program = _programs.begin(); program != _programs.end(); ++program)
+                std::remove((_path + "/" + program->second + ".bin").c_str());
+            return;
+        }
+
+        for (auto program = _programs.begin(); program != _programs.end(); ++program) {
+            std::ifstream file((_path + "/" + program->second + ".bin").c_str(), std::ios::binary);
+            GLenum format = 0;
+            if (!file.read(reinterpret_cast<char*>(&format), sizeof(format)))
+                continue;
+            std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (data.empty())
+                continue;
+            ref_ptr<ProgramBinary> binary = new ProgramBinary;
+            binary->assign(data.size(), reinterpret_cast<const unsigned char*>(data.data()));
+            binary->setFormat(format);
+            program->first->setProgramBinary(binary.get());
+            _loadedKeys.insert(program->second);
+            _numLoaded++;
+        }
+    }
+
+    void ProgramBinaryCache::save(GraphicsContext& gc) {
+        State& state = *gc.getState();
+        if (!GL2Extensions::Get(state.getContextID(), true)->isGetProgramBinarySupported())
+            return;
+        osgDB::makeDirectory(_path);
+        std::set<std::string> savedKeys;
+        for (auto program = _programs.begin(); program != _programs.end(); ++program) {
+            Program::PerContextProgram* pcp = program->first->getPCP(state.getContextID());
+            if (program->first->getProgramBinary() && pcp && !pcp->isLinked()) {
+                //rejected by glProgramBinary, OSG does not fall back to the sources by itself
+                OSG_ALWAYS << "Cached program binary " << program->second << " rejected, linking the sources." << std::endl;
+                program->first->setProgramBinary(nullptr);
+                program->first->dirtyProgram();
+                std::remove((_path + "/" + program->second + ".bin").c_str());
+                _loadedKeys.erase(program->second);
+                _numLoaded--;
+                continue;
+            }
+            if (_loadedKeys.count(program->second) || savedKeys.count(program->second))
+                continue;
+            if (!pcp || !pcp->isLinked())
+                continue;
+            ref_ptr<ProgramBinary> binary = pcp->compileProgramBinary(state);
+            if (!binary.valid() || binary->getSize() == 0)
+                continue;
+            std::ofstream file((_path + "/" + program->second + ".bin").c_str(), std::ios::binary);
+            GLenum format = binary->getFormat();
+            file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+            file.write(reinterpret_cast<const char*>(binary->getData()), binary->getSize());
+            savedKeys.insert(program->second);
+            _numSaved++;
+        }
+        if (!savedKeys.empty()) {
+            std::ofstream signatureFile((_path + "/signature.txt").c_str(), std::ios::binary);
+            signatureFile << getSignature();
+            _loadedKeys.insert(savedKeys.begin(), savedKeys.end());
+        }
+    }
+
+    GraphicsOperation* ProgramBinaryCache::createRealizeOperation(Operation* next) {
+        return new ProgramBinaryLoadOperation(this, next);
+    }
+
+    GraphicsOperation* ProgramBinaryCache::createSaveOperation() {
+        return new ProgramBinarySaveOperation(this);
+    }
+
+    unsigned int ProgramBinaryCache::getNumPrograms() const {
+        return _programs.size();
+    }
+
+    unsigned int ProgramBinaryCache::getNumLoaded() const {
+        return _numLoaded;
+    }
+
+    unsigned int ProgramBinaryCache::getNumSaved() const {
+        return _numSaved;
+    }
+
+}
@@ -0,0 +1,275 @@
+#include "../header/RayQueryService.h"
+#include <osg/Geode>
+#include <osg/Switch>
+#include <osg/Camera>
+#include <osg/KdTree>
+#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/IntersectionVisitor>
+#include <algorithm>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //a miss is only reused for the same ray
+        const double sameRayEpsilon = 1e-9;
+
+        /**
+         * @brief AND of the node masks along the path, 0 if a Switch has turned the path off
+         */
+        unsigned int computePathMask(const NodePath& path) {
+            unsigned int mask = 0xffffffff;
+            for (unsigned int i = 0; i < path.size(); ++i) {
+                mask &= path[i]->getNodeMask();
+                Switch* switchNode = dynamic_cast<Switch*>(path[i]);
+                if (switchNode && i + 1 < path.size() && !switchNode->getChildValue(path[i + 1]))
+                    return 0;
+            }
+            return mask;
+        }
+
+        bool isDynamicPath(const NodePath& path) {
+            for (auto node = path.begin(); node != path.end(); ++node) {
+                //the view of the RTT cameras is the one of the main camera
+                if (dynamic_cast<Camera*>(*node))
+                    continue;
+                if (dynamic_cast<Switch*>(*node) || (*node)->getDataVariance() == Object::DYNAMIC)
+                    return true;
+                if ((*node)->asTransform() && (*node)->getUpdateCallback())
+                    return true;
+            }
+            return false;
+        }
+
+        class GeodePathCollector : public NodeVisitor {
+        public:
+            GeodePathCollector() : NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN) {
+                //hidden nodes may be shown later
+                setNodeMaskOverride(0xffffffff);
+            }
+            virtual void apply(Camera& camera) {
+                //HUDs are not part of the world
+                if (camera.getReferenceFrame() == Transform::RELATIVE_RF)
+                    traverse(camera);
+            }
+            virtual void apply(Geode& geode) {
+                paths.push_back(getNodePath());
+            }
+            NodePathList paths;
+        };
+    }
+
+    RayQueryService::RayQueryService(Node* root, unsigned int mask) :
+        _root(root),
+        _mask(mask),
+        _numEntries(0),
+        _nextTicket(1),
+        _numAsync(0),
+        _numSync(0) {
+        rebuild();
+    }
+
+    RayQueryService::~RayQueryService() {
+        //the jobs use the snapshot
+        waitForBatches();
+    }
+
+    void RayQueryService::rebuild() {
+        waitForBatches();
+        _published.clear();
+        _snapshot = new Group;
+        _dynamicEntries.clear();
+        _originals.clear();
+        _numEntries = 0;
+
+        GeodePathCollector collector;
+        _root->accept(collector);
+        std::map<Geode*, ref_ptr<Geode>> copies;
+        std::map<Geode*, std::vector<Matrixd>> placed;
+        for (auto path = collector.paths.begin(); path != collector.paths.end(); ++path) {
+            bool dynamic = isDynamicPath(*path);
+            unsigned int pathMask = computePathMask(*path);
+            if (!dynamic && !(pathMask & _mask))
+                continue;
+            //the color and the depth pass share the same subgraph
+            Geode* geode = static_cast<Geode*>(path->back());
+            Matrixd matrix = computeLocalToWorld(*path);
+            std::vector<Matrixd>& matrices = placed[geode];
+            if (std::find(matrices.begin(), matrices.end(), matrix) != matrices.end())
+                continue;
+            matrices.push_back(matrix);
+
+            ref_ptr<Geode>& copy = copies[geode];
+            if (!copy) {
+                copy = new Geode;
+                for (unsigned int i = 0; i < geode->getNumDrawables(); ++i) {
+                    //arrays, primitive sets and KdTree are shared
+                    ref_ptr<Drawable> drawable = dynamic_cast<Drawable*>(geode->getDrawable(i)->clone(CopyOp::SHALLOW_COPY));
+                    if (!drawable)
+                        continue;
+                    drawable->setStateSet(nullptr);
+                    drawable->setUpdateCallback(nullptr);
+                    drawable->setEventCallback(nullptr);
+                    drawable->setCullCallback(nullptr);
+                    drawable->setDrawCallback(nullptr);
+                    copy->addDrawable(drawable.get());
+                    _originals[drawable.get()] = geode->getDrawable(i);
+                }
+            }
+            ref_ptr<MatrixTransform> transform = new MatrixTransform(matrix);
+            transform->setNodeMask(pathMask);
+            transform->addChild(copy.get());
+            _snapshot->addChild(transform.get());
+            _numEntries++;
+            if (dynamic) {
+                DynamicEntry entry;
+                entry.path = *path;
+                entry.transform = transform;
+                _dynamicEntries.push_back(entry);
+            }
+        }
+
+        KdTreeBuilder kdTreeBuilder;
+        kdTreeBuilder.setNodeMaskOverride(0xffffffff);
+        _snapshot->accept(kdTreeBuilder);
+        //computed once, the workers only read the bounds
+        _snapshot->getBound();
+    }
+
+    bool RayQueryService::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa) {
+        if (ea.getEventType() != osgGA::GUIEventAdapter::FRAME)
+            return false;
+        waitForBatches();
+        _published.swap(_pending);
+        _pending.clear();
+        refresh();
+        return false;
+    }
+
+    void RayQueryService::waitForBatches() {
+        for (auto batch = _pending.begin(); batch != _pending.end(); ++batch)
+            JobSystem::instance().wait((*batch)->job.get());
+    }
+
+    void RayQueryService::refresh() {
+        for (auto entry = _dynamicEntries.begin(); entry != _dynamicEntries.end(); ++entry) {
+            //setting equal values would still dirty the bounds
+            unsigned int pathMask = computePathMask(entry->path);
+            if (entry->transform->getNodeMask() != pathMask)
+                entry->transform->setNodeMask(pathMask);
+            Matrixd matrix = computeLocalToWorld(entry->path);
+            if (entry->transform->getMatrix() != matrix)
+                entry->transform->setMatrix(matrix);
+        }
+        _snapshot->getBound();
+    }
+
+    unsigned int RayQueryService::submit(const std::vector<Ray>& rays) {
+        ref_ptr<Batch> batch = new Batch;
+        batch->firstTicket = _nextTicket;
+        batch->rays = rays;
+        batch->hits.resize(rays.size());
+        _nextTicket += rays.size();
+        Batch* work = batch.get();
+        batch->job = JobSystem::instance().submit([this, work]() {
+            for (unsigned int i = 0; i < work->rays.size(); ++i)
+                resolve(work->rays[i], work->hits[i]);
+        });
+        _pending.push_back(batch);
+        return batch->firstTicket;
+    }
+
+    unsigned int RayQueryService::submit(const Ray& ray) {
+        return submit(std::vector<Ray>(1, ray));
+    }
+
+    bool RayQueryService::getResult(unsigned int ticket, Hit& hit) const {
+        for (auto batch = _published.begin(); batch != _published.end(); ++batch) {
+            if (ticket >= (*batch)->firstTicket && ticket < (*batch)->firstTicket + (*batch)->hits.size()) {
+                hit = (*batch)->hits[ticket - (*batch)->firstTicket];
+                _numAsync++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool RayQueryService::findResult(const Ray& ray, double tolerance, Hit& hit) const {
+        Vec3d direction = ray.end - ray.start;
+        double length = direction.normalize();
+        for (auto batch = _published.begin(); batch != _published.end(); ++batch) {
+            for (unsigned int i = 0; i < (*batch)->rays.size(); ++i) {
+                const Ray& candidate = (*batch)->rays[i];
+                Vec3d candidateDirection = candidate.end - candidate.start;
+                double candidateLength = candidateDirection.normalize();
+                if (candidate.mask != ray.mask || (candidate.start - ray.start).length() > tolerance
+                    || (candidateDirection - direction).length() > tolerance)
+                    continue;
+                const Hit& candidateHit = (*batch)->hits[i];
+                if (candidateHit.valid) {
+                    //the hit point must lie on the wanted ray, at 10 times the movement the directions differ a lot
+                    double along = (candidateHit.point - ray.start) * direction;
+                    Vec3d offset = candidateHit.point - (ray.start + direction * along);
+                    if (along < 0.0 || along > length || offset.length() > tolerance)
+                        continue;
+                    hit = candidateHit;
+                    hit.distance = along;
+                }
+                else {
+                    //a miss says nothing about the neighbouring rays, corners and thin geometry would be passed
+                    if ((candidate.start - ray.start).length() > sameRayEpsilon
+                        || (candidateDirection - direction).length() > sameRayEpsilon || candidateLength < length)
+                        continue;
+                    hit = candidateHit;
+                }
+                _numAsync++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool RayQueryService::intersect(const Ray& ray, Hit& hit) const {
+        resolve(ray, hit);
+        _numSync++;
+        return hit.valid;
+    }
+
+    void RayQueryService::resolve(const Ray& ray, Hit& hit) const {
+        hit = Hit();
+        if ((ray.end - ray.start).length() < 1e-8)
+            return;
+        ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(ray.start, ray.end);
+        intersector->setIntersectionLimit(osgUtil::Intersector::LIMIT_NEAREST);
+        osgUtil::IntersectionVisitor iv(intersector.get());
+        iv.setTraversalMask(ray.mask);
+        _snapshot->accept(iv);
+        if (!intersector->containsIntersections())
+            return;
+        const osgUtil::LineSegmentIntersector::Intersection& intersection = *intersector->getIntersections().begin();
+        hit.valid = true;
+        hit.point = intersection.getWorldIntersectPoint();
+        hit.normal = intersection.getWorldIntersectNormal();
+        hit.distance = (hit.point - ray.start).length();
+        auto original = _originals.find(intersection.drawable.get());
+        hit.drawable = original != _originals.end() ? original->second : intersection.drawable;
+    }
+
+    unsigned int RayQueryService::getNumEntries() const {
+        return _numEntries;
+    }
+
+    unsigned int RayQueryService::getNumDynamicEntries() const {
+        return _dynamicEntries.size();
+    }
+
+    unsigned int RayQueryService::getNumAsyncResults() const {
+        return _numAsync;
+    }
+
+    unsigned int RayQueryService::getNumSyncResults() const {
+        return _numSync;
+    }
+
+}
@@ -0,0 +1,163 @@
+#include "../header/ReleaseCPUDataVisitor.h"
+#include "../header/UtilFunctions.h"
+#include <osg/Image>
+#include <osg/PrimitiveSet>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        template<class T>
+        unsigned int releaseElements(T* elements) {
+            unsigned int bytes = elements->getTotalDataSize();
+            //swap with an empty vector, clear() would keep the capacity
+            typename T::vector_type().swap(elements->asVector());
+            return bytes;
+        }
+    }
+
+    ReleaseCPUDataVisitor::ReleaseCPUDataVisitor(unsigned int contextID) :
+        _contextID(contextID),
+        _releasedGeometryBytes(0),
+        _releasedImageBytes(0),
+        _pendingImageBytes(0),
+        _keptDrawables(0) {
+        setTraversalMode(NodeVisitor::TRAVERSE_ALL_CHILDREN);
+    }
+
+    void ReleaseCPUDataVisitor::apply(osg::Node& node) {
+        releaseStateSet(node.getStateSet());
+        traverse(node);
+    }
+
+    void ReleaseCPUDataVisitor::apply(osg::Geode& geode) {
+        releaseStateSet(geode.getStateSet());
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            Drawable* drawable = geode.getDrawable(i);
+            releaseStateSet(drawable->getStateSet());
+            Geometry* geometry = drawable->asGeometry();
+            if (!geometry)
+                continue;
+            if (_visited.count(geometry))
+                continue;
+            if (isNeededForIntersection(*geometry) || geometry->getDataVariance() == Object::DYNAMIC) {
+                _keptDrawables++;
+                _visited.insert(geometry);
+                continue;
+            }
+            releaseGeometry(geometry);
+        }
+        traverse(geode);
+    }
+
+    bool ReleaseCPUDataVisitor::isNeededForIntersection(osg::Drawable& drawable) const {
+        //shared drawables (e.g. the bottles) are checked on every geode they are placed in
+        for (unsigned int i = 0; i < drawable.getNumParents(); ++i) {
+            NodePathList paths = drawable.getParent(i)->getParentalNodePaths();
+            for (auto path = paths.begin(); path != paths.end(); ++path) {
+                bool collision = true;
+                bool interaction = true;
+                bool proxy = true;
+                for (auto node = path->begin(); node != path->end(); ++node) {
+                    collision = collision && ((*node)->getNodeMask() & collisionMask);
+                    interaction = interaction && ((*node)->getNodeMask() & interactionMask);
+                    proxy = proxy && ((*node)->getNodeMask() & collisionProxyMask);
+                }
+                if (collision || interaction || proxy)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    void ReleaseCPUDataVisitor::releaseStateSet(osg::StateSet* stateSet) {
+        if (!stateSet || !_visited.insert(stateSet).second)
+            return;
+        const StateSet::TextureAttributeList& texAttribs = stateSet->getTextureAttributeList();
+        for (unsigned int unit = 0; unit < texAttribs.size(); ++unit) {
+            StateAttribute* attribute = stateSet->getTextureAttribute(unit, StateAttribute::TEXTURE);
+            if (attribute)
+                releaseTexture(attribute->asTexture());
+        }
+    }
+
+    void ReleaseCPUDataVisitor::releaseTexture(osg::Texture* texture) {
+        if (!texture || !_visited.insert(texture).second)
+            return;
+        texture->setUnRefImageDataAfterApply(true);
+        bool uploaded = texture->getTextureObject(_contextID) != nullptr;
+        for (unsigned int face = 0; face < texture->getNumImages(); ++face) {
+            Image* image = texture->getImage(face);
+            if (!image || !_visited.insert(image).second)
+                continue;
+            if (uploaded) {
+                _releasedImageBytes += image->getTotalSizeInBytesIncludingMipmaps();
+                texture->setImage(face, nullptr);
+            }
+            else
+                _pendingImageBytes += image->getTotalSizeInBytesIncludingMipmaps();
+        }
+    }
+
+    void ReleaseCPUDataVisitor::releaseGeometry(osg::Geometry* geometry) {
+        if (!_visited.insert(geometry).second)
+            return;
+        //only compiled display lists are independent of the arrays, VBOs still need them upon dirty
+        if (!geometry->getUseDisplayList() || geometry->getUseVertexBufferObjects()
+            || geometry->getDisplayList(_contextID) == 0) {
+            _keptDrawables++;
+            return;
+        }
+        //culling still needs the bounds, so freeze them before the vertices are gone
+        geometry->setInitialBound(geometry->getBound());
+
+        _releasedGeometryBytes += releaseArray(geometry->getVertexArray());
+        _releasedGeometryBytes += releaseArray(geometry->getNormalArray());
+        _releasedGeometryBytes += releaseArray(geometry->getColorArray());
+        _releasedGeometryBytes += releaseArray(geometry->getSecondaryColorArray());
+        _releasedGeometryBytes += releaseArray(geometry->getFogCoordArray());
+        for (unsigned int i = 0; i < geometry->getNumTexCoordArrays(); ++i)
+            _releasedGeometryBytes += releaseArray(geometry->getTexCoordArray(i));
+        for (unsigned int i = 0; i < geometry->getNumVertexAttribArrays(); ++i)
+            _releasedGeometryBytes += releaseArray(geometry->getVertexAttribArray(i));
+
+        for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); ++i) {
+            PrimitiveSet* primitiveSet = geometry->getPrimitiveSet(i);
+            if (DrawElementsUInt* de = dynamic_cast<DrawElementsUInt*>(primitiveSet))
+                _releasedGeometryBytes += releaseElements(de);
+            else if (DrawElementsUShort* de = dynamic_cast<DrawElementsUShort*>(primitiveSet))
+                _releasedGeometryBytes += releaseElements(de);
+            else if (DrawElementsUByte* de = dynamic_cast<DrawElementsUByte*>(primitiveSet))
+                _releasedGeometryBytes += releaseElements(de);
+        }
+        //KdTree is only used for intersections, which this geometry is not part of
+        geometry->setShape(nullptr);
+    }
+
+    unsigned int ReleaseCPUDataVisitor::releaseArray(osg::Array* array) {
+        if (!array || !_visited.insert(array).second)
+            return 0;
+        unsigned int bytes = array->getTotalDataSize();
+        array->resizeArray(0);
+        array->trim();
+        return bytes;
+    }
+
+    unsigned int ReleaseCPUDataVisitor::getReleasedGeometryBytes() const {
+        return _releasedGeometryBytes;
+    }
+
+    unsigned int ReleaseCPUDataVisitor::getReleasedImageBytes() const {
+        return _releasedImageBytes;
+    }
+
+    unsigned int ReleaseCPUDataVisitor::getPendingImageBytes() const {
+        return _pendingImageBytes;
+    }
+
+    unsigned int ReleaseCPUDataVisitor::getKeptDrawables() const {
+        return _keptDrawables;
+    }
+
+}
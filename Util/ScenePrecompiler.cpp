@@ -0,0 +1,176 @@
+#include "../header/ScenePrecompiler.h"
+#include "../header/UtilFunctions.h"
+#include <osgFX/Effect>
+#include <osgFX/Technique>
+#include <osg/Timer>
+#include <OpenThreads/ScopedLock>
+#include <set>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //compile() gives up after this, a CompileSet which never reports back must not block the start
+        const double compileTimeLimit = 60.0;
+
+        /**
+         * defines the techniques and passes of the effects and collects the pass StateSets and all programs
+         */
+        class PassCollector : public NodeVisitor {
+        public:
+            PassCollector(Group& passStates, ProgramBinaryCache* binaryCache) :
+                NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+                _passStates(passStates),
+                _binaryCache(binaryCache) {}
+
+            virtual void apply(Node& node) {
+                applyStateSet(node.getStateSet());
+                osgFX::Effect* effect = dynamic_cast<osgFX::Effect*>(&node);
+                if (effect) {
+                    //the first traversal defines the techniques, the one of a technique its passes
+                    NodeVisitor define(NodeVisitor::TRAVERSE_NONE);
+                    effect->traverse(define);
+                    for (unsigned int i = 0; i < effect->getNumTechniques(); ++i) {
+                        osgFX::Technique* technique = effect->getTechnique(i);
+                        technique->traverse(define, effect);
+                        for (int pass = 0; pass < technique->getNumPasses(); ++pass) {
+                            ref_ptr<Node> passNode = new Node;
+                            passNode->setStateSet(technique->getPassStateSet(pass));
+                            _passStates.addChild(passNode);
+                            applyStateSet(passNode->getStateSet());
+                        }
+                    }
+                }
+                traverse(node);
+            }
+
+            virtual void apply(Geode& geode) {
+                applyStateSet(geode.getStateSet());
+                for (unsigned int i = 0; i < geode.getNumDrawables(); ++i)
+                    applyStateSet(geode.getDrawable(i)->getStateSet());
+            }
+        private:
+            void applyStateSet(StateSet* stateSet) {
+                if (!stateSet || !_binaryCache || !_visited.insert(stateSet).second)
+                    return;
+                _binaryCache->add(dynamic_cast<Program*>(stateSet->getAttribute(StateAttribute::PROGRAM)));
+            }
+
+            Group& _passStates;
+            ProgramBinaryCache* _binaryCache;
+            std::set<StateSet*> _visited;
+        };
+    }
+
+    class ScenePrecompiler::CompletedCallback : public osgUtil::IncrementalCompileOperation::CompileCompletedCallback {
+    public:
+        CompletedCallback(ScenePrecompiler& precompiler, const std::string& name) : _precompiler(precompiler), _name(name) {}
+        //called by the draw thread
+        virtual bool compileCompleted(osgUtil::IncrementalCompileOperation::CompileSet*) {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_precompiler._completedMutex);
+            _precompiler._completed.push_back(_name);
+            //the subgraphs are already part of the scene, nothing to merge
+            return true;
+        }
+    private:
+        ScenePrecompiler& _precompiler;
+        std::string _name;
+    };
+
+    ScenePrecompiler::ScenePrecompiler(osgViewer::Viewer& viewer, ProgramBinaryCache* binaryCache) :
+        _viewer(viewer),
+        _ico(new osgUtil::IncrementalCompileOperation),
+        _binaryCache(binaryCache),
+        _states(new Group) {
+        _viewer.setIncrementalCompileOperation(_ico.get());
+    }
+
+    void ScenePrecompiler::add(Node* node, const std::string& name) {
+        if (!node)
+            return;
+        PassCollector collector(*_states, _binaryCache.get());
+        node->accept(collector);
+        Entry entry;
+        entry.node = node;
+        entry.name = name;
+        _entries.push_back(entry);
+    }
+
+    void ScenePrecompiler::addStateSet(StateSet* stateSet) {
+        if (!stateSet)
+            return;
+        ref_ptr<Node> stateNode = new Node;
+        stateNode->setStateSet(stateSet);
+        PassCollector collector(*_states, _binaryCache.get());
+        stateNode->accept(collector);
+        _states->addChild(stateNode);
+    }
+
+    unsigned int ScenePrecompiler::compile() {
+        if (_ico->getContextSet().empty()) {
+            OSG_ALWAYS << "Precompiling needs a realized viewer." << std::endl;
+            return 0;
+        }
+        if (_states->getNumChildren() > 0) {
+            Entry entry;
+            entry.node = _states;
+            entry.name = "effect passes and states";
+            _entries.push_back(entry);
+        }
+        for (auto entry = _entries.begin(); entry != _entries.end(); ++entry) {
+            ref_ptr<osgUtil::IncrementalCompileOperation::CompileSet> compileSet =
+                new osgUtil::IncrementalCompileOperation::CompileSet(entry->node.get());
+            compileSet->_compileCompletedCallback = new CompletedCallback(*this, entry->name);
+            //hidden Switch children too
+            osgUtil::StateToCompile stateToCompile(osgUtil::GLObjectsVisitor::COMPILE_DISPLAY_LISTS
+                                                   | osgUtil::GLObjectsVisitor::COMPILE_STATE_ATTRIBUTES);
+            stateToCompile.setTraversalMode(NodeVisitor::TRAVERSE_ALL_CHILDREN);
+            //the collision proxies are never rendered
+            stateToCompile.setTraversalMask(~collisionProxyMask);
+            entry->node->accept(stateToCompile);
+            if (!compileSet->buildCompileMap(_ico->getContextSet(), stateToCompile)) {
+                //nothing to compile, the draw thread would never report it
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_completedMutex);
+                _completed.push_back(entry->name);
+                continue;
+            }
+            _ico->add(compileSet.get(), false);
+        }
+
+        //nearly everything per frame, nobody is playing yet
+        double minimumTime = _ico->getMinimumTimeAvailableForGLCompileAndDeletePerFrame();
+        unsigned int maximumObjects = _ico->getMaximumNumOfObjectsToCompilePerFrame();
+        _ico->setMinimumTimeAvailableForGLCompileAndDeletePerFrame(1.0);
+        _ico->setMaximumNumOfObjectsToCompilePerFrame(100000);
+        Timer_t start = Timer::instance()->tick();
+        unsigned int frames = 0;
+        unsigned int reported = 0;
+        while (reported < _entries.size() && !_viewer.done()) {
+            if (Timer::instance()->delta_s(start, Timer::instance()->tick()) > compileTimeLimit) {
+                OSG_ALWAYS << "Precompiling stopped after " << frames << " frames, " << _entries.size() - reported
+                    << " subgraphs are compiled upon first use." << std::endl;
+                break;
+            }
+            _viewer.frame();
+            frames++;
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_completedMutex);
+            for (; reported < _completed.size(); ++reported) {
+                OSG_ALWAYS << "Precompiled " << reported + 1 << "/" << _entries.size() << ": " << _completed[reported] << " after "
+                    << frames << " frames (" << Timer::instance()->delta_s(start, Timer::instance()->tick()) << " s)." << std::endl;
+            }
+        }
+        _ico->setMinimumTimeAvailableForGLCompileAndDeletePerFrame(minimumTime);
+        _ico->setMaximumNumOfObjectsToCompilePerFrame(maximumObjects);
+
+        if (_binaryCache.valid()) {
+            //runs with the operations of the next frame
+            osgViewer::Viewer::Contexts contexts;
+            _viewer.getContexts(contexts);
+            for (auto context = contexts.begin(); context != contexts.end(); ++context)
+                (*context)->add(_binaryCache->createSaveOperation());
+        }
+        return frames;
+    }
+
+}
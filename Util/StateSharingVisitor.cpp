@@ -0,0 +1,130 @@
+#include "../header/StateSharingVisitor.h"
+#include <vector>
+
+using namespace osg;
+
+namespace brtr {
+
+    StateSharingVisitor::StateSharingVisitor() :
+        NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _numSharedAttributes(0),
+        _numSharedUniforms(0) {}
+
+    void StateSharingVisitor::apply(Node& node) {
+        if (node.getStateSet())
+            node.setStateSet(share(node.getStateSet()));
+        traverse(node);
+    }
+
+    void StateSharingVisitor::apply(Geode& geode) {
+        if (geode.getStateSet())
+            geode.setStateSet(share(geode.getStateSet()));
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            Drawable* drawable = geode.getDrawable(i);
+            //no StateSet, nothing to share
+            if (drawable->getStateSet())
+                drawable->setStateSet(share(drawable->getStateSet()));
+        }
+    }
+
+    StateSet* StateSharingVisitor::share(StateSet* stateSet) {
+        auto visited = _visited.find(stateSet);
+        if (visited != _visited.end())
+            return visited->second.get();
+        if (isChangedAtRuntime(stateSet)) {
+            _visited[stateSet] = stateSet;
+            return stateSet;
+        }
+
+        //replacing while iterating would invalidate the lists, so collect first
+        typedef std::pair<unsigned int, std::pair<StateAttribute*, StateAttribute::OverrideValue>> Replacement;
+        std::vector<Replacement> replacements;
+        const StateSet::AttributeList& attributes = stateSet->getAttributeList();
+        for (auto attribute = attributes.begin(); attribute != attributes.end(); ++attribute) {
+            StateAttribute* shared = share(attribute->second.first.get());
+            if (shared != attribute->second.first.get())
+                replacements.push_back(Replacement(0, std::make_pair(shared, attribute->second.second)));
+        }
+        for (auto replacement = replacements.begin(); replacement != replacements.end(); ++replacement)
+            stateSet->setAttribute(replacement->second.first, replacement->second.second);
+
+        replacements.clear();
+        const StateSet::TextureAttributeList& textureAttributes = stateSet->getTextureAttributeList();
+        for (unsigned int unit = 0; unit < textureAttributes.size(); ++unit) {
+            for (auto attribute = textureAttributes[unit].begin(); attribute != textureAttributes[unit].end(); ++attribute) {
+                StateAttribute* shared = share(attribute->second.first.get());
+                if (shared != attribute->second.first.get())
+                    replacements.push_back(Replacement(unit, std::make_pair(shared, attribute->second.second)));
+            }
+        }
+        for (auto replacement = replacements.begin(); replacement != replacements.end(); ++replacement)
+            stateSet->setTextureAttribute(replacement->first, replacement->second.first, replacement->second.second);
+
+        std::vector<std::pair<Uniform*, StateAttribute::OverrideValue>> uniformReplacements;
+        const StateSet::UniformList& uniforms = stateSet->getUniformList();
+        for (auto uniform = uniforms.begin(); uniform != uniforms.end(); ++uniform) {
+            Uniform* shared = share(uniform->second.first.get());
+            if (shared != uniform->second.first.get())
+                uniformReplacements.push_back(std::make_pair(shared, uniform->second.second));
+        }
+        for (auto replacement = uniformReplacements.begin(); replacement != uniformReplacements.end(); ++replacement)
+            stateSet->addUniform(replacement->first, replacement->second);
+
+        StateSet* shared = _stateSets.insert(stateSet).first->get();
+        _visited[stateSet] = shared;
+        return shared;
+    }
+
+    StateAttribute* StateSharingVisitor::share(StateAttribute* attribute) {
+        if (isChangedAtRuntime(attribute))
+            return attribute;
+        StateAttribute* shared = _attributes.insert(attribute).first->get();
+        if (shared != attribute)
+            _numSharedAttributes++;
+        return shared;
+    }
+
+    Uniform* StateSharingVisitor::share(Uniform* uniform) {
+        if (isChangedAtRuntime(uniform))
+            return uniform;
+        Uniform* shared = _uniforms.insert(uniform).first->get();
+        if (shared != uniform)
+            _numSharedUniforms++;
+        return shared;
+    }
+
+    bool StateSharingVisitor::isChangedAtRuntime(const Object* object) const {
+        if (object->getDataVariance() == Object::DYNAMIC)
+            return true;
+        const StateSet* stateSet = dynamic_cast<const StateSet*>(object);
+        if (stateSet && (stateSet->getUpdateCallback() || stateSet->getEventCallback()))
+            return true;
+        const StateAttribute* attribute = dynamic_cast<const StateAttribute*>(object);
+        if (attribute && (attribute->getUpdateCallback() || attribute->getEventCallback()))
+            return true;
+        const Uniform* uniform = dynamic_cast<const Uniform*>(object);
+        if (uniform && (uniform->getUpdateCallback() || uniform->getEventCallback()))
+            return true;
+        return false;
+    }
+
+    unsigned int StateSharingVisitor::getNumStateSets() const {
+        return _visited.size();
+    }
+
+    unsigned int StateSharingVisitor::getNumUniqueStateSets() const {
+        std::set<StateSet*> unique;
+        for (auto visited = _visited.begin(); visited != _visited.end(); ++visited)
+            unique.insert(visited->second.get());
+        return unique.size();
+    }
+
+    unsigned int StateSharingVisitor::getNumSharedAttributes() const {
+        return _numSharedAttributes;
+    }
+
+    unsigned int StateSharingVisitor::getNumSharedUniforms() const {
+        return _numSharedUniforms;
+    }
+
+}
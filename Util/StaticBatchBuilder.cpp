@@ -0,0 +1,275 @@
+#include "../header/StaticBatchBuilder.h"
+#include "../header/StaticBatchDrawElements.h"
+#include "../header/UtilFunctions.h"
+#include <osg/Switch>
+#include <osg/LOD>
+#include <osg/Sequence>
+#include <osg/Billboard>
+#include <osg/OcclusionQueryNode>
+#include <osg/TriangleIndexFunctor>
+#include <osgFX/Effect>
+#include <cmath>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        struct IndexCollector {
+            std::vector<GLuint>* indices;
+            GLuint base;
+            void operator()(unsigned int i1, unsigned int i2, unsigned int i3) {
+                indices->push_back(base + i1);
+                indices->push_back(base + i2);
+                indices->push_back(base + i3);
+            }
+        };
+
+        bool isTriangleMode(GLenum mode) {
+            return mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN
+                || mode == GL_QUADS || mode == GL_QUAD_STRIP || mode == GL_POLYGON;
+        }
+
+        //shader animations work in model coordinates, which are gone after the transform
+        const char* modelSpaceUniforms[] = { "zAnimation", "xAnimation", "yAnimation",
+            "quantizedPositions", "compressedNormals", "compressedTexCoords" };
+    }
+
+    StaticBatchBuilder::StaticBatchBuilder(float cellSize, bool gpuCulling) :
+        NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _cellSize(cellSize),
+        _gpuCulling(gpuCulling),
+        _root(nullptr),
+        _numBatchedDrawables(0),
+        _numBatches(0) {}
+
+    bool StaticBatchBuilder::isBatchable(const Node& node) const {
+        if (node.getUpdateCallback() || node.getEventCallback() || node.getCullCallback()
+            || node.getDataVariance() == Object::DYNAMIC)
+            return false;
+        //never rendered (e.g. collision proxies) or culled by the cameras anyway
+        if ((node.getNodeMask() & ~collisionProxyMask) == 0)
+            return false;
+        //the children are chosen per frame or rendered by passes
+        return !dynamic_cast<const Switch*>(&node) && !dynamic_cast<const LOD*>(&node) && !dynamic_cast<const Sequence*>(&node)
+            && !dynamic_cast<const OcclusionQueryNode*>(&node) && !dynamic_cast<const Camera*>(&node)
+            && !dynamic_cast<const osgFX::Effect*>(&node) && !dynamic_cast<const Billboard*>(&node);
+    }
+
+    bool StaticBatchBuilder::isBatchable(const Geometry& geometry) const {
+        if (geometry.getDataVariance() == Object::DYNAMIC || geometry.getUpdateCallback() || geometry.getEventCallback()
+            || geometry.getCullCallback() || geometry.getDrawCallback() || geometry.getUserDataContainer()
+            || !geometry.suitableForOptimization())
+            return false;
+        const Vec3Array* vertices = dynamic_cast<const Vec3Array*>(geometry.getVertexArray());
+        if (!vertices || vertices->empty())
+            return false;
+        const Array* normals = geometry.getNormalArray();
+        if (normals && (!dynamic_cast<const Vec3Array*>(normals)
+                        || (geometry.getNormalBinding() == Geometry::BIND_PER_VERTEX && normals->getNumElements() != vertices->size())
+                        || (geometry.getNormalBinding() != Geometry::BIND_PER_VERTEX && geometry.getNormalBinding() != Geometry::BIND_OVERALL)))
+            return false;
+        const Array* texcoords = geometry.getTexCoordArray(0);
+        if (texcoords && (!dynamic_cast<const Vec2Array*>(texcoords) || texcoords->getNumElements() != vertices->size()))
+            return false;
+        for (unsigned int unit = 1; unit < geometry.getNumTexCoordArrays(); ++unit) {
+            if (geometry.getTexCoordArray(unit))
+                return false;
+        }
+        if (geometry.getNumVertexAttribArrays() > 0 || geometry.getColorBinding() == Geometry::BIND_PER_VERTEX
+            || geometry.getColorBinding() == Geometry::BIND_PER_PRIMITIVE)
+            return false;
+        //an overall color is expanded per vertex
+        const Array* colors = geometry.getColorArray();
+        if (colors && geometry.getColorBinding() == Geometry::BIND_OVERALL
+            && (!dynamic_cast<const Vec4Array*>(colors) || colors->getNumElements() == 0))
+            return false;
+        for (unsigned int i = 0; i < geometry.getNumPrimitiveSets(); ++i) {
+            if (!isTriangleMode(geometry.getPrimitiveSet(i)->getMode()))
+                return false;
+        }
+        return geometry.getNumPrimitiveSets() > 0;
+    }
+
+    void StaticBatchBuilder::apply(Node& node) {
+        if (&node != _root && !isBatchable(node))
+            return;
+        traverse(node);
+    }
+
+    void StaticBatchBuilder::apply(Geode& geode) {
+        _numPaths[&geode]++;
+        Node::NodeMask nodeMask = ~collisionProxyMask;
+        for (auto node = getNodePath().begin(); node != getNodePath().end(); ++node)
+            nodeMask &= (*node)->getNodeMask();
+        if (!isBatchable(geode) || (nodeMask & interactionMask) || geode.getUserDataContainer()) {
+            _rejected[&geode] = true;
+            return;
+        }
+        Matrix matrix = computeLocalToWorld(getNodePath());
+        ref_ptr<StateSet> geodeState = accumulateStateSet();
+        std::vector<Candidate>& candidates = _candidates[&geode];
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            Geometry* geometry = geode.getDrawable(i)->asGeometry();
+            if (!geometry || !isBatchable(*geometry)) {
+                _rejected[&geode] = true;
+                return;
+            }
+            Candidate candidate;
+            candidate.geometry = geometry;
+            candidate.matrix = matrix;
+            candidate.nodeMask = nodeMask;
+            candidate.stateSet = new StateSet(*geodeState, CopyOp::SHALLOW_COPY);
+            if (geometry->getStateSet())
+                candidate.stateSet->merge(*geometry->getStateSet());
+            for (unsigned int u = 0; u < sizeof(modelSpaceUniforms) / sizeof(modelSpaceUniforms[0]); ++u) {
+                if (candidate.stateSet->getUniform(modelSpaceUniforms[u])) {
+                    _rejected[&geode] = true;
+                    return;
+                }
+            }
+            const Vec3Array& vertices = static_cast<const Vec3Array&>(*geometry->getVertexArray());
+            for (auto vertex = vertices.begin(); vertex != vertices.end(); ++vertex)
+                candidate.bound.expandBy(*vertex * matrix);
+            candidates.push_back(candidate);
+        }
+    }
+
+    ref_ptr<StateSet> StaticBatchBuilder::accumulateStateSet() const {
+        //from the root down, StateSet::merge keeps the OVERRIDE of the parents
+        ref_ptr<StateSet> stateSet = new StateSet;
+        for (auto node = getNodePath().begin(); node != getNodePath().end(); ++node) {
+            if ((*node)->getStateSet() && *node != _root)
+                stateSet->merge(*(*node)->getStateSet());
+        }
+        return stateSet;
+    }
+
+    unsigned int StaticBatchBuilder::build(Group* root) {
+        _root = root;
+        root->accept(*this);
+
+        std::vector<Batch> batches;
+        std::vector<ref_ptr<Geode>> batchedGeodes;
+        for (auto entry = _candidates.begin(); entry != _candidates.end(); ++entry) {
+            Geode* geode = entry->first;
+            //shared Geodes only, if every placement was batchable and below the root
+            if (_rejected[geode] || entry->second.empty() || _numPaths[geode] != geode->getParentalNodePaths(root).size())
+                continue;
+            for (auto candidate = entry->second.begin(); candidate != entry->second.end(); ++candidate) {
+                Vec3 cell;
+                if (_cellSize > 0.0f) {
+                    Vec3 center = candidate->bound.center() / _cellSize;
+                    cell.set(std::floor(center.x()), std::floor(center.y()), std::floor(center.z()));
+                }
+                auto batch = batches.begin();
+                while (batch != batches.end() && (batch->cell != cell || batch->nodeMask != candidate->nodeMask || batch->stateSet->compare(*candidate->stateSet, true) != 0))
+                    ++batch;
+                if (batch == batches.end()) {
+                    Batch newBatch;
+                    newBatch.stateSet = candidate->stateSet;
+                    newBatch.nodeMask = candidate->nodeMask;
+                    newBatch.cell = cell;
+                    batches.push_back(newBatch);
+                    batch = batches.end() - 1;
+                }
+                batch->candidates.push_back(&*candidate);
+                _numBatchedDrawables++;
+            }
+            batchedGeodes.push_back(geode);
+        }
+
+        for (auto batch = batches.begin(); batch != batches.end(); ++batch)
+            root->addChild(createBatchGeode(*batch));
+        //the Geodes may be placed several times, e.g. the bottles
+        for (auto geode = batchedGeodes.begin(); geode != batchedGeodes.end(); ++geode) {
+            while ((*geode)->getNumParents() > 0)
+                (*geode)->getParent(0)->removeChild(geode->get());
+        }
+        _numBatches += batches.size();
+        _candidates.clear();
+        _numPaths.clear();
+        _rejected.clear();
+        _root = nullptr;
+        return batches.size();
+    }
+
+    ref_ptr<Geode> StaticBatchBuilder::createBatchGeode(const Batch& batch) const {
+        ref_ptr<Vec3Array> vertices = new Vec3Array;
+        ref_ptr<Vec3Array> normals = new Vec3Array;
+        ref_ptr<Vec2Array> texcoords = new Vec2Array;
+        ref_ptr<Vec4Array> colors = new Vec4Array;
+        ref_ptr<StaticBatchDrawElements> elements = new StaticBatchDrawElements;
+        elements->setGPUCulling(_gpuCulling);
+        bool textured = false;
+        bool colored = false;
+
+        for (auto candidatePtr = batch.candidates.begin(); candidatePtr != batch.candidates.end(); ++candidatePtr) {
+            const Candidate& candidate = **candidatePtr;
+            Geometry& geometry = *candidate.geometry;
+            const Vec3Array& sourceVertices = static_cast<const Vec3Array&>(*geometry.getVertexArray());
+            const Vec3Array* sourceNormals = static_cast<const Vec3Array*>(geometry.getNormalArray());
+            const Vec2Array* sourceTexcoords = static_cast<const Vec2Array*>(geometry.getTexCoordArray(0));
+            textured = textured || sourceTexcoords;
+            //without a color array the default color of GL is white
+            Vec4 color(1.0f, 1.0f, 1.0f, 1.0f);
+            if (geometry.getColorArray() && geometry.getColorBinding() == Geometry::BIND_OVERALL) {
+                color = static_cast<const Vec4Array&>(*geometry.getColorArray())[0];
+                colored = true;
+            }
+            //normals with the inverse transpose
+            Matrix inverse = Matrix::inverse(candidate.matrix);
+            GLuint base = vertices->size();
+            for (unsigned int i = 0; i < sourceVertices.size(); ++i) {
+                vertices->push_back(sourceVertices[i] * candidate.matrix);
+                Vec3 normal(0.0f, 0.0f, 1.0f);
+                if (sourceNormals && !sourceNormals->empty())
+                    normal = geometry.getNormalBinding() == Geometry::BIND_PER_VERTEX ? (*sourceNormals)[i] : (*sourceNormals)[0];
+                normal = Matrix::transform3x3(inverse, normal);
+                normal.normalize();
+                normals->push_back(normal);
+                texcoords->push_back(sourceTexcoords ? (*sourceTexcoords)[i] : Vec2());
+                colors->push_back(color);
+            }
+
+            unsigned int first = elements->size();
+            TriangleIndexFunctor<IndexCollector> collector;
+            collector.indices = &elements->asVector();
+            collector.base = base;
+            geometry.accept(collector);
+            elements->addSubDraw(first, elements->size() - first, candidate.bound);
+        }
+
+        ref_ptr<Geometry> geometry = new Geometry;
+        geometry->setVertexArray(vertices);
+        geometry->setNormalArray(normals);
+        geometry->setNormalBinding(Geometry::BIND_PER_VERTEX);
+        if (textured)
+            geometry->setTexCoordArray(0, texcoords);
+        if (colored) {
+            geometry->setColorArray(colors);
+            geometry->setColorBinding(Geometry::BIND_PER_VERTEX);
+        }
+        geometry->addPrimitiveSet(elements);
+        //the culling happens in the draw, a display list would freeze it
+        geometry->setUseDisplayList(false);
+        geometry->setUseVertexBufferObjects(true);
+        geometry->setDataVariance(Object::STATIC);
+
+        ref_ptr<Geode> geode = new Geode;
+        geode->setName("StaticBatch");
+        geode->addDrawable(geometry);
+        geode->setNodeMask(batch.nodeMask);
+        geode->setStateSet(batch.stateSet);
+        return geode;
+    }
+
+    unsigned int StaticBatchBuilder::getNumBatchedDrawables() const {
+        return _numBatchedDrawables;
+    }
+
+    unsigned int StaticBatchBuilder::getNumBatches() const {
+        return _numBatches;
+    }
+
+}
@@ -0,0 +1,281 @@
+#include "../header/StaticBatchDrawElements.h"
+#include <osg/State>
+#include <osg/Polytope>
+#include <osg/GLExtensions>
+#include <osg/GL2Extensions>
+#include <osg/Program>
+#include <osg/BufferObject>
+#include <osg/Notify>
+#include <fstream>
+#include <sstream>
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_DYNAMIC_COPY
+#define GL_DYNAMIC_COPY 0x88EA
+#endif
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //layout of the indirect buffer, see glMultiDrawElementsIndirect
+        struct DrawElementsIndirectCommand {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLuint baseVertex;
+            GLuint baseInstance;
+        };
+
+        const unsigned int workGroupSize = 64;  ///< local_size_x of batchCull.comp
+    }
+
+    struct StaticBatchDrawElements::PerContextData : public Referenced {
+        typedef void (GL_APIENTRY * MultiDrawElementsProc)(GLenum mode, const GLsizei* count, GLenum type, const GLvoid* const* indices, GLsizei drawcount);
+        typedef void (GL_APIENTRY * MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const GLvoid* indirect, GLsizei drawcount, GLsizei stride);
+        typedef void (GL_APIENTRY * DispatchComputeProc)(GLuint x, GLuint y, GLuint z);
+        typedef void (GL_APIENTRY * MemoryBarrierProc)(GLbitfield barriers);
+        typedef void (GL_APIENTRY * GenBuffersProc)(GLsizei n, GLuint* buffers);
+        typedef void (GL_APIENTRY * BindBufferProc)(GLenum target, GLuint buffer);
+        typedef void (GL_APIENTRY * BindBufferBaseProc)(GLenum target, GLuint index, GLuint buffer);
+        typedef void (GL_APIENTRY * BufferDataProc)(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage);
+
+        PerContextData(unsigned int id) :
+            contextID(id), multiDrawElements(nullptr), multiDrawElementsIndirect(nullptr), dispatchCompute(nullptr), memoryBarrier(nullptr),
+            genBuffers(nullptr), bindBuffer(nullptr), bindBufferBase(nullptr), bufferData(nullptr),
+            gpuInitialized(false), gpuReady(false), program(0), mvpLocation(-1), numDrawsLocation(-1),
+            boundsBuffer(0), commandBuffer(0), commandOffset(0) {}
+
+        //queued, osg deletes them while the context is current
+        ~PerContextData() {
+            if (program)
+                Program::deleteGlProgram(contextID, program);
+            if (boundsBuffer)
+                GLBufferObject::deleteBufferObject(contextID, boundsBuffer);
+            if (commandBuffer)
+                GLBufferObject::deleteBufferObject(contextID, commandBuffer);
+        }
+
+        unsigned int contextID;
+
+        MultiDrawElementsProc multiDrawElements;
+        MultiDrawElementsIndirectProc multiDrawElementsIndirect;
+        DispatchComputeProc dispatchCompute;
+        MemoryBarrierProc memoryBarrier;
+        GenBuffersProc genBuffers;
+        BindBufferProc bindBuffer;
+        BindBufferBaseProc bindBufferBase;
+        BufferDataProc bufferData;
+
+        bool gpuInitialized;
+        bool gpuReady;
+        GLuint program;
+        GLint mvpLocation;
+        GLint numDrawsLocation;
+        GLuint boundsBuffer;
+        GLuint commandBuffer;
+        GLintptr commandOffset;     ///< element buffer offset the commands were built for
+
+        //scratch of the CPU path
+        std::vector<GLsizei> counts;
+        std::vector<const GLvoid*> offsets;
+    };
+
+    StaticBatchDrawElements::StaticBatchDrawElements() :
+        DrawElementsUInt(GL_TRIANGLES),
+        _gpuCulling(false) {}
+
+    StaticBatchDrawElements::StaticBatchDrawElements(const StaticBatchDrawElements& copy, const CopyOp& copyop) :
+        DrawElementsUInt(copy, copyop),
+        _subDraws(copy._subDraws),
+        _gpuCulling(copy._gpuCulling) {}
+
+    StaticBatchDrawElements::~StaticBatchDrawElements() {}
+
+    void StaticBatchDrawElements::addSubDraw(unsigned int first, unsigned int count, const BoundingBox& bound) {
+        SubDraw subDraw = { first, count, bound };
+        _subDraws.push_back(subDraw);
+    }
+
+    unsigned int StaticBatchDrawElements::getNumSubDraws() const {
+        return _subDraws.size();
+    }
+
+    void StaticBatchDrawElements::setGPUCulling(bool gpuCulling) {
+        _gpuCulling = gpuCulling;
+    }
+
+    bool StaticBatchDrawElements::getGPUCulling() const {
+        return _gpuCulling;
+    }
+
+    void StaticBatchDrawElements::resizeGLObjectBuffers(unsigned int maxSize) {
+        DrawElementsUInt::resizeGLObjectBuffers(maxSize);
+        _perContextData.resize(maxSize);
+    }
+
+    void StaticBatchDrawElements::releaseGLObjects(State* state) const {
+        DrawElementsUInt::releaseGLObjects(state);
+        if (state) {
+            unsigned int contextID = state->getContextID();
+            if (contextID < _perContextData.size())
+                _perContextData[contextID] = nullptr;
+        }
+        else {
+            for (unsigned int i = 0; i < _perContextData.size(); ++i)
+                _perContextData[i] = nullptr;
+        }
+    }
+
+    StaticBatchDrawElements::PerContextData& StaticBatchDrawElements::getPerContextData(State& state) const {
+        ref_ptr<PerContextData>& data = _perContextData[state.getContextID()];
+        if (!data) {
+            data = new PerContextData(state.getContextID());
+            setGLExtensionFuncPtr(data->multiDrawElements, "glMultiDrawElements", "glMultiDrawElementsEXT");
+            setGLExtensionFuncPtr(data->genBuffers, "glGenBuffers", "glGenBuffersARB");
+            setGLExtensionFuncPtr(data->bindBuffer, "glBindBuffer", "glBindBufferARB");
+            setGLExtensionFuncPtr(data->bufferData, "glBufferData", "glBufferDataARB");
+            if (_gpuCulling && getGLVersionNumber() >= 4.3f) {
+                setGLExtensionFuncPtr(data->multiDrawElementsIndirect, "glMultiDrawElementsIndirect");
+                setGLExtensionFuncPtr(data->dispatchCompute, "glDispatchCompute");
+                setGLExtensionFuncPtr(data->memoryBarrier, "glMemoryBarrier");
+                setGLExtensionFuncPtr(data->bindBufferBase, "glBindBufferBase");
+            }
+        }
+        return *data;
+    }
+
+    void StaticBatchDrawElements::draw(State& state, bool useVertexBufferObjects) const {
+        PerContextData& data = getPerContextData(state);
+        GLBufferObject* ebo = useVertexBufferObjects ? getOrCreateGLBufferObject(state.getContextID()) : nullptr;
+        if (!ebo || !data.multiDrawElements || _subDraws.empty()) {
+            //everything, as a plain triangle list
+            DrawElementsUInt::draw(state, useVertexBufferObjects);
+            return;
+        }
+        state.bindElementBufferObject(ebo);
+        Matrix modelViewProjection = state.getModelViewMatrix() * state.getProjectionMatrix();
+        GLintptr offset = (GLintptr)ebo->getOffset(getBufferIndex());
+        if (_gpuCulling && drawGPUCulled(data, state, modelViewProjection, offset))
+            return;
+        drawCPUCulled(data, modelViewProjection, offset);
+    }
+
+    void StaticBatchDrawElements::drawCPUCulled(PerContextData& data, const Matrix& modelViewProjection, GLintptr offset) const {
+        Polytope frustum;
+        frustum.setToUnitFrustum(true, true);
+        frustum.transformProvidingInverse(modelViewProjection);
+
+        data.counts.clear();
+        data.offsets.clear();
+        unsigned int end = 0;
+        for (auto subDraw = _subDraws.begin(); subDraw != _subDraws.end(); ++subDraw) {
+            if (!frustum.contains(subDraw->bound))
+                continue;
+            //neighbouring ranges become one
+            if (!data.counts.empty() && end == subDraw->first)
+                data.counts.back() += subDraw->count;
+            else {
+                data.counts.push_back(subDraw->count);
+                data.offsets.push_back((const GLvoid*)(offset + subDraw->first * sizeof(GLuint)));
+            }
+            end = subDraw->first + subDraw->count;
+        }
+        if (!data.counts.empty())
+            data.multiDrawElements(GL_TRIANGLES, &data.counts[0], GL_UNSIGNED_INT, &data.offsets[0], data.counts.size());
+    }
+
+    bool StaticBatchDrawElements::drawGPUCulled(PerContextData& data, State& state, const Matrix& modelViewProjection, GLintptr offset) const {
+        GL2Extensions* gl2 = GL2Extensions::Get(state.getContextID(), true);
+        if (!data.gpuInitialized) {
+            data.gpuInitialized = true;
+            if (!data.multiDrawElementsIndirect || !data.dispatchCompute || !data.memoryBarrier || !data.bindBufferBase
+                || !data.genBuffers || !data.bindBuffer || !data.bufferData || !gl2) {
+                OSG_ALWAYS << "StaticBatchDrawElements: GPU culling needs GL 4.3, culling on the CPU." << std::endl;
+                return false;
+            }
+            std::ifstream file("../Shader/batchCull.comp");
+            std::stringstream source;
+            source << file.rdbuf();
+            std::string sourceString = source.str();
+            const GLchar* sourcePtr = sourceString.c_str();
+            GLuint shader = gl2->glCreateShader(GL_COMPUTE_SHADER);
+            gl2->glShaderSource(shader, 1, &sourcePtr, nullptr);
+            gl2->glCompileShader(shader);
+            data.program = gl2->glCreateProgram();
+            gl2->glAttachShader(data.program, shader);
+            gl2->glLinkProgram(data.program);
+            gl2->glDeleteShader(shader);
+            GLint linked = GL_FALSE;
+            gl2->glGetProgramiv(data.program, GL_LINK_STATUS, &linked);
+            if (sourceString.empty() || linked != GL_TRUE) {
+                OSG_ALWAYS << "StaticBatchDrawElements: batchCull.comp failed, culling on the CPU." << std::endl;
+                return false;
+            }
+            data.mvpLocation = gl2->glGetUniformLocation(data.program, "modelViewProjection");
+            data.numDrawsLocation = gl2->glGetUniformLocation(data.program, "numDraws");
+
+            std::vector<Vec4f> bounds;
+            bounds.reserve(_subDraws.size() * 2);
+            for (auto subDraw = _subDraws.begin(); subDraw != _subDraws.end(); ++subDraw) {
+                bounds.push_back(Vec4f(subDraw->bound._min, 1.0f));
+                bounds.push_back(Vec4f(subDraw->bound._max, 1.0f));
+            }
+            data.genBuffers(1, &data.boundsBuffer);
+            data.bindBuffer(GL_SHADER_STORAGE_BUFFER, data.boundsBuffer);
+            data.bufferData(GL_SHADER_STORAGE_BUFFER, bounds.size() * sizeof(Vec4f), &bounds[0], GL_STATIC_DRAW);
+            data.genBuffers(1, &data.commandBuffer);
+            data.commandOffset = -1;
+            data.gpuReady = true;
+        }
+        if (!data.gpuReady)
+            return false;
+
+        //the element buffer may be rebuilt at another offset
+        GLsizei numDraws = _subDraws.size();
+        if (data.commandOffset != offset) {
+            std::vector<DrawElementsIndirectCommand> commands(numDraws);
+            for (GLsizei i = 0; i < numDraws; ++i) {
+                DrawElementsIndirectCommand command = { _subDraws[i].count, 1, (GLuint)(offset / sizeof(GLuint)) + _subDraws[i].first, 0, 0 };
+                commands[i] = command;
+            }
+            data.bindBuffer(GL_SHADER_STORAGE_BUFFER, data.commandBuffer);
+            data.bufferData(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0], GL_DYNAMIC_COPY);
+            data.commandOffset = offset;
+        }
+        data.bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        gl2->glUseProgram(data.program);
+        Matrixf mvp(modelViewProjection);
+        gl2->glUniformMatrix4fv(data.mvpLocation, 1, GL_FALSE, mvp.ptr());
+        gl2->glUniform1ui(data.numDrawsLocation, numDraws);
+        data.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, data.boundsBuffer);
+        data.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, data.commandBuffer);
+        data.dispatchCompute((numDraws + workGroupSize - 1) / workGroupSize, 1, 1);
+        data.memoryBarrier(GL_COMMAND_BARRIER_BIT);
+        //back to the program osg::State believes to be bound
+        const Program::PerContextProgram* lastProgram = state.getLastAppliedProgramObject();
+        gl2->glUseProgram(lastProgram ? lastProgram->getHandle() : 0);
+
+        data.bindBuffer(GL_DRAW_INDIRECT_BUFFER, data.commandBuffer);
+        data.multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, numDraws, 0);
+        data.bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return true;
+    }
+
+}
@@ -0,0 +1,198 @@
+#include "../header/TextureCookVisitor.h"
+#include <osg/Image>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <osgDB/ImageProcessor>
+#include <osgDB/Registry>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        bool getModificationTime(const std::string& file, time_t& time) {
+            struct stat info;
+            if (stat(file.c_str(), &info) != 0)
+                return false;
+            time = info.st_mtime;
+            return true;
+        }
+    }
+
+    std::string TextureCookVisitor::getCookedFile(const std::string& cookedPath, const std::string& imageFile) {
+        std::string path = osgDB::convertFileNameToUnixStyle(imageFile);
+        std::string relative;
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t end = path.find('/', start);
+            if (end == std::string::npos)
+                end = path.size();
+            std::string element = path.substr(start, end - start);
+            if (!element.empty() && element != "." && element != ".." && element.find(':') == std::string::npos)
+                relative += "/" + element;
+            start = end + 1;
+        }
+        return relative.empty() ? "" : cookedPath + relative + ".dds";
+    }
+
+    bool TextureCookVisitor::isCookedUpToDate(const std::string& cookedFile, const std::string& sourceFile) {
+        time_t cookedTime, sourceTime;
+        if (cookedFile.empty() || !getModificationTime(cookedFile, cookedTime))
+            return false;
+        return !getModificationTime(sourceFile, sourceTime) || sourceTime <= cookedTime;
+    }
+
+    CookedImageReadCallback::CookedImageReadCallback(const std::string& cookedPath) :
+        _cookedPath(cookedPath),
+        _numRedirected(0) {}
+
+    osgDB::ReaderWriter::ReadResult CookedImageReadCallback::readImage(const std::string& fileName, const osgDB::Options* options) {
+        std::string sourceFile = osgDB::findDataFile(fileName, options);
+        if (!sourceFile.empty() && osgDB::getLowerCaseFileExtension(sourceFile) != "dds") {
+            std::string cookedFile = TextureCookVisitor::getCookedFile(_cookedPath, sourceFile);
+            if (TextureCookVisitor::isCookedUpToDate(cookedFile, sourceFile)) {
+                osgDB::ReaderWriter::ReadResult result = osgDB::Registry::instance()->readImageImplementation(cookedFile, options);
+                if (result.validImage()) {
+                    //the TextureCookVisitor and the caches still see the original name
+                    result.getImage()->setFileName(fileName);
+                    ++_numRedirected;
+                    return result;
+                }
+            }
+        }
+        return osgDB::Registry::instance()->readImageImplementation(fileName, options);
+    }
+
+    unsigned int CookedImageReadCallback::getNumRedirected() const {
+        return _numRedirected;
+    }
+
+    TextureCookVisitor::TextureCookVisitor(bool cook, const std::string& cookedPath) :
+        NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _cook(cook),
+        _cookedPath(cookedPath),
+        _numLoaded(0),
+        _numCooked(0),
+        _numDriverCompressed(0),
+        _bytesBefore(0),
+        _bytesAfter(0) {
+        if (_cook)
+            osgDB::makeDirectory(_cookedPath);
+    }
+
+    void TextureCookVisitor::apply(Node& node) {
+        applyStateSet(node.getStateSet());
+        traverse(node);
+    }
+
+    void TextureCookVisitor::apply(Geode& geode) {
+        applyStateSet(geode.getStateSet());
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i)
+            applyStateSet(geode.getDrawable(i)->getStateSet());
+        traverse(geode);
+    }
+
+    void TextureCookVisitor::applyStateSet(StateSet* stateSet) {
+        if (!stateSet || !_visited.insert(stateSet).second)
+            return;
+        const StateSet::TextureAttributeList& texAttribs = stateSet->getTextureAttributeList();
+        for (unsigned int unit = 0; unit < texAttribs.size(); ++unit) {
+            Texture2D* texture = dynamic_cast<Texture2D*>(stateSet->getTextureAttribute(unit, StateAttribute::TEXTURE));
+            if (texture && _visited.insert(texture).second)
+                applyTexture(*texture);
+        }
+    }
+
+    void TextureCookVisitor::applyTexture(Texture2D& texture) {
+        Image* image = texture.getImage();
+        //render targets have no image, the toon ramps must not be filtered
+        if (!image || !image->data() || texture.getFilter(Texture::MIN_FILTER) == Texture::NEAREST)
+            return;
+        if (image->isCompressed()) {
+            //already cooked (redirected by the CookedImageReadCallback), the mip chain is only used with a mipmap filter
+            if (image->isMipmap()) {
+                texture.setUseHardwareMipMapGeneration(false);
+                texture.setFilter(Texture::MIN_FILTER, Texture::LINEAR_MIPMAP_LINEAR);
+            }
+            return;
+        }
+
+        //embedded images keep the name of the file they were exported from, which may not exist anymore
+        std::string sourceFile = osgDB::findDataFile(image->getFileName());
+        if (sourceFile.empty())
+            sourceFile = image->getFileName();
+        //same key as the CookedImageReadCallback
+        std::string cookedFile = getCookedFile(_cookedPath, sourceFile);
+        ref_ptr<Image> cooked;
+        if (!cookedFile.empty()) {
+            if (isCookedUpToDate(cookedFile, sourceFile)) {
+                cooked = osgDB::readImageFile(cookedFile);
+                if (cooked)
+                    _numLoaded++;
+            }
+            else if (_cook) {
+                cooked = cook(*image, cookedFile);
+                if (cooked)
+                    _numCooked++;
+            }
+        }
+
+        if (cooked && cooked->s() == image->s() && cooked->t() == image->t()) {
+            //the mip chain is part of the file
+            _bytesBefore += image->getTotalSizeInBytesIncludingMipmaps();
+            texture.setImage(cooked);
+            texture.setUseHardwareMipMapGeneration(false);
+            _bytesAfter += cooked->getTotalSizeInBytesIncludingMipmaps();
+        }
+        else {
+            //not cooked: the driver compresses, the mipmaps are generated upon the upload
+            texture.setInternalFormatMode(image->isImageTranslucent() ? Texture::USE_S3TC_DXT5_COMPRESSION
+                                                                      : Texture::USE_S3TC_DXT1_COMPRESSION);
+            _numDriverCompressed++;
+        }
+        texture.setFilter(Texture::MIN_FILTER, Texture::LINEAR_MIPMAP_LINEAR);
+    }
+
+    ref_ptr<Image> TextureCookVisitor::cook(const Image& image, const std::string& cookedFile) const {
+        osgDB::ImageProcessor* processor = osgDB::Registry::instance()->getImageProcessor();
+        if (!processor) {
+            OSG_ALWAYS << "No ImageProcessor (nvtt plugin), " << cookedFile << " is not cooked." << std::endl;
+            return nullptr;
+        }
+        osgDB::makeDirectoryForFile(cookedFile);
+        ref_ptr<Image> compressed = new Image(image, CopyOp::DEEP_COPY_ALL);
+        //resizing would break the size check against the original image
+        processor->compress(*compressed, image.isImageTranslucent() ? Texture::USE_S3TC_DXT5_COMPRESSION : Texture::USE_S3TC_DXT1_COMPRESSION,
+                            true, false, osgDB::ImageProcessor::USE_CPU, osgDB::ImageProcessor::PRODUCTION);
+        if (!compressed->isCompressed() || !osgDB::writeImageFile(*compressed, cookedFile)) {
+            OSG_ALWAYS << "Could not cook " << cookedFile << std::endl;
+            return nullptr;
+        }
+        return compressed;
+    }
+
+    unsigned int TextureCookVisitor::getNumLoaded() const {
+        return _numLoaded;
+    }
+
+    unsigned int TextureCookVisitor::getNumCooked() const {
+        return _numCooked;
+    }
+
+    unsigned int TextureCookVisitor::getNumDriverCompressed() const {
+        return _numDriverCompressed;
+    }
+
+    unsigned int TextureCookVisitor::getBytesBefore() const {
+        return _bytesBefore;
+    }
+
+    unsigned int TextureCookVisitor::getBytesAfter() const {
+        return _bytesAfter;
+    }
+
+}
@@ -1,10 +1,14 @@
 #include "../header/UtilFunctions.h"
 #include "../header/CelShading.h"
+#include "../header/FontManager.h"
+#include "../header/MeshBuilder.h"
+#include "../header/FogFarPlaneCallback.h"
 #include <osgText/Text>
 #include <osg/PolygonMode>
 #include <osg/LightSource>
 #include <osg/BlendFunc>
 #include <osg/ComputeBoundsVisitor>
+#include <osg/ValueObject>
 #include <osg/Point>
 #include <osg/PointSprite>
 #include <osgParticle/ParticleSystem>
@@ -17,12 +21,29 @@
 #include <osgParticle/RadialShooter>
 #include <osgParticle/FluidFrictionOperator>
 #include <osgParticle/AccelOperator>
+#include <algorithm>
 
 using namespace osg;
 
 namespace brtr{
+
+    namespace {
+        bool coreShaders = false;
+    }
+
+    void setCoreShaders(bool core) {
+        coreShaders = core;
+    }
+
+    bool getCoreShaders() {
+        return coreShaders;
+    }
+
+    std::string shaderFile(const std::string& name) {
+        return (coreShaders ? "../Shader/core/" : "../Shader/") + name;
+    }
   
-    ref_ptr<osg::Camera> createRTTCamera(osg::Camera::BufferComponent buffer, osg::Texture* tex, bool isAbsolute) {
+    ref_ptr<osg::Camera> createRTTCamera(osg::Camera::BufferComponent buffer, osg::Texture* tex, bool isAbsolute, unsigned int samples) {
         osg::ref_ptr<osg::Camera> camera = new osg::Camera;
         camera->setClearColor(osg::Vec4());
         camera->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -32,7 +53,7 @@ namespace brtr{
             tex->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR);
             tex->setFilter(osg::Texture2D::MAG_FILTER, osg::Texture2D::LINEAR);
             camera->setViewport(0, 0, tex->getTextureWidth(), tex->getTextureHeight());
-            camera->attach(buffer, tex);
+            camera->attach(buffer, tex, 0, 0, false, samples, samples);
         }
 
         if (isAbsolute) {
@@ -208,10 +229,11 @@ namespace brtr{
     }
 
     osg::ref_ptr<osgText::Text> createText(const osg::Vec3& pos, const std::string& content, float size) {
-        osg::ref_ptr<osgText::Font> g_font = osgText::readFontFile("../fonts/dirtydoz.ttf");
         osg::ref_ptr<osgText::Text> text = new osgText::Text;
         text->setDataVariance(osg::Object::DYNAMIC);
-        text->setFont(g_font);
+        //shared font, the glyphs are already in its atlas
+        text->setFont(FontManager::instance().getFont());
+        text->setFontResolution(FontManager::glyphResolution, FontManager::glyphResolution);
         text->setCharacterSize(size);
         text->setAxisAlignment(osgText::TextBase::XY_PLANE);
         text->setPosition(pos);
@@ -243,51 +265,25 @@ namespace brtr{
   }
 
 	ref_ptr<osg::Group> createCuboid(const double length, const double width, const double height, const double faktor){
-
+		//one drawable for all six sides
+		MeshBuilder builder;
+		builder.addCuboid(length, width, height, faktor);
 		ref_ptr<Group> cube = new Group();
-		Geode *cubeSides[6];
-		MatrixTransform *cubeTrans[6];
-		for (int i = 0; i < 6; i++){
-			cubeSides[i] = new Geode();
-			cubeTrans[i] = new MatrixTransform;
-			
-		}
-		cubeSides[0]->addDrawable(createRectangleWithTexcoords(length, width, (int)(length * faktor) + 1, (int)(width * faktor) + 1));
-		cubeSides[1]->addDrawable(createRectangleWithTexcoords(length, width, (int)(length * faktor) + 1, (int)(width * faktor) + 1));
-
-		cubeSides[2]->addDrawable(createRectangleWithTexcoords(height, width, (int)(height * faktor) + 1, (int)(width * faktor) + 1));
-		cubeSides[3]->addDrawable(createRectangleWithTexcoords(height, width, (int)(height * faktor) + 1, (int)(width * faktor) + 1));
-
-		cubeSides[4]->addDrawable(createRectangleWithTexcoords(height, length, (int)(height * faktor) + 1, (int)(length * faktor) + 1));
-		cubeSides[5]->addDrawable(createRectangleWithTexcoords(height, length, (int)(height * faktor) + 1, (int)(length * faktor) + 1));
-
-		cubeTrans[0]->setMatrix(osg::Matrix::translate(0, 0, height));
-		cubeTrans[1]->setMatrix(osg::Matrix::rotate((3 / 2)*PI, 1, 0, 0)*osg::Matrix::translate(0.0f, width, 0));
-
-		cubeTrans[2]->setMatrix(osg::Matrix::rotate(PI / 2, 0, 1, 0)*osg::Matrix::translate(length, 0, height));
-		cubeTrans[3]->setMatrix(osg::Matrix::rotate((PI / 2) * 3, 0, 1, 0));
-
-		cubeTrans[4]->setMatrix(osg::Matrix::rotate((PI / 2), 0, 0, 1)*osg::Matrix::rotate((PI / 2), 1, 0, 0)*osg::Matrix::translate(length, 0, 0));
-		cubeTrans[5]->setMatrix(osg::Matrix::rotate((PI / 2) * 3, 0, 0, 1)*osg::Matrix::rotate((PI / 2) * 3, 1, 0, 0)*osg::Matrix::translate(0, width, 0));
-
-		for (int i = 0; i < 6; i++){
-			cubeTrans[i]->addChild(cubeSides[i]);			
-			cube->addChild(cubeTrans[i]);
-		}
-
-		return cube.release();
-
+		cube->addChild(builder.build());
+		return cube;
 	}
 
 
-    void createRenderingPipeline(unsigned int width, unsigned int height, osg::Node& rootForToon, osgViewer::Viewer &viewer, RenderingPipeline& pipe, Vec3f& fogColor) {
-        osg::ref_ptr<brtr::CelShading> toonRoot = new brtr::CelShading;
+    void createRenderingPipeline(unsigned int width, unsigned int height, osg::Node& rootForToon, osgViewer::Viewer &viewer, RenderingPipeline& pipe, Vec3f& fogColor,
+                                 bool outlines, unsigned int samples, unsigned int program, bool depthPrePass) {
+        osg::ref_ptr<brtr::CelShading> toonRoot = new brtr::CelShading(outlines, "celShader.vert", depthPrePass);
         toonRoot->addChild(&rootForToon);
 
         osg::ref_ptr<osg::Texture2D> toonAndOutline = new osg::Texture2D;
         toonAndOutline->setTextureSize(width, height);
         toonAndOutline->setInternalFormat(GL_RGBA);
-        osg::ref_ptr<osg::Camera> rttCamToon = brtr::createRTTCamera(osg::Camera::COLOR_BUFFER, toonAndOutline);
+        osg::ref_ptr<osg::Camera> rttCamToon = brtr::createRTTCamera(osg::Camera::COLOR_BUFFER, toonAndOutline, false, samples);
+        rttCamToon->setCullMask(~collisionProxyMask);
         rttCamToon->addChild(toonRoot);
 
         //taken from the OSG Beginners Guide
@@ -297,24 +293,25 @@ namespace brtr{
         deepth->setSourceFormat(GL_DEPTH_COMPONENT);
         deepth->setSourceType(GL_FLOAT);
 
-        osg::ref_ptr<osg::Camera> rttCamDepth = brtr::createRTTCamera(osg::Camera::DEPTH_BUFFER, deepth);
+        osg::ref_ptr<osg::Camera> rttCamDepth = brtr::createRTTCamera(osg::Camera::DEPTH_BUFFER, deepth, false, samples);
+        rttCamDepth->setCullMask(~collisionProxyMask);
         rttCamDepth->addChild(toonRoot);
 
         osg::ref_ptr<Camera> postProcessCam = brtr::createHUDCamera(0, 1, 0, 1);
         postProcessCam->addChild(brtr::createScreenQuad(width, height));
 
-        osg::ref_ptr<osg::Shader> fogFrag = osgDB::readShaderFile("../Shader/fogShader.frag");
-        osg::ref_ptr<osg::Shader> fogVert = osgDB::readShaderFile("../Shader/fogShader.vert");
+        osg::ref_ptr<osg::Shader> fogFrag = osgDB::readShaderFile(shaderFile("fogShader.frag"));
+        osg::ref_ptr<osg::Shader> fogVert = osgDB::readShaderFile(shaderFile("fogShader.vert"));
         osg::ref_ptr<osg::Program> fogProgram = new osg::Program;
         fogProgram->addShader(fogFrag);
         fogProgram->addShader(fogVert);
 
-        osg::ref_ptr<osg::Shader> sepiaFogFrag = osgDB::readShaderFile("../Shader/sepiaFogShader.frag");
+        osg::ref_ptr<osg::Shader> sepiaFogFrag = osgDB::readShaderFile(shaderFile("sepiaFogShader.frag"));
         osg::ref_ptr<osg::Program> sepiaFogProgram = new osg::Program;
         sepiaFogProgram->addShader(sepiaFogFrag);
         sepiaFogProgram->addShader(fogVert);
 
-        osg::ref_ptr<osg::Shader> wavesFrag = osgDB::readShaderFile("../Shader/sinShader.frag");
+        osg::ref_ptr<osg::Shader> wavesFrag = osgDB::readShaderFile(shaderFile("sinShader.frag"));
         osg::ref_ptr<osg::Program> wavesProgram = new osg::Program;
         wavesProgram->addShader(wavesFrag);
         wavesProgram->addShader(fogVert);
@@ -324,6 +321,14 @@ namespace brtr{
         programVector.push_back(fogProgram);
         programVector.push_back(sepiaFogProgram);
         programVector.push_back(wavesProgram);
+        //fog range along the view axis, same as the former shader constants (120 to 16000 in their depth metric at zNear 0.01)
+        const float fogStart = 0.6f, fogEnd = 80.0f;
+        for (auto prog = programVector.begin(); prog != programVector.end(); ++prog) {
+            (*prog)->setUserValue("fogStart", fogStart);
+            (*prog)->setUserValue("fogEnd", fogEnd);
+        }
+        if (program < programVector.size())
+            std::rotate(programVector.begin(), programVector.begin() + program, programVector.end());
 
         //postprocess Attributs and Mods
         postProcessCam->getOrCreateStateSet()->setAttributeAndModes(programVector[0], osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
@@ -332,21 +337,43 @@ namespace brtr{
         postProcessCam->getOrCreateStateSet()->setTextureAttributeAndModes(1, deepth, osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
         postProcessCam->getOrCreateStateSet()->addUniform(new osg::Uniform("deepth", 1), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
         postProcessCam->getOrCreateStateSet()->addUniform(new osg::Uniform("fogColor", fogColor), osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+        //rendered part of the textures, less than 1 if the first pass uses a smaller viewport (DynamicResolutionHandler)
+        osg::ref_ptr<osg::Uniform> rttScale = new osg::Uniform("rttScale", osg::Vec2(1.0f, 1.0f));
+        rttScale->setDataVariance(osg::Object::DYNAMIC);
+        postProcessCam->getOrCreateStateSet()->addUniform(rttScale, osg::StateAttribute::OVERRIDE | osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
 
-        //setting Clipping Pane
+        //setting Clipping Pane, the far plane follows the fog end of the active program
         float zNear = 0.01, zFar = 100000;
         osg::ref_ptr<osg::Uniform> zNearUniform = new osg::Uniform("zNear", zNear);
         osg::ref_ptr<osg::Uniform> zFarUniform = new osg::Uniform("zFar", zFar);
+        osg::ref_ptr<osg::Uniform> fogStartUniform = new osg::Uniform("fogStart", fogStart);
+        osg::ref_ptr<osg::Uniform> fogEndUniform = new osg::Uniform("fogEnd", fogEnd);
+        zFarUniform->setDataVariance(osg::Object::DYNAMIC);
+        fogStartUniform->setDataVariance(osg::Object::DYNAMIC);
+        fogEndUniform->setDataVariance(osg::Object::DYNAMIC);
         postProcessCam->getOrCreateStateSet()->addUniform(zNearUniform);
         postProcessCam->getOrCreateStateSet()->addUniform(zFarUniform);
+        postProcessCam->getOrCreateStateSet()->addUniform(fogStartUniform);
+        postProcessCam->getOrCreateStateSet()->addUniform(fogEndUniform);
+        postProcessCam->addUpdateCallback(new FogFarPlaneCallback(viewer.getCamera(), zFarUniform, fogStartUniform, fogEndUniform, zFar));
         viewer.getCamera()->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
-        viewer.getCamera()->setProjectionMatrixAsPerspective(70, 1.778, zNear, zFar);
+        viewer.getCamera()->setProjectionMatrixAsPerspective(70, (double)width / height, zNear, zFar);
+        //everything behind the far plane is completely in the fog
+        viewer.getCamera()->setCullingMode(viewer.getCamera()->getCullingMode() | osg::CullSettings::FAR_PLANE_CULLING);
+        rttCamToon->setCullingMode(rttCamToon->getCullingMode() | osg::CullSettings::FAR_PLANE_CULLING);
+        rttCamDepth->setCullingMode(rttCamDepth->getCullingMode() | osg::CullSettings::FAR_PLANE_CULLING);
 
         //Setting Pipeline
         pipe.pass_0_color = rttCamToon;
         pipe.pass_0_depth = rttCamDepth;
+        pipe.toonEffect = toonRoot;
         pipe.pass_PostProcess = postProcessCam;
         pipe.programs = programVector;
+        pipe.colorTexture = toonAndOutline;
+        pipe.depthTexture = deepth;
+        pipe.rttScale = rttScale;
+        pipe.width = width;
+        pipe.height = height;
     }
 
     osg::ref_ptr<osg::Geometry> createBeerBottle() {
@@ -611,11 +638,31 @@ namespace brtr{
         return size;
     }
 
-    osg::ref_ptr<osg::Texture2D> createToonTex(std::string toonTex) {
-        osg::ref_ptr<osg::Texture2D> toonTexture = new osg::Texture2D;
-        toonTexture->setImage(osgDB::readImageFile("../BlenderFiles/Texturen/toons/" + toonTex));
+    osg::ref_ptr<osg::Texture2DArray> createToonTexArray(const std::vector<std::string>& toonTexs) {
+        osg::ref_ptr<osg::Texture2DArray> toonTexture = new osg::Texture2DArray;
+        int width = 0, height = 0;
+        unsigned int layer = 0;
+        for (auto toonTex = toonTexs.begin(); toonTex != toonTexs.end(); ++toonTex) {
+            osg::ref_ptr<osg::Image> image = osgDB::readImageFile("../BlenderFiles/Texturen/toons/" + *toonTex);
+            if (!image) {
+                OSG_ALWAYS << "Toon texture " << *toonTex << " not found." << std::endl;
+                continue;
+            }
+            //all layers share the size of the first one
+            if (layer == 0) {
+                width = image->s();
+                height = image->t();
+            }
+            else if (image->s() != width || image->t() != height)
+                image->scaleImage(width, height, 1);
+            toonTexture->setImage(layer++, image);
+        }
+        toonTexture->setTextureSize(width, height, layer);
+        //ramps, no filtering between the steps or into the neighbour layers
         toonTexture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
         toonTexture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+        toonTexture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        toonTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
         return toonTexture;
     }
 
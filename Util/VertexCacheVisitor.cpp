@@ -0,0 +1,307 @@
+#include "../header/VertexCacheVisitor.h"
+#include "../header/TriangleCollector.h"
+#include <osg/TriangleIndexFunctor>
+#include <osg/KdTree>
+#include <algorithm>
+#include <cmath>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //constants from Tom Forsyth's article
+        const float cacheDecayPower = 1.5f;
+        const float lastTriangleScore = 0.75f;
+        const float valenceBoostScale = 2.0f;
+        const float valenceBoostPower = 0.5f;
+
+        float vertexScore(int cachePosition, unsigned int remaining, unsigned int cacheSize) {
+            if (remaining == 0)
+                return -1.0f;
+            float score = 0.0f;
+            if (cachePosition >= 0) {
+                //the vertices of the last triangle get a fixed score, so the next one does not just reuse two of them
+                if (cachePosition < 3)
+                    score = lastTriangleScore;
+                else
+                    score = std::pow(1.0f - (float)(cachePosition - 3) / (cacheSize - 3), cacheDecayPower);
+            }
+            //vertices with few triangles left are preferred, to get rid of them
+            score += valenceBoostScale * std::pow((float)remaining, -valenceBoostPower);
+            return score;
+        }
+
+        template<class ArrayType>
+        bool remapArray(Array* array, const std::vector<unsigned int>& oldIndices, bool apply) {
+            ArrayType* typed = dynamic_cast<ArrayType*>(array);
+            if (!typed)
+                return false;
+            if (apply) {
+                std::vector<typename ArrayType::ElementDataType> old(typed->begin(), typed->end());
+                typed->resize(oldIndices.size());
+                for (unsigned int i = 0; i < oldIndices.size(); ++i)
+                    (*typed)[i] = old[oldIndices[i]];
+                typed->dirty();
+            }
+            return true;
+        }
+
+        /**
+         * new element i is the old element oldIndices[i], with apply == false it only checks the type
+         */
+        bool remap(Array* array, const std::vector<unsigned int>& oldIndices, bool apply) {
+            return remapArray<Vec2Array>(array, oldIndices, apply)
+                || remapArray<Vec3Array>(array, oldIndices, apply)
+                || remapArray<Vec4Array>(array, oldIndices, apply)
+                || remapArray<Vec4ubArray>(array, oldIndices, apply)
+                || remapArray<FloatArray>(array, oldIndices, apply);
+        }
+
+        bool isTriangleMode(GLenum mode) {
+            return mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN
+                || mode == GL_QUADS || mode == GL_QUAD_STRIP || mode == GL_POLYGON;
+        }
+    }
+
+    VertexCacheVisitor::VertexCacheVisitor(unsigned int cacheSize) :
+        NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _cacheSize(std::max(cacheSize, 4u)),
+        _numOptimized(0),
+        _numSkipped(0),
+        _numTriangles(0),
+        _missesBefore(0),
+        _missesAfter(0) {}
+
+    void VertexCacheVisitor::apply(Geode& geode) {
+        bool rebuildKdTrees = false;
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            Geometry* geometry = geode.getDrawable(i)->asGeometry();
+            //shared geometry (e.g. the placed bottles) only once
+            if (!geometry || !_visited.insert(geometry).second)
+                continue;
+            bool hasKdTree = dynamic_cast<KdTree*>(geometry->getShape()) != nullptr;
+            if (optimize(*geometry) && hasKdTree) {
+                //the KdTree stores vertex indices
+                geometry->setShape(nullptr);
+                rebuildKdTrees = true;
+            }
+        }
+        if (rebuildKdTrees) {
+            KdTreeBuilder kdTreeBuilder;
+            geode.accept(kdTreeBuilder);
+        }
+    }
+
+    bool VertexCacheVisitor::collectArrays(Geometry& geometry, std::vector<Array*>& arrays) const {
+        if (geometry.getDataVariance() == Object::DYNAMIC || !geometry.suitableForOptimization())
+            return false;
+        Array* vertices = geometry.getVertexArray();
+        if (!vertices || vertices->getNumElements() == 0 || geometry.getNumPrimitiveSets() == 0)
+            return false;
+        for (unsigned int i = 0; i < geometry.getNumPrimitiveSets(); ++i) {
+            if (!isTriangleMode(geometry.getPrimitiveSet(i)->getMode()))
+                return false;
+        }
+
+        unsigned int numVertices = vertices->getNumElements();
+        std::vector<std::pair<Array*, Geometry::AttributeBinding>> candidates;
+        candidates.push_back(std::make_pair(vertices, Geometry::BIND_PER_VERTEX));
+        candidates.push_back(std::make_pair(geometry.getNormalArray(), geometry.getNormalBinding()));
+        candidates.push_back(std::make_pair(geometry.getColorArray(), geometry.getColorBinding()));
+        candidates.push_back(std::make_pair(geometry.getSecondaryColorArray(), geometry.getSecondaryColorBinding()));
+        candidates.push_back(std::make_pair(geometry.getFogCoordArray(), geometry.getFogCoordBinding()));
+        for (unsigned int i = 0; i < geometry.getNumTexCoordArrays(); ++i)
+            candidates.push_back(std::make_pair(geometry.getTexCoordArray(i), Geometry::BIND_PER_VERTEX));
+        for (unsigned int i = 0; i < geometry.getNumVertexAttribArrays(); ++i)
+            candidates.push_back(std::make_pair(geometry.getVertexAttribArray(i), geometry.getVertexAttribBinding(i)));
+
+        std::vector<unsigned int> none;
+        for (auto candidate = candidates.begin(); candidate != candidates.end(); ++candidate) {
+            Array* array = candidate->first;
+            if (!array || candidate->second == Geometry::BIND_OFF || candidate->second == Geometry::BIND_OVERALL)
+                continue;
+            //per primitive bindings would need the old primitive order
+            if (candidate->second != Geometry::BIND_PER_VERTEX || array->getNumElements() != numVertices)
+                return false;
+            //an array used by another geometry too must not be reordered
+            if (array->referenceCount() > 1 || !remap(array, none, false))
+                return false;
+            arrays.push_back(array);
+        }
+        return true;
+    }
+
+    bool VertexCacheVisitor::optimize(Geometry& geometry) {
+        std::vector<Array*> arrays;
+        if (!collectArrays(geometry, arrays)) {
+            _numSkipped++;
+            return false;
+        }
+        unsigned int numVertices = geometry.getVertexArray()->getNumElements();
+        std::vector<unsigned int> indices;
+        TriangleIndexFunctor<TriangleCollector> collector;
+        collector.indices = &indices;
+        geometry.accept(collector);
+        if (indices.empty()) {
+            _numSkipped++;
+            return false;
+        }
+
+        std::vector<unsigned int> ordered = optimizeTriangleOrder(indices, numVertices);
+
+        //vertices in the order of their first use, unused ones are dropped
+        std::vector<int> newIndices(numVertices, -1);
+        std::vector<unsigned int> oldIndices;
+        oldIndices.reserve(numVertices);
+        for (auto index = ordered.begin(); index != ordered.end(); ++index) {
+            if (newIndices[*index] < 0) {
+                newIndices[*index] = oldIndices.size();
+                oldIndices.push_back(*index);
+            }
+            *index = newIndices[*index];
+        }
+        for (auto array = arrays.begin(); array != arrays.end(); ++array)
+            remap(*array, oldIndices, true);
+
+        geometry.removePrimitiveSet(0, geometry.getNumPrimitiveSets());
+        if (oldIndices.size() <= 65536)
+            geometry.addPrimitiveSet(new DrawElementsUShort(GL_TRIANGLES, ordered.begin(), ordered.end()));
+        else
+            geometry.addPrimitiveSet(new DrawElementsUInt(GL_TRIANGLES, ordered.begin(), ordered.end()));
+        geometry.dirtyDisplayList();
+        geometry.dirtyBound();
+
+        _numOptimized++;
+        _numTriangles += ordered.size() / 3;
+        _missesBefore += countCacheMisses(indices);
+        _missesAfter += countCacheMisses(ordered);
+        return true;
+    }
+
+    std::vector<unsigned int> VertexCacheVisitor::optimizeTriangleOrder(const std::vector<unsigned int>& indices, unsigned int numVertices) const {
+        unsigned int numTriangles = indices.size() / 3;
+
+        //triangles of every vertex, the first remaining[v] entries are the not yet emitted ones
+        std::vector<unsigned int> offsets(numVertices + 1, 0);
+        for (auto index = indices.begin(); index != indices.end(); ++index)
+            offsets[*index + 1]++;
+        for (unsigned int v = 0; v < numVertices; ++v)
+            offsets[v + 1] += offsets[v];
+        std::vector<unsigned int> remaining(numVertices);
+        for (unsigned int v = 0; v < numVertices; ++v)
+            remaining[v] = offsets[v + 1] - offsets[v];
+        std::vector<unsigned int> adjacency(indices.size());
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (unsigned int i = 0; i < indices.size(); ++i)
+            adjacency[fill[indices[i]]++] = i / 3;
+
+        std::vector<int> cachePosition(numVertices, -1);
+        std::vector<float> vertexScores(numVertices);
+        for (unsigned int v = 0; v < numVertices; ++v)
+            vertexScores[v] = vertexScore(-1, remaining[v], _cacheSize);
+        std::vector<float> triangleScores(numTriangles);
+        std::vector<bool> emitted(numTriangles, false);
+        int best = -1;
+        float bestScore = -1.0f;
+        for (unsigned int t = 0; t < numTriangles; ++t) {
+            triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+            if (triangleScores[t] > bestScore) {
+                bestScore = triangleScores[t];
+                best = t;
+            }
+        }
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+        std::vector<unsigned int> cache;
+        std::vector<unsigned int> newCache;
+        cache.reserve(_cacheSize + 3);
+        newCache.reserve(_cacheSize + 3);
+        unsigned int cursor = 0;
+        for (unsigned int n = 0; n < numTriangles; ++n) {
+            //no triangle touches the cache, continue with the next one in the original order
+            if (best < 0) {
+                while (emitted[cursor])
+                    cursor++;
+                best = cursor;
+            }
+            emitted[best] = true;
+            const unsigned int* triangle = &indices[3 * best];
+            newCache.assign(triangle, triangle + 3);
+            for (unsigned int k = 0; k < 3; ++k) {
+                unsigned int v = triangle[k];
+                result.push_back(v);
+                unsigned int* begin = &adjacency[offsets[v]];
+                unsigned int* end = begin + remaining[v];
+                std::iter_swap(std::find(begin, end, (unsigned int)best), end - 1);
+                remaining[v]--;
+            }
+            for (auto v = cache.begin(); v != cache.end(); ++v) {
+                if (*v != triangle[0] && *v != triangle[1] && *v != triangle[2])
+                    newCache.push_back(*v);
+            }
+
+            //new cache positions and scores, also for the vertices just pushed out of the cache
+            for (unsigned int i = 0; i < newCache.size(); ++i) {
+                unsigned int v = newCache[i];
+                cachePosition[v] = i < _cacheSize ? (int)i : -1;
+                vertexScores[v] = vertexScore(cachePosition[v], remaining[v], _cacheSize);
+            }
+            best = -1;
+            bestScore = -1.0f;
+            for (unsigned int i = 0; i < newCache.size(); ++i) {
+                unsigned int v = newCache[i];
+                for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; ++a) {
+                    unsigned int t = adjacency[a];
+                    triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+                    if (i < _cacheSize && triangleScores[t] > bestScore) {
+                        bestScore = triangleScores[t];
+                        best = t;
+                    }
+                }
+            }
+            if (newCache.size() > _cacheSize)
+                newCache.resize(_cacheSize);
+            cache.swap(newCache);
+        }
+        return result;
+    }
+
+    unsigned int VertexCacheVisitor::countCacheMisses(const std::vector<unsigned int>& indices) const {
+        //simple FIFO cache, like most hardware uses
+        std::vector<unsigned int> fifo;
+        fifo.reserve(_cacheSize);
+        unsigned int next = 0;
+        unsigned int misses = 0;
+        for (auto index = indices.begin(); index != indices.end(); ++index) {
+            if (std::find(fifo.begin(), fifo.end(), *index) != fifo.end())
+                continue;
+            misses++;
+            if (fifo.size() < _cacheSize)
+                fifo.push_back(*index);
+            else {
+                fifo[next] = *index;
+                next = (next + 1) % _cacheSize;
+            }
+        }
+        return misses;
+    }
+
+    unsigned int VertexCacheVisitor::getNumOptimizedGeometries() const {
+        return _numOptimized;
+    }
+
+    unsigned int VertexCacheVisitor::getNumSkippedGeometries() const {
+        return _numSkipped;
+    }
+
+    double VertexCacheVisitor::getACMRBefore() const {
+        return _numTriangles ? (double)_missesBefore / _numTriangles : 0.0;
+    }
+
+    double VertexCacheVisitor::getACMRAfter() const {
+        return _numTriangles ? (double)_missesAfter / _numTriangles : 0.0;
+    }
+
+}
@@ -0,0 +1,211 @@
+#include "../header/VertexCompressionVisitor.h"
+#include <osg/BoundingBox>
+#include <osg/Uniform>
+#include <cmath>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        //larger texture coordinates (tiled textures) would lose too much precision as half floats
+        const float maxHalfTexCoord = 16.0f;
+
+        unsigned short toHalf(float value) {
+            union { float f; unsigned int u; } bits;
+            bits.f = value;
+            unsigned int sign = (bits.u >> 16) & 0x8000;
+            int exponent = (int)((bits.u >> 23) & 0xff) - 127 + 15;
+            unsigned int mantissa = bits.u & 0x7fffff;
+            if (exponent <= 0) {
+                //denormalized half or zero
+                if (exponent < -10)
+                    return (unsigned short)sign;
+                mantissa |= 0x800000;
+                unsigned int shift = 14 - exponent;
+                unsigned int half = mantissa >> shift;
+                if ((mantissa >> (shift - 1)) & 1)
+                    half++;
+                return (unsigned short)(sign | half);
+            }
+            if (exponent >= 31)
+                return (unsigned short)(sign | 0x7c00);
+            unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+            //rounding may carry into the exponent, which is still correct
+            if (mantissa & 0x1000)
+                half++;
+            return (unsigned short)half;
+        }
+
+        unsigned int packSigned10(float value) {
+            int packed = (int)std::floor(clampBetween(value, -1.0f, 1.0f) * 511.0f + 0.5f);
+            return (unsigned int)packed & 0x3ff;
+        }
+
+        unsigned int packNormal(Vec3 normal) {
+            normal.normalize();
+            return packSigned10(normal.x()) | (packSigned10(normal.y()) << 10) | (packSigned10(normal.z()) << 20);
+        }
+    }
+
+    VertexCompressionVisitor::VertexCompressionVisitor(const std::vector<unsigned int>& intersectionMasks, unsigned int minQuantizedVertices) :
+        NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _intersectionMasks(intersectionMasks),
+        _minQuantizedVertices(minQuantizedVertices),
+        _numCompressed(0),
+        _numQuantized(0),
+        _bytesBefore(0),
+        _bytesAfter(0) {}
+
+    void VertexCompressionVisitor::apply(Geode& geode) {
+        for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            Geometry* geometry = geode.getDrawable(i)->asGeometry();
+            //shared geometry (e.g. the placed bottles) only once
+            if (!geometry || !_visited.insert(geometry).second)
+                continue;
+            compress(*geometry, !isNeededForIntersection(*geometry));
+        }
+    }
+
+    bool VertexCompressionVisitor::compress(Geometry& geometry, bool quantizePositions) {
+        if (geometry.getDataVariance() == Object::DYNAMIC || !geometry.suitableForOptimization())
+            return false;
+        Vec3Array* vertices = dynamic_cast<Vec3Array*>(geometry.getVertexArray());
+        if (!vertices || vertices->empty())
+            return false;
+        unsigned int numVertices = vertices->size();
+
+        //arrays used by another geometry too stay untouched
+        Vec3Array* normals = dynamic_cast<Vec3Array*>(geometry.getNormalArray());
+        if (normals && (geometry.getNormalBinding() != Geometry::BIND_PER_VERTEX || normals->size() != numVertices
+                        || normals->referenceCount() > 1))
+            normals = nullptr;
+        Vec2Array* texcoords = dynamic_cast<Vec2Array*>(geometry.getTexCoordArray(0));
+        if (texcoords && (texcoords->size() != numVertices || texcoords->referenceCount() > 1))
+            texcoords = nullptr;
+        for (unsigned int i = 0; texcoords && i < numVertices; ++i) {
+            if (std::fabs((*texcoords)[i].x()) > maxHalfTexCoord || std::fabs((*texcoords)[i].y()) > maxHalfTexCoord)
+                texcoords = nullptr;
+        }
+        quantizePositions = quantizePositions && numVertices >= _minQuantizedVertices && vertices->referenceCount() == 1;
+        //the attribute slots must be free
+        if (geometry.getVertexAttribArray(normalAttribute) || geometry.getVertexAttribArray(texCoordAttribute))
+            return false;
+        if (!normals && !texcoords && !quantizePositions)
+            return false;
+
+        StateSet* stateSet = getCompressedStateSet(geometry);
+        stateSet->addUniform(new Uniform("compressedNormals", normals != nullptr));
+        stateSet->addUniform(new Uniform("compressedTexCoords", texcoords != nullptr));
+        stateSet->addUniform(new Uniform("quantizedPositions", quantizePositions));
+
+        if (normals) {
+            ref_ptr<PackedNormalArray> packed = new PackedNormalArray(numVertices);
+            for (unsigned int i = 0; i < numVertices; ++i)
+                (*packed)[i] = packNormal((*normals)[i]);
+            _bytesBefore += normals->getTotalDataSize();
+            _bytesAfter += packed->getTotalDataSize();
+            geometry.setNormalArray(nullptr);
+            geometry.setNormalBinding(Geometry::BIND_OFF);
+            //i know, deprecated, but osg 3.0.1
+            geometry.setVertexAttribArray(normalAttribute, packed.get());
+            geometry.setVertexAttribBinding(normalAttribute, Geometry::BIND_PER_VERTEX);
+            geometry.setVertexAttribNormalize(normalAttribute, GL_TRUE);
+        }
+
+        if (texcoords) {
+            ref_ptr<HalfFloat2Array> halfs = new HalfFloat2Array(numVertices);
+            for (unsigned int i = 0; i < numVertices; ++i) {
+                (*halfs)[i].set((short)toHalf((*texcoords)[i].x()), (short)toHalf((*texcoords)[i].y()));
+            }
+            _bytesBefore += texcoords->getTotalDataSize();
+            _bytesAfter += halfs->getTotalDataSize();
+            geometry.setTexCoordArray(0, nullptr);
+            geometry.setVertexAttribArray(texCoordAttribute, halfs.get());
+            geometry.setVertexAttribBinding(texCoordAttribute, Geometry::BIND_PER_VERTEX);
+            geometry.setVertexAttribNormalize(texCoordAttribute, GL_FALSE);
+        }
+
+        if (quantizePositions) {
+            BoundingBox bb;
+            for (unsigned int i = 0; i < numVertices; ++i)
+                bb.expandBy((*vertices)[i]);
+            Vec3 halfExtent = (bb._max - bb._min) * 0.5f;
+            for (unsigned int i = 0; i < 3; ++i)
+                halfExtent[i] = maximum(halfExtent[i], 1e-6f);
+
+            //4 shorts keep the attribute 4 byte aligned, w is ignored by the shaders
+            ref_ptr<Vec4sArray> quantized = new Vec4sArray(numVertices);
+            for (unsigned int i = 0; i < numVertices; ++i) {
+                Vec3 relative = (*vertices)[i] - bb.center();
+                (*quantized)[i].set((short)std::floor(relative.x() / halfExtent.x() * 32767.0f + 0.5f),
+                                    (short)std::floor(relative.y() / halfExtent.y() * 32767.0f + 0.5f),
+                                    (short)std::floor(relative.z() / halfExtent.z() * 32767.0f + 0.5f),
+                                    1);
+            }
+            _bytesBefore += vertices->getTotalDataSize();
+            _bytesAfter += quantized->getTotalDataSize();
+            stateSet->addUniform(new Uniform("positionOffset", bb.center()));
+            stateSet->addUniform(new Uniform("positionScale", halfExtent / 32767.0f));
+            //the bound can not be computed from short vertices
+            geometry.setInitialBound(bb);
+            geometry.setVertexArray(quantized.get());
+            //KdTree is only used for intersections, which this geometry is not part of
+            geometry.setShape(nullptr);
+            _numQuantized++;
+        }
+
+        geometry.dirtyDisplayList();
+        _numCompressed++;
+        return true;
+    }
+
+    void VertexCompressionVisitor::bindAttributes(Program& program) {
+        program.addBindAttribLocation("packedNormal", normalAttribute);
+        program.addBindAttribLocation("packedTexCoord", texCoordAttribute);
+    }
+
+    bool VertexCompressionVisitor::isNeededForIntersection(Drawable& drawable) const {
+        //shared drawables are checked on every geode they are placed in
+        for (unsigned int i = 0; i < drawable.getNumParents(); ++i) {
+            NodePathList paths = drawable.getParent(i)->getParentalNodePaths();
+            for (auto path = paths.begin(); path != paths.end(); ++path) {
+                //the union of the masks would match nearly every path
+                for (auto mask = _intersectionMasks.begin(); mask != _intersectionMasks.end(); ++mask) {
+                    bool reachable = true;
+                    for (auto node = path->begin(); node != path->end(); ++node)
+                        reachable = reachable && ((*node)->getNodeMask() & *mask);
+                    if (reachable)
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    StateSet* VertexCompressionVisitor::getCompressedStateSet(Geometry& geometry) const {
+        //the uniforms belong to this geometry only, the StateSharingVisitor merges equal ones afterwards
+        ref_ptr<StateSet> stateSet = geometry.getStateSet()
+            ? new StateSet(*geometry.getStateSet(), CopyOp::SHALLOW_COPY)
+            : new StateSet;
+        geometry.setStateSet(stateSet.get());
+        return stateSet.get();
+    }
+
+    unsigned int VertexCompressionVisitor::getNumCompressedGeometries() const {
+        return _numCompressed;
+    }
+
+    unsigned int VertexCompressionVisitor::getNumQuantizedGeometries() const {
+        return _numQuantized;
+    }
+
+    unsigned int VertexCompressionVisitor::getBytesBefore() const {
+        return _bytesBefore;
+    }
+
+    unsigned int VertexCompressionVisitor::getBytesAfter() const {
+        return _bytesAfter;
+    }
+
+}
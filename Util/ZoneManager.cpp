@@ -0,0 +1,215 @@
+#include "../header/ZoneManager.h"
+#include "../header/ZoneCullCallback.h"
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Transform>
+#include <OpenThreads/ScopedLock>
+#include <cfloat>
+#include <set>
+#include <map>
+
+using namespace osg;
+
+namespace brtr {
+
+    namespace {
+        struct ZoneAssigner : public NodeVisitor {
+            ZoneAssigner(ZoneManager& manager) :
+                NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+                manager(manager),
+                numAssigned(0) {}
+            virtual void apply(Transform& transform) {
+                //moving content (the train) would stay bound to the zone it started in
+                if (transform.getDataVariance() == Object::DYNAMIC || transform.getUpdateCallback())
+                    return;
+                traverse(transform);
+            }
+            virtual void apply(Geode& geode) {
+                const BoundingSphere& sphere = geode.getBound();
+                if (!sphere.valid())
+                    return;
+                //the path below the assigned root, above it the geodes hang under both RTT cameras
+                Matrix localToWorld = computeLocalToWorld(getNodePath());
+                Vec3 center = sphere.center() * localToWorld;
+                Vec3d scale = localToWorld.getScale();
+                float radius = sphere.radius() * maximum(scale.x(), maximum(scale.y(), scale.z()));
+                BoundingBox box(center - Vec3(radius, radius, radius), center + Vec3(radius, radius, radius));
+                zones[&geode].insert(manager.findZone(box));
+            }
+            /**
+             * @brief binds the geodes, shared ones (e.g. the placed bottles) only if all their placements lie in one zone
+             */
+            void assign() {
+                for (auto geode = zones.begin(); geode != zones.end(); ++geode) {
+                    int zone = *geode->second.begin();
+                    if (geode->second.size() > 1 || zone < 0)
+                        continue;
+                    ref_ptr<NodeCallback> callback = new ZoneCullCallback(manager, zone);
+                    geode->first->addCullCallback(callback.get());
+                    numAssigned++;
+                }
+            }
+            ZoneManager& manager;
+            std::map<Geode*, std::set<int>> zones;
+            unsigned int numAssigned;
+        };
+    }
+
+    ZoneManager::ZoneManager(Camera* camera, float portalMargin) :
+        _camera(camera),
+        _portalMargin(portalMargin),
+        _computedFrame(~0u),
+        _numCulled(0) {}
+
+    unsigned int ZoneManager::addZone(const std::string& name, const BoundingBox& box) {
+        Zone zone;
+        zone.name = name;
+        zone.box = box;
+        _zones.push_back(zone);
+        _visible.push_back(true);
+        return _zones.size() - 1;
+    }
+
+    ZoneManager& ZoneManager::addPortal(unsigned int zoneA, unsigned int zoneB, const BoundingBox& opening) {
+        if (zoneA >= _zones.size() || zoneB >= _zones.size() || zoneA == zoneB)
+            return *this;
+        Portal portal;
+        portal.zoneA = zoneA;
+        portal.zoneB = zoneB;
+        portal.opening = opening;
+        _portals.push_back(portal);
+        _zones[zoneA].portals.push_back(_portals.size() - 1);
+        _zones[zoneB].portals.push_back(_portals.size() - 1);
+        return *this;
+    }
+
+    ZoneManager& ZoneManager::assign(Node* node, unsigned int zone) {
+        if (node && zone < _zones.size())
+            node->addCullCallback(new ZoneCullCallback(*this, zone));
+        return *this;
+    }
+
+    unsigned int ZoneManager::assign(Node* root) {
+        if (!root)
+            return 0;
+        ZoneAssigner assigner(*this);
+        root->accept(assigner);
+        assigner.assign();
+        return assigner.numAssigned;
+    }
+
+    bool ZoneManager::isVisible(unsigned int zone, const FrameStamp* frameStamp) {
+        if (!frameStamp || zone >= _zones.size())
+            return true;
+        //the first query of a frame computes, color and depth camera may cull in parallel. Afterwards _visible stays
+        //unchanged for the rest of the frame and is read without the lock
+        unsigned int frameNumber = frameStamp->getFrameNumber();
+        if (_computedFrame != frameNumber) {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            if (_computedFrame != frameNumber) {
+                update();
+                _computedFrame.exchange(frameNumber);
+            }
+        }
+        return _visible[zone];
+    }
+
+    void ZoneManager::update() {
+        ref_ptr<Camera> camera;
+        if (!_camera.lock(camera)) {
+            _visible.assign(_zones.size(), true);
+            _numCulled = 0;
+            return;
+        }
+        Vec3 eye = camera->getInverseViewMatrix().getTrans();
+        Matrix viewProjection = camera->getViewMatrix() * camera->getProjectionMatrix();
+
+        //near a portal both sides are camera zones, otherwise the other side pops in while passing it
+        std::set<unsigned int> cameraZones;
+        for (unsigned int i = 0; i < _zones.size(); ++i) {
+            if (_zones[i].box.contains(eye))
+                cameraZones.insert(i);
+        }
+        for (auto portal = _portals.begin(); portal != _portals.end(); ++portal) {
+            BoundingBox nearPortal(portal->opening._min - Vec3(_portalMargin, _portalMargin, _portalMargin),
+                             portal->opening._max + Vec3(_portalMargin, _portalMargin, _portalMargin));
+            if (nearPortal.contains(eye)) {
+                cameraZones.insert(portal->zoneA);
+                cameraZones.insert(portal->zoneB);
+            }
+        }
+        //outside of all zones (e.g. on the rails), nothing is known
+        if (cameraZones.empty()) {
+            _visible.assign(_zones.size(), true);
+            _numCulled = 0;
+            return;
+        }
+
+        _visible.assign(_zones.size(), false);
+        std::vector<bool> onPath(_zones.size(), false);
+        for (auto zone = cameraZones.begin(); zone != cameraZones.end(); ++zone) {
+            _visible[*zone] = true;
+            traversePortals(*zone, Vec4(-1, -1, 1, 1), viewProjection, onPath);
+        }
+        _numCulled = 0;
+        for (unsigned int i = 0; i < _visible.size(); ++i) {
+            if (!_visible[i])
+                _numCulled++;
+        }
+    }
+
+    void ZoneManager::traversePortals(unsigned int zone, const Vec4& rect, const Matrix& viewProjection, std::vector<bool>& onPath) {
+        onPath[zone] = true;
+        const std::vector<unsigned int>& portals = _zones[zone].portals;
+        for (auto index = portals.begin(); index != portals.end(); ++index) {
+            const Portal& portal = _portals[*index];
+            unsigned int other = portal.zoneA == zone ? portal.zoneB : portal.zoneA;
+            if (onPath[other])
+                continue;
+            //a portal reaching behind the camera is seen through the whole current rectangle
+            Vec4 portalRect(rect);
+            if (project(portal.opening, viewProjection, portalRect)) {
+                portalRect.set(maximum(rect.x(), portalRect.x()), maximum(rect.y(), portalRect.y()),
+                               minimum(rect.z(), portalRect.z()), minimum(rect.w(), portalRect.w()));
+                if (portalRect.x() >= portalRect.z() || portalRect.y() >= portalRect.w())
+                    continue;
+            }
+            _visible[other] = true;
+            traversePortals(other, portalRect, viewProjection, onPath);
+        }
+        onPath[zone] = false;
+    }
+
+    bool ZoneManager::project(const BoundingBox& box, const Matrix& viewProjection, Vec4& rect) const {
+        rect.set(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (unsigned int i = 0; i < 8; ++i) {
+            Vec4 clip = Vec4(box.corner(i), 1.0f) * viewProjection;
+            if (clip.w() <= 1e-3f)
+                return false;
+            float x = clip.x() / clip.w(), y = clip.y() / clip.w();
+            rect.set(minimum(rect.x(), x), minimum(rect.y(), y), maximum(rect.z(), x), maximum(rect.w(), y));
+        }
+        return true;
+    }
+
+    int ZoneManager::findZone(const BoundingBox& box) const {
+        for (unsigned int i = 0; i < _zones.size(); ++i) {
+            if (_zones[i].box.contains(box._min) && _zones[i].box.contains(box._max))
+                return i;
+        }
+        return -1;
+    }
+
+    unsigned int ZoneManager::getNumCulledZones() const {
+        return _numCulled;
+    }
+
+    unsigned int ZoneManager::getNumZones() const {
+        return _zones.size();
+    }
+
+    const std::string& ZoneManager::getZoneName(unsigned int zone) const {
+        return _zones[zone].name;
+    }
+
+}
@@ -1,7 +1,7 @@
 #pragma once
 #include <osg/NodeCallback>
 #include <osgViewer/Viewer>
-#include <osgText/Text>
+#include "../header/HUDTextLayer.h"
 
 namespace brtr {
     /**
@@ -48,10 +48,14 @@ namespace brtr {
          * @brief the interaction logic must be implemented be the children in this method
          */
         virtual void interact(osg::Node*, osg::NodeVisitor*)=0;
+        /**
+         * @brief shows the text of this callback in the HUDTextLayer, for use in setText()
+         */
+        void showText(const std::string& text);
         osg::ref_ptr<osg::Node> _attachTo;
         osg::ref_ptr<osg::Camera> _hudCam;
         bool _done;
-        osg::ref_ptr<osgText::Text> _text;
+        osg::ref_ptr<HUDTextLayer> _textLayer;
         
         
     private:
@@ -7,6 +7,7 @@
 #include <osg/MatrixTransform>
 #include <osg/Texture2D>
 #include <osg/ComputeBoundsVisitor>
+#include "../header/MeshBuilder.h"
 
 using namespace osg;
 
@@ -15,6 +16,7 @@ namespace brtr {
     *  @brief       Bench class, creates a bench Object
     *  @details	    creates a bench with a given length at a given position.
     * 		    The length has to be between 2 and 30    		   
+    * 		    All parts are merged by a MeshBuilder into one drawable per material (iron and wood)
     *  @author      Marcel Felix
     *  @version     1.0
     *  @date        2014
@@ -59,27 +61,34 @@ namespace brtr {
 	   **/
 	  ref_ptr<Material> createWoodMaterial();
 	  
-	  ref_ptr<Group> createLeg();
+	   /**
+	   * @brief creates a stateset with the material and the texture (unit 0)
+	   **/
+	  ref_ptr<StateSet> createState(Material* material, const std::string& textureFile);
+	  
+	  void createLeg(MeshBuilder& builder);
 	  
-	  ref_ptr<Group> createBar();
+	  void createBar(MeshBuilder& builder);
 	  
 	  
 	  /**
 	   * @brief creates the seat
 	   * 
+	   * @param builder the seat is added to this builder
 	   * @param width the width/length of the Seat
 	   **/
-	  ref_ptr<Group> createSeat(const double width);
+	  void createSeat(MeshBuilder& builder, const double width);
 	  
 	   /**
 	   * @brief creates the armrest
 	   * 
+	   * @param builder the armrest is added to this builder
 	   * @param radius the distance between bench and armrest
 	   * @param width width of the armrest
 	   * @param length length of the armrest
 	   * @param totalwidth width of the bar on the armrest
 	   **/
-	  ref_ptr<Group> createArmrest(double radius, double width, double length, double totalwidth);
+	  void createArmrest(MeshBuilder& builder, double radius, double width, double length, double totalwidth);
 	  
 	   /**
 	   * @brief creates the front/back for the armrest
@@ -106,6 +115,8 @@ namespace brtr {
 
 	  double length;
 	  ref_ptr<Group>  bench;
+	  ref_ptr<StateSet> ironState;
+	  ref_ptr<StateSet> woodState;
 	  /**
 	   * @brief creates a primitives set for the getRectangle function
 	   *
@@ -8,7 +8,12 @@ namespace brtr {
     *  @brief       CelSading Effect, every child of this node will get the effect
     *  @details      This effect implements a technique called 'Cel-Shading' to produce a cartoon-style (non photorealistic) rendering.<br/>
     *                Two passes are required:<br/>
-    *                the first one draws solid surfaces, the second one draws the outlines.
+    *                the first one draws solid surfaces, the second one draws the outlines.<br/>
+    *                Optionally a depth only pre-pass comes first, the solid surfaces are then shaded with
+    *                GL_EQUAL and without depth writes, so the expensive toon fragment shader runs once per pixel.
+    *                Both variants are separate techniques, setDepthPrePass() switches at runtime. Geometry in the
+    *                transparent bin would have to be excluded from the pre-pass, below the effect there is none.<br/>
+    *                The DebugMode techniques replace the cel programs by views of the shading cost, see DebugView.
     *  @author      Gleb Ostrowski
     *  @version     1.0
     *  @date        2014
@@ -17,13 +22,25 @@ namespace brtr {
     */
     class CelShading : public osgFX::Effect {
     public:
+        /**
+         * @brief debug views, the counts are written to the red channel of the color buffer (count/255)
+         */
+        enum DebugMode {
+            DEBUG_OFF = 0,
+            DEBUG_OVERDRAW,     ///< additive, fragments passing the depth test (both passes)
+            DEBUG_LIGHTS,       ///< lights contributing to the visible surface after attenuation
+            DEBUG_OUTLINES,     ///< additive, fragments of the outline pass
+            NUM_DEBUG_MODES
+        };
+
         /**
          * @brief  Constructor
          *
          * @param  secondPass if false, no outlines are being drawn
          * @param  vertSource one can set explicitly the vertex shader
+         * @param  depthPrePass initially use the depth pre-pass technique
          */
-        CelShading(bool secondPass = true, std::string vertSource = "celShader.vert");
+        CelShading(bool secondPass = true, std::string vertSource = "celShader.vert", bool depthPrePass = false);
         CelShading(const CelShading& copy, const osg::CopyOp& copyop = osg::CopyOp::SHALLOW_COPY);
 
         META_Effect(
@@ -39,16 +56,31 @@ namespace brtr {
              ,
             "Marco Jez; OGLSL port by Mike Weiblen, adaptions by Gleb Ostrowski ");
 
+        /**
+         * @brief  switches between the technique with and without depth pre-pass
+         */
+        void setDepthPrePass(bool depthPrePass);
+        bool getDepthPrePass() const;
+
+        /**
+         * @brief  replaces the cel programs by a debug view, DEBUG_OFF restores them
+         */
+        void setDebugMode(DebugMode mode);
+        DebugMode getDebugMode() const;
+
     protected:
         virtual ~CelShading() {}
 
         bool define_techniques();
+        void updateTechnique();
 
     private:
         osg::ref_ptr<osg::Material> _material;
         osg::ref_ptr<osg::LineWidth> _lineWidth;
         bool _secondPass;
         std::string _vertSource;
+        bool _depthPrePass;
+        DebugMode _debugMode;
     };
 }
 
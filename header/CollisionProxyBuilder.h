@@ -0,0 +1,77 @@
+#pragma once
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Builds simplified collision proxies for everything reachable with brtr::collisionMask
+    *  @details     For every collision Geode a proxy Geode is added next to it (same parent, so it follows
+    *               animated transforms like the train). Below an osg::LOD (see LODBuilder) the proxy gets the
+    *               range 0 to FLT_MAX, so it is traversed regardless of the level. The proxy holds one triangle mesh per drawable: <br/>
+    *               small drawables get their bounding box, large ones a vertex clustered mesh
+    *               (Rossignac/Borrel, one representative vertex per grid cell), so the triangle count depends on
+    *               the cell size instead of the visual detail. Cell size and box threshold are world units, converted
+    *               with the scale of the first path reaching the Geode. Drawables other than osg::Geometry get their
+    *               bounding box. Nodes registered with useBoxFor() get a single box for their whole subtree
+    *               (e.g. the benches). <br/>
+    *               Proxies carry only brtr::collisionProxyMask. Render Geodes lose this bit, groups on a collision path gain it.
+    *               Thus an intersection with the collisionProxyMask only sees proxies. Cameras rendering the scene
+    *               must exclude collisionProxyMask in their cull mask.
+    *  @pre         scene must be complete, the proxies are not updated if the graph changes afterwards
+    */
+    class CollisionProxyBuilder : public osg::NodeVisitor {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  cellSize       grid cell size (world units) for the vertex clustering, bigger means less triangles
+         * @param  boxThreshold   drawables with a bounding box diagonal (world units) below this value are replaced by their box
+         */
+        CollisionProxyBuilder(double cellSize = 1.0, double boxThreshold = 4.0);
+
+        /**
+         * @brief the whole subtree of node will be represented by one box in nodes coordinate frame
+         *
+         * @param  node must be a group, the proxy is added as its child
+         */
+        void useBoxFor(osg::Node* node);
+        /**
+         * @brief traverses root and attaches the proxies
+         *
+         * @param root root of the collision scene, the FPSCameraManipulator node
+         */
+        void build(osg::Node* root);
+
+        virtual void apply(osg::Node& node);
+        virtual void apply(osg::Geode& geode);
+
+        unsigned int getNumSourceTriangles() const;
+        unsigned int getNumProxyTriangles() const;
+    private:
+        /**
+         * @param scale of the local coordinates in the world
+         */
+        osg::ref_ptr<osg::Geometry> createProxy(osg::Drawable* drawable, const osg::Vec3d& scale);
+        /**
+         * @param cellSize in local coordinates
+         */
+        osg::ref_ptr<osg::Geometry> createClusteredMesh(osg::Geometry* geometry, const osg::Vec3d& cellSize);
+        osg::ref_ptr<osg::Geometry> createBox(const osg::BoundingBox& bb);
+        osg::ref_ptr<osg::Geode> createProxyGeode();
+        void traverseWithFlag(osg::Node& node, bool onCollisionPath);
+
+        double _cellSize;
+        double _boxThreshold;
+        bool _onCollisionPath;
+        unsigned int _numSourceTriangles;
+        unsigned int _numProxyTriangles;
+        std::set<osg::Node*> _boxNodes;
+        std::set<osg::Geode*> _visitedGeodes;
+        std::map<std::pair<osg::Drawable*, osg::Vec3d>, osg::ref_ptr<osg::Geometry>> _proxyCache;    ///< by drawable and scale
+        std::vector<std::pair<osg::ref_ptr<osg::Group>, osg::ref_ptr<osg::Node>>> _pendingProxies;
+    };
+}
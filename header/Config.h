@@ -0,0 +1,104 @@
+#pragma once
+#include <osg/ArgumentParser>
+#include <osgViewer/ViewerBase>
+#include <string>
+
+namespace brtr {
+    /**
+    *  @brief       Startup configuration, read from a config file and the command line
+    *  @details     Config file: one "key = value" per line, # starts a comment. The keys are the long
+    *               command line options without the leading dashes, e.g. "resolution = 1280x720". <br/>
+    *               Command line options override the config file, "--config file" selects the file
+    *               (default: ../braintrain.cfg, silently ignored if missing). <br/>
+    *               If no resolution is configured, main() falls back to the interactive menu.
+    *               \par <b> Options: </b>
+    *               <pre>
+    *               --config file                   config file to read
+    *               --resolution WxH|screen         render resolution, "screen" uses the screen resolution
+    *               --screen n                      screen to use
+    *               --windowed                      window instead of fullscreen
+    *               --change-desktop-mode           set the desktop to the render resolution (and back on exit)
+    *               --vsync on|off                  sync to vertical blank
+    *               --msaa n                        multisamples for the first pass
+    *               --threading model               SingleThreaded, CullDrawThreadPerContext, DrawThreadPerContext,
+    *                                               CullThreadPerCameraDrawThreadPerContext
+    *               --post-program name             fog, sepia or waves
+    *               --outlines on|off               cel shading outline pass
+    *               --wait on|off                   wait for enter before rendering
+    *                                               (default: only, if the menu was shown)
+    *               --no-wait                       same as --wait off
+    *               --release-cpu-data              see ReleaseCPUDataVisitor
+    *               --audit-data-variance           see DataVarianceAuditor
+    *               --dynamic-resolution ms         see DynamicResolutionHandler, 0 = off
+    *               --dynamic-resolution-textures   see DynamicResolutionHandler
+    *               --compress-vertices             see VertexCompressionVisitor
+    *               --cook-textures                 write the compressed textures, see TextureCookVisitor
+    *               --occlusion-culling on|off      see OcclusionCuller (default: off)
+    *               --depth-prepass on|off          depth only pre-pass of the cel shading, P toggles it at runtime
+    *               --gl-core on|off                GL 3.3 core profile shaders, see CoreProfileVisitor
+    *               --static-batching off|on|gpu    see StaticBatchBuilder, gpu culls with a compute shader (GL 4.3)
+    *               --precompile on|off             compile the GL objects before the render loop, see ScenePrecompiler
+    *                                               (default: off)
+    *               --async-rays on|off             collision and picking rays one frame ahead, see RayQueryService
+    *                                               (default: off)
+    *               </pre>
+    */
+    struct Config {
+        unsigned int width;                 ///< render width, 0 = not configured
+        unsigned int height;                ///< render height, 0 = not configured
+        bool useScreenResolution;           ///< query width and height from the screen
+        int screen;                         ///< screen number
+        bool windowed;                      ///< window instead of fullscreen
+        bool changeDesktopMode;             ///< set the desktop resolution to width x height
+        bool vsync;                         ///< sync to vertical blank
+        unsigned int samples;               ///< MSAA samples of the first pass, 0 = off
+        osgViewer::ViewerBase::ThreadingModel threadingModel;
+        unsigned int postProgram;           ///< index of the initial postprocess program
+        bool outlines;                      ///< cel shading second pass
+        bool waitForEnter;                  ///< wait for enter before the render loop
+        bool releaseCPUData;                ///< see ReleaseCPUDataVisitor
+        bool auditDataVariance;             ///< see DataVarianceAuditor
+        double resolutionBudget;            ///< see DynamicResolutionHandler, 0 = off
+        bool resizeRTTTextures;             ///< see DynamicResolutionHandler
+        bool compressVertices;              ///< see VertexCompressionVisitor
+        bool cookTextures;                  ///< see TextureCookVisitor
+        bool occlusionCulling;              ///< see OcclusionCuller
+        bool depthPrePass;                  ///< see CelShading::setDepthPrePass()
+        bool glCore;                        ///< see CoreProfileVisitor
+        bool staticBatching;                ///< see StaticBatchBuilder
+        bool gpuCulling;                    ///< see StaticBatchDrawElements::setGPUCulling()
+        bool precompile;                    ///< see ScenePrecompiler and ProgramBinaryCache
+        bool asyncRays;                     ///< see RayQueryService
+
+        Config();
+        /**
+         * @brief reads the config file and afterwards the command line
+         *
+         * @param  arguments the command line, read options are removed
+         * @return false, if an option had an invalid value or is unknown (already reported)
+         */
+        bool read(osg::ArgumentParser& arguments);
+        /**
+         * @brief reads a config file
+         *
+         * @param  fileName the file
+         * @return false, if the file could not be opened or contains invalid values (already reported)
+         */
+        bool readFile(const std::string& fileName);
+        /**
+         * @brief true, if width/height are known and the menu can be skipped
+         */
+        bool hasResolution() const;
+    private:
+        /**
+         * @brief sets a single option
+         *
+         * @param  key    option name without dashes
+         * @param  value  option value, empty for flags
+         * @return false, if key or value are invalid
+         */
+        bool set(const std::string& key, const std::string& value);
+
+        bool _waitSet;
+    };
+}
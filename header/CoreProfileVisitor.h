@@ -0,0 +1,82 @@
+#pragma once
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/LightSource>
+#include <osg/Material>
+#include <osg/Program>
+#include <osg/GraphicsContext>
+#include <osg/Camera>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Prepares the scene for the core profile shaders (Shader/core, see brtr::setCoreShaders)
+    *  @details     The core shaders do not know gl_LightSource and gl_FrontMaterial. The visitor collects the
+    *               osg::LightSources (world space, by light number) into the uniform block "LightBlock" and replaces every
+    *               osg::Material by a range of the uniform block "MaterialBlock" (front values, same override value).
+    *               The buffers are attached by build(), the root also gets the default material. Every camera gets the
+    *               uniform "lightViewMatrix", set to its view while it is culled, the shaders move the lights to view
+    *               space with it. <br/>
+    *               All geometry is switched from display lists to vertex buffer objects. Vertex array objects are not
+    *               supported by OpenSceneGraph 3.0, the VBO path is used instead. <br/>
+    *               The realize operation switches the whole context to the osg_ uniforms and vertex attributes. Cameras
+    *               without core programs (the text HUD with osgText and the crosshair) are switched back by
+    *               useFixedFunction(), so requestContext() asks for a 3.3 compatibility profile. <br/>
+    *               Lights and materials are uploaded once, later changes of the osg::Light/osg::Material are not seen.
+    *               Apply it after all visitors, which change or read materials (ModifyMaterialVisitor).
+    */
+    class CoreProfileVisitor : public osg::NodeVisitor {
+    public:
+        static const unsigned int lightBlockBinding = 0;
+        static const unsigned int materialBlockBinding = 1;
+        static const unsigned int numLights = 6;        ///< NUM_LIGHTS of the core shaders
+
+        CoreProfileVisitor();
+        virtual void apply(osg::Node& node);
+        virtual void apply(osg::Camera& camera);
+        virtual void apply(osg::Geode& geode);
+        virtual void apply(osg::LightSource& lightSource);
+
+        /**
+         * @brief uploads the collected lights and materials and attaches the uniform buffers
+         *
+         * @param  root stateset of the scene root, gets the lights and the default material
+         */
+        void build(osg::StateSet& root);
+
+        /**
+         * @brief binds the uniform blocks of the core shaders
+         */
+        static void bindUniformBlocks(osg::Program& program);
+        /**
+         * @brief requests a GL 3.3 compatibility context for all windows created afterwards
+         *
+         * The scene uses the core shaders only, but the cameras of useFixedFunction() need the fixed function state.
+         * Only, if OpenSceneGraph is built for GL3, otherwise the default context is used.
+         */
+        static void requestContext();
+        /**
+         * @brief realize operation switching the osg::State to the osg_ uniforms and vertex attributes
+         */
+        static osg::GraphicsOperation* createRealizeOperation();
+        /**
+         * @brief the own subgraph of the camera is drawn with the built-in uniforms and arrays of the fixed function pipeline
+         *
+         * Sets the pre and post draw callback, nested cameras are not affected.
+         */
+        static void useFixedFunction(osg::Camera& camera);
+
+        unsigned int getNumMaterials() const;
+        unsigned int getNumLights() const;
+    private:
+        void collectMaterial(osg::StateSet* stateSet);
+
+        std::map<osg::Material*, unsigned int> _materialIndices;
+        std::vector<osg::ref_ptr<osg::Material>> _materials;
+        std::vector<osg::ref_ptr<osg::StateSet>> _materialStateSets;
+        std::vector<osg::Vec4> _lightData;
+        std::set<int> _lightNums;       ///< collected light numbers, a light may be reached by several paths
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <osgGA/GUIEventHandler>
+#include <osg/StateSet>
+#include <osg/Drawable>
+#include <map>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Debug EventHandler, which flags StateSets and Drawables mutated at runtime without being DYNAMIC
+    *  @details     With DrawThreadPerContext (and the other multithreaded models) the draw thread of the last frame
+    *               still reads the StateSets and Drawables, while the event and update traversals of the next frame
+    *               run. Everything changed there must be marked osg::Object::DYNAMIC, so the viewer waits for it. <br/>
+    *               Every frame the auditor compares the scene against snapshots taken on first sight: <br/>
+    *               StateSets: modes, contents of the attributes and texture attributes (compared with cloned
+    *               attributes, so in place changes like Material::setDiffuse() are found) and uniform modified counts <br/>
+    *               Drawables: modified counts of arrays and primitive sets, bounding box (e.g. changed text) <br/>
+    *               Every mutated, non-DYNAMIC object is reported once with its node path.
+    *  @pre         the scene data of the view must be set
+    */
+    class DataVarianceAuditor : public osgGA::GUIEventHandler {
+    public:
+        DataVarianceAuditor();
+        virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa);
+        /**
+         * @brief number of flagged objects so far
+         */
+        unsigned int getNumViolations() const;
+        /**
+         * @brief checks the StateSet against its snapshot, takes the snapshot on first sight
+         *
+         * @param  stateSet  the StateSet to check
+         * @param  path      description of the owner, used for the report
+         */
+        void checkStateSet(osg::StateSet* stateSet, const std::string& path);
+        /**
+         * @brief checks the Drawable against its snapshot, takes the snapshot on first sight
+         *
+         * @param  drawable  the Drawable to check
+         * @param  path      description of the owner, used for the report
+         */
+        void checkDrawable(osg::Drawable* drawable, const std::string& path);
+    protected:
+        ~DataVarianceAuditor() {}
+    private:
+        struct StateSetSnapshot {
+            osg::ref_ptr<osg::StateSet> copy;       ///< with cloned attributes
+            std::vector<unsigned int> uniformCounts;
+            bool flagged;
+        };
+        struct DrawableSnapshot {
+            std::vector<unsigned int> modifiedCounts;
+            osg::BoundingBox bound;
+            bool flagged;
+        };
+        std::vector<unsigned int> getUniformCounts(const osg::StateSet* stateSet) const;
+        std::vector<unsigned int> getModifiedCounts(const osg::Drawable* drawable) const;
+        void report(const char* type, const osg::Object* object, const std::string& path);
+
+        std::map<osg::ref_ptr<osg::StateSet>, StateSetSnapshot> _stateSets;
+        std::map<osg::ref_ptr<osg::Drawable>, DrawableSnapshot> _drawables;
+        unsigned int _numViolations;
+    };
+}
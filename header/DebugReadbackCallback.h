@@ -0,0 +1,42 @@
+#pragma once
+#include <osg/Camera>
+#include <osg/Texture2D>
+#include <osg/observer_ptr>
+#include <OpenThreads/Atomic>
+#include "../header/CelShading.h"
+
+namespace brtr {
+    /**
+    *  @brief       Reads the color texture of the first pass back and prints a summary of the active debug view
+    *  @details     The debug views of CelShading write counts to the red channel (count/255). Every interval frames
+    *               the texture is read with glGetTexImage (a full pipeline stall, only while a debug view is active)
+    *               and the counts of the rendered part (viewport of the camera) are summed up. <br/>
+    *               With MSAA the resolved counts are averaged over the samples, the summary is approximate then.
+    *  @pre         needs to be attached as final draw callback to the camera rendering to the texture
+    */
+    class DebugReadbackCallback : public osg::Camera::DrawCallback {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  texture  the color texture of the camera
+         * @param  camera   the camera, its viewport is the rendered part of the texture
+         * @param  interval frames between two readbacks
+         */
+        DebugReadbackCallback(osg::Texture2D* texture, osg::Camera* camera, unsigned int interval = 60);
+        virtual void operator()(osg::RenderInfo& renderInfo) const;
+
+        /**
+         * @brief sets the debug view, which is summarized, DEBUG_OFF stops the readback
+         */
+        void setMode(CelShading::DebugMode mode);
+    private:
+        void report(CelShading::DebugMode mode, const unsigned int* histogram, unsigned int numPixels) const;
+
+        osg::ref_ptr<osg::Texture2D> _texture;
+        osg::observer_ptr<osg::Camera> _camera;
+        unsigned int _interval;
+        OpenThreads::Atomic _mode;
+        mutable OpenThreads::Atomic _frame;        ///< reset by setMode() in the event traversal
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <osg/Referenced>
+#include <osg/Program>
+#include <osg/Uniform>
+#include "../header/UtilFunctions.h"
+#include "../header/CelShading.h"
+#include "../header/DebugReadbackCallback.h"
+
+namespace brtr {
+    /**
+    *  @brief       Switches the first pass between the cel shading and the debug views of CelShading::DebugMode
+    *  @details     All CelShading effects below pass_0_color get the debug mode, the postprocess program is replaced by
+    *               a heatmap of the counts (black = 0, blue = 1 up to red = typical maximum of the view) and a
+    *               DebugReadbackCallback prints a numeric summary every readbackInterval frames. <br/>
+    *               The fog range of the replaced program is kept, so the far plane (FogFarPlaneCallback) and therefore
+    *               the culled objects stay the same. Leaving the debug views restores the replaced program.
+    *  @pre         pipe must be created by createRenderingPipeline
+    */
+    class DebugView : public osg::Referenced {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  pipe                 the rendering pipeline
+         * @param  readbackInterval     frames between two summaries
+         */
+        DebugView(const RenderingPipeline& pipe, unsigned int readbackInterval = 60);
+
+        void setMode(CelShading::DebugMode mode);
+        CelShading::DebugMode getMode() const;
+        /**
+         * @brief switches to the next debug view, after the last one back to the cel shading
+         *
+         * @return the new mode
+         */
+        CelShading::DebugMode nextMode();
+    protected:
+        ~DebugView();
+    private:
+        osg::ref_ptr<osg::Camera> _colorCam;
+        osg::ref_ptr<osg::Camera> _postProcessCam;
+        osg::ref_ptr<osg::Program> _heatmapProgram;
+        osg::ref_ptr<osg::Uniform> _maxCount;
+        osg::ref_ptr<osg::Program> _replacedProgram;
+        osg::StateAttribute::OverrideValue _replacedValue;
+        osg::ref_ptr<DebugReadbackCallback> _readback;
+        CelShading::DebugMode _mode;
+    };
+}
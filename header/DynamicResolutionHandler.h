@@ -0,0 +1,52 @@
+#pragma once
+#include <osgGA/GUIEventHandler>
+#include "../header/UtilFunctions.h"
+
+namespace brtr {
+    /**
+    *  @brief       Scales the resolution of the first (cel shading) pass to meet a GPU frame time budget
+    *  @details     Reads the averaged "GPU draw time taken" stat of the view camera every frame.
+    *               Every adjustInterval frames the scale is lowered, if the time exceeds the budget, and raised again,
+    *               if there is enough headroom. <br/>
+    *               By default only the viewports of pass_0_color and pass_0_depth are shrunk. The postprocess programs
+    *               read the rendered part via the rttScale uniform and stretch it over the screen (bilinear upscale). <br/>
+    *               With resizeTextures the textures are reallocated with the scaled size, which also saves memory
+    *               bandwidth, but causes a short hitch on every change.
+    *  @pre         pipe must be created by createRenderingPipeline
+    */
+    class DynamicResolutionHandler : public osgGA::GUIEventHandler {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  pipe             the rendering pipeline, whose first pass is scaled
+         * @param  budgetMs         target GPU time per frame in milliseconds
+         * @param  resizeTextures   reallocate the textures instead of only shrinking the viewports
+         * @param  minScale         lower bound of the scale (per axis)
+         */
+        DynamicResolutionHandler(const RenderingPipeline& pipe, double budgetMs, bool resizeTextures = false, double minScale = 0.5);
+        virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa);
+
+        double getScale() const;
+        /**
+         * @brief sets the scale directly and applies it to the pipeline
+         *
+         * @param  val scale per axis, clamped to [minScale, 1]
+         */
+        DynamicResolutionHandler& setScale(double val);
+    protected:
+        ~DynamicResolutionHandler() {}
+    private:
+        void applyScale();
+
+        RenderingPipeline _pipe;
+        double _budget;
+        bool _resizeTextures;
+        double _minScale;
+        double _scale;
+        double _step;
+        unsigned int _adjustInterval;
+        unsigned int _lastAdjustFrame;
+        bool _statsEnabled;
+    };
+}
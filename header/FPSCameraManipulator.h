@@ -1,5 +1,6 @@
 #pragma once
 #include <osgGA/FirstPersonManipulator>
+#include "../header/RayQueryService.h"
 namespace brtr {
     /**
     *  @brief       A FPS style CameraManipulator with ground clamping and intersection 
@@ -47,6 +48,23 @@ namespace brtr {
         FPSCameraManipulator& setZHeight(double val);
         double getJumpHeight() const;
         FPSCameraManipulator& setJumpHeight(double val);
+        int getCollisionMask() const;
+        /**
+         * @brief sets the traversal mask for all collision and ground intersections
+         *
+         * @param  val brtr::collisionMask (default, render geometry) or brtr::collisionProxyMask (see CollisionProxyBuilder)
+         */
+        FPSCameraManipulator& setCollisionMask(int val);
+        RayQueryService* getRayQueryService() const;
+        /**
+         * @brief resolves the collision and ground intersections one frame ahead
+         *
+         * The rays of the next frame are predicted with the current movement, if the prediction misses
+         * the ray is intersected synchronously.
+         *
+         * @param  val service with the root of the manipulator and the collision mask, null for synchronous intersections
+         */
+        FPSCameraManipulator& setRayQueryService(RayQueryService* val);
 
     protected:
         ~FPSCameraManipulator();
@@ -146,6 +164,15 @@ namespace brtr {
          * @return true, if Position is valid, false otherwise 
          */
         bool groundIntersection(osg::Vec3d& newEye);
+        /**
+         * @brief submits the movement and ground rays of the next frame to the RayQueryService
+         *
+         * The keys and the frame time are assumed to stay the same.
+         *
+         * @param wantedMovement    the movement of this frame before the collision check
+         * @param movement          the movement of this frame, 0 if blocked
+         */
+        void prefetchRays(const osg::Vec3d& wantedMovement, const osg::Vec3d& movement);
 
         osg::ref_ptr<osg::PositionAttitudeTransform> _body;
         bool _flightMode;
@@ -170,6 +197,8 @@ namespace brtr {
         double _bodyLength;
         double _jumpHeight;
         double _savedzHeightCrouch;
+        int _collisionMask;
+        osg::ref_ptr<RayQueryService> _rayQueries;
         };
 }
 
@@ -0,0 +1,38 @@
+#pragma once
+#include <osg/NodeCallback>
+#include <osg/Camera>
+#include <osg/Uniform>
+#include <osg/observer_ptr>
+
+namespace brtr {
+    /**
+    *  @brief       Keeps the far plane at the fog end of the active postprocess program
+    *  @details     The fog range of a program is stored as user values "fogStart" and "fogEnd" (distance along the
+    *               view axis) on the osg::Program, see createRenderingPipeline. Every update the active program is read
+    *               from the stateset of the node, the fog uniforms are set and the far plane of the camera is moved to the
+    *               fog end (defaultFar for programs without fog). <br/>
+    *               Together with FAR_PLANE_CULLING on the pass cameras, everything completely in the fog is culled, the
+    *               cleared depth (1.0) is fogged by the postprocess program, i.e. drawn as fog colour.
+    *  @pre         needs to be attached as update callback to the postprocess camera
+    */
+    class FogFarPlaneCallback : public osg::NodeCallback {
+    public:
+        /**
+        * @brief Constructor
+        *
+        * @param  camera        the camera whose projection is changed
+        * @param  zFar          uniform of the far plane, read by the postprocess programs
+        * @param  fogStart      uniform of the fog start
+        * @param  fogEnd        uniform of the fog end
+        * @param  defaultFar    far plane for programs without fog
+        */
+        FogFarPlaneCallback(osg::Camera* camera, osg::Uniform* zFar, osg::Uniform* fogStart, osg::Uniform* fogEnd, float defaultFar);
+        virtual void operator()(osg::Node* node, osg::NodeVisitor* nv);
+    private:
+        osg::observer_ptr<osg::Camera> _camera;
+        osg::ref_ptr<osg::Uniform> _zFar;
+        osg::ref_ptr<osg::Uniform> _fogStart;
+        osg::ref_ptr<osg::Uniform> _fogEnd;
+        float _defaultFar;
+    };
+}
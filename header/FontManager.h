@@ -0,0 +1,45 @@
+#pragma once
+#include <osgText/Font>
+#include <OpenThreads/Mutex>
+#include <map>
+#include <string>
+
+namespace brtr {
+    /**
+    *  @brief       Loads every font only once and shares it between all osgText::Text objects
+    *  @details     osgText keeps the rasterized glyphs in textures owned by the font, so sharing the font object
+    *               also shares one glyph atlas. The atlas is made big enough for all printable ASCII characters
+    *               at glyphResolution, which are rasterized right after loading. The HUD texts therefore use a single
+    *               texture and neither file I/O nor rasterization happen, when interaction callbacks are created
+    *               or their texts change.
+    */
+    class FontManager {
+    public:
+        static const unsigned int glyphResolution = 32;    ///< font resolution of all texts, see osgText::Text::setFontResolution
+        static const unsigned int atlasSize = 512;         ///< width and height of the glyph texture
+
+        static FontManager& instance();
+        /**
+         * @brief returns the font, loads and prepares it on first use
+         *
+         * @param  fileName the font file
+         * @return the shared font or nullptr, if it could not be read
+         */
+        osgText::Font* getFont(const std::string& fileName = "../fonts/dirtydoz.ttf");
+        /**
+         * @brief rasterizes additional characters into the atlas of a font
+         *
+         * @param  fileName     the font file
+         * @param  characters   the characters to rasterize
+         */
+        void preloadGlyphs(const std::string& fileName, const std::string& characters);
+    private:
+        FontManager() {}
+        FontManager(const FontManager&);
+        FontManager& operator=(const FontManager&);
+        void preloadGlyphs(osgText::Font* font, const std::string& characters);
+
+        OpenThreads::Mutex _mutex;
+        std::map<std::string, osg::ref_ptr<osgText::Font>> _fonts;
+    };
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <osg/Geode>
+#include <osg/Camera>
+#include <osgText/Text>
+#include <string>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       One text drawable for all messages shown on a HUD camera
+    *  @details     Every owner (e.g. an interaction callback) sets or clears its own message, the layer joins
+    *               all current messages into its single osgText::Text. The glyph geometry is only rebuilt,
+    *               if the joined text actually changes. While no message is shown, the node mask is 0,
+    *               so the layer is neither culled nor drawn. <br/>
+    *               Use getOrCreate(), so all owners of a HUD camera share the same layer.
+    */
+    class HUDTextLayer : public osg::Geode {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  width   screenWidth
+         * @param  height  screenHeight
+         */
+        HUDTextLayer(int width, int height);
+        /**
+         * @brief returns the layer of the HUD camera, creates and adds it on first use
+         *
+         * @param  hudCam  the HUD camera
+         * @param  width   screenWidth
+         * @param  height  screenHeight
+         */
+        static HUDTextLayer* getOrCreate(osg::Camera* hudCam, int width, int height);
+
+        /**
+         * @brief shows (or replaces) the message of owner
+         */
+        void setMessage(const void* owner, const std::string& message);
+        /**
+         * @brief removes the message of owner, if any
+         */
+        void clearMessage(const void* owner);
+        bool isEmpty() const;
+    protected:
+        ~HUDTextLayer() {}
+    private:
+        void update();
+
+        osg::ref_ptr<osgText::Text> _text;
+        std::vector<std::pair<const void*, std::string>> _messages;
+        std::string _shown;
+    };
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/Timer>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/Atomic>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <exception>
+
+namespace brtr {
+    class JobSystem;
+
+    /**
+    *  @brief       A piece of work for the JobSystem, optionally waiting for other jobs
+    *  @details     Dependencies must be added before the job is submitted. The job is queued, as soon as it was
+    *               submitted and all its dependencies are done. <br/>
+    *               An exception thrown by the work finishes the job, JobSystem::wait() rethrows it. Dependents of a
+    *               failed job are finished without running, with the same exception.
+    */
+    class Job : public osg::Referenced {
+    public:
+        Job(const std::function<void()>& work);
+        /**
+         * @brief the job is not started before dependency is done
+         */
+        void dependsOn(Job* dependency);
+        bool isDone() const;
+    private:
+        friend class JobSystem;
+        std::function<void()> _work;
+        std::exception_ptr _exception;                  ///< thrown by the work or by a dependency
+        OpenThreads::Atomic _pending;                   ///< unfinished dependencies + 1 until submitted
+        mutable OpenThreads::Mutex _mutex;
+        bool _done;
+        std::vector<osg::ref_ptr<Job>> _dependents;
+    };
+
+    /**
+    *  @brief       Work stealing job system shared by all subsystems
+    *  @details     One worker thread per hardware thread, except the main thread. Every worker owns a deque: it pushes and
+    *               pops its own jobs at the back (the most recent data is still in the cache), idle workers steal from
+    *               the front of the others. Jobs submitted from other threads are distributed round robin. <br/>
+    *               wait() runs queued jobs on the calling thread while waiting, so the main thread is
+    *               never idle and jobs may wait for other jobs. <br/>
+    *               Per worker the number of executed and stolen jobs and the busy time are measured, the calling threads
+    *               share one additional entry.
+    */
+    class JobSystem {
+    public:
+        struct WorkerStats {
+            unsigned int numJobs;
+            unsigned int numStolen;
+            double busyTime;                            ///< seconds
+            double utilization;                         ///< busy time relative to the time since the last resetStats()
+        };
+
+        static JobSystem& instance();
+
+        /**
+         * @brief submits a job, its dependencies must already be set
+         */
+        osg::ref_ptr<Job> submit(Job* job);
+        osg::ref_ptr<Job> submit(const std::function<void()>& work);
+        /**
+         * @brief returns after the job is done, runs other jobs meanwhile
+         *
+         * Rethrows the exception of the job, if its work or one of its dependencies failed.
+         */
+        void wait(Job* job);
+
+        unsigned int getNumWorkers() const;
+        /**
+         * @brief statistics of a worker, getNumWorkers() returns those of the calling threads
+         */
+        WorkerStats getStats(unsigned int worker) const;
+        void resetStats();
+    private:
+        class Worker;
+        struct Slot {
+            OpenThreads::Mutex mutex;
+            std::deque<osg::ref_ptr<Job>> jobs;
+            WorkerStats stats;
+        };
+
+        JobSystem();
+        ~JobSystem();
+        JobSystem(const JobSystem&);
+        JobSystem& operator=(const JobSystem&);
+
+        void enqueue(Job* job);
+        /**
+         * @brief runs one job, the own ones first, otherwise a stolen one
+         *
+         * @param  worker the index of the slot of the calling thread
+         * @return false, if there was nothing to do
+         */
+        bool runOne(unsigned int worker);
+        void finish(Job* job);
+        unsigned int getCurrentWorker() const;
+
+        std::vector<Slot*> _slots;                      ///< one per worker, the last one for the calling threads
+        std::vector<Worker*> _workers;
+        OpenThreads::Atomic _numQueued;
+        OpenThreads::Atomic _nextSlot;
+        OpenThreads::Mutex _wakeMutex;
+        OpenThreads::Condition _wake;
+        volatile bool _quit;
+        osg::Timer_t _statsStart;
+    };
+}
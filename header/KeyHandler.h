@@ -5,6 +5,9 @@
 #include <osg/Program>
 #include "../header/FPSCameraManipulator.h"
 #include "../header/BaseInteractionCallback.h"
+#include "../header/CelShading.h"
+#include "../header/DebugView.h"
+#include "../header/RayQueryService.h"
 namespace brtr {
     /**
     *  @brief       Key Handler Class, handles all of our KeyFunctions, which do not belong
@@ -14,6 +17,8 @@ namespace brtr {
     *                     C       = Toggle WireFrame Mode On/Off
     *                   LClick    = Interact
     *                   Shift+1   = Toggle programs
+    *                   Shift+2   = Cycle debug views (overdraw, lights per pixel, outline coverage, off)
+    *                     P       = Toggle depth pre-pass of the cel shading On/Off
     *               </pre>
     *  @author     Gleb Ostrowski
     *  @version     1.0
@@ -29,9 +34,18 @@ namespace brtr {
          * @param  rootnode rootnode of the scene, polygonmode will be activatd on all children 
          * @param  postProcessCam   node containing the postprocess programs
          * @param  programs         vector with postprocess programs
+         * @param  toonEffect       CelShading effect, whose depth pre-pass is toggled (optional)
+         * @param  debugView        debug views of the first pass (optional)
          */
-        KeyHandler(osg::Node*, osg::Camera* postProcessCam, std::vector<osg::ref_ptr<osg::Program>> programs);
+        KeyHandler(osg::Node*, osg::Camera* postProcessCam, std::vector<osg::ref_ptr<osg::Program>> programs, CelShading* toonEffect = nullptr,
+                   DebugView* debugView = nullptr);
         virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa);
+        /**
+         * @brief picks the interaction objects with the rays of a RayQueryService, the result is one frame late
+         *
+         * @param  val service with brtr::interactionMask, null for synchronous picking
+         */
+        KeyHandler& setRayQueryService(RayQueryService* val);
 
     protected:
         ~KeyHandler();
@@ -43,6 +57,10 @@ namespace brtr {
          * @param  aa GUIActionAdapter for getting the camera , to whom the LineIntersectionVisitor will be attached to
          */
         void mouseIntersection(osgGA::GUIActionAdapter& aa);
+        /**
+         * @brief Shows or hides the InteractionMessage of the picked drawable, depending on the distance
+         */
+        void pick(double distance, osg::Drawable* drawable);
         /**
          * @brief Shows the InteractionMessage on screen, if there is an InteractionObject beneath the mouse (e.a center of screen)
          *
@@ -55,8 +73,13 @@ namespace brtr {
         osg::ref_ptr<osg::PolygonMode> _wireFrameMode;
         osg::ref_ptr<osg::PolygonMode> _normaleMode;
         osg::ref_ptr<osg::Camera> _postProcessCam;
+        osg::ref_ptr<CelShading> _toonEffect;
+        osg::ref_ptr<DebugView> _debugView;
         std::vector<osg::ref_ptr<osg::Program>> _programs;
         osg::ref_ptr< const osgGA::GUIEventAdapter > _mouseEvent;
+        osg::ref_ptr<RayQueryService> _rayQueries;
+        unsigned int _pickTicket;
+        osg::Vec3d _pickEye; //eye position of the submitted ray
         bool _isWireFrame;
         unsigned int _curProg;
     };
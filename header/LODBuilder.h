@@ -0,0 +1,57 @@
+#pragma once
+#include <osg/Node>
+#include <osg/Geode>
+#include <vector>
+#include "../header/MeshSimplifier.h"
+
+namespace brtr {
+    /**
+    *  @brief       Replaces heavy Geodes of a model by an osg::LOD with simplified copies
+    *  @details     Every Geode with at least minTriangles triangles becomes the first child of an osg::LOD in
+    *               PIXEL_SIZE_ON_SCREEN mode. The coarser levels are deep copies simplified by the MeshSimplifier,
+    *               so the parts of a long model (e.g. the train) switch on their own. <br/>
+    *               The full detail level keeps the node mask of the Geode, the coarser levels lose
+    *               brtr::interactionAndCollisionMask: collision (and the CollisionProxyBuilder) and interaction
+    *               only see the full detail, no matter which level is rendered. <br/>
+    *               Usage: addLevel() from fine to coarse, then build() on the loaded model before it is added to the scene.
+    */
+    class LODBuilder {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  minTriangles Geodes with less triangles are kept as they are
+         */
+        LODBuilder(unsigned int minTriangles = 2000);
+
+        /**
+         * @brief adds a coarser level
+         *
+         * @param  ratio        triangle count relative to the full detail
+         * @param  pixelSize    the level is used, if the bounding sphere covers less than pixelSize pixels
+         */
+        LODBuilder& addLevel(float ratio, float pixelSize);
+
+        /**
+         * @brief inserts the LODs into a model
+         *
+         * @param  root the model
+         * @return the model, or a LOD if the root itself was a heavy Geode
+         */
+        osg::ref_ptr<osg::Node> build(osg::Node* root);
+
+        unsigned int getNumLODs() const;
+        const MeshSimplifier& getSimplifier() const;
+    private:
+        struct Level {
+            float ratio;
+            float pixelSize;
+        };
+        unsigned int countTriangles(osg::Geode& geode) const;
+
+        unsigned int _minTriangles;
+        std::vector<Level> _levels;
+        MeshSimplifier _simplifier;
+        unsigned int _numLODs;
+    };
+}
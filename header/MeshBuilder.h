@@ -0,0 +1,95 @@
+#pragma once
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/StateSet>
+#include <osg/Matrix>
+#include <osg/BoundingBox>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Collects transformed primitives into one indexed triangle list per StateSet (material)
+    *  @details     Procedural props used to be built from many small Geodes below many transforms, i.e. one draw call
+    *               per rectangle. The MeshBuilder bakes the current transform into the appended vertices (float arrays,
+    *               reserved up front) and build() creates one Geometry per StateSet with GL_TRIANGLES indices. <br/>
+    *               Usage: setStateSet() selects the batch, pushTransform()/popTransform() work like nested
+    *               MatrixTransforms, addRectangle(), addCuboid(), addGeometry() or addMesh() append geometry.
+    */
+    class MeshBuilder {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  reserveVertices  vertices reserved for every new batch
+         * @param  reserveIndices   indices reserved for every new batch
+         */
+        MeshBuilder(unsigned int reserveVertices = 1024, unsigned int reserveIndices = 4096);
+
+        /**
+         * @brief selects the batch for the following primitives, creates it if necessary
+         *
+         * @param  stateSet the state of the batch, nullptr for geometry without own state
+         */
+        MeshBuilder& setStateSet(osg::StateSet* stateSet);
+        /**
+         * @brief the following primitives are transformed by matrix first and then by the current transform
+         */
+        MeshBuilder& pushTransform(const osg::Matrix& matrix);
+        MeshBuilder& popTransform();
+        const osg::Matrix& getTransform() const;
+
+        /**
+         * @brief appends a rectangle in the x-y plane, same layout as createRectangleWithTexcoords
+         *
+         * @param  length       length in x direction
+         * @param  width        width in y direction
+         * @param  lsteps       subdivisions in x direction
+         * @param  wsteps       subdivisions in y direction
+         * @param  texcoords    create texture coordinates
+         */
+        MeshBuilder& addRectangle(double length, double width, int lsteps, int wsteps, bool texcoords = true);
+        /**
+         * @brief appends a cuboid, same layout as createCuboid
+         */
+        MeshBuilder& addCuboid(double length, double width, double height, double factor = 6);
+        /**
+         * @brief appends any Geometry with a Vec3Array vertex array, its primitives are converted to triangles
+         */
+        MeshBuilder& addGeometry(const osg::Geometry& geometry);
+        /**
+         * @brief appends all batches of another builder, keeping their StateSets
+         */
+        MeshBuilder& addMesh(const MeshBuilder& mesh);
+
+        /**
+         * @brief bounding box of all appended vertices (in builder coordinates)
+         */
+        const osg::BoundingBox& getBound() const;
+        /**
+         * @brief creates one Geometry per batch
+         *
+         * @return a Geode holding the Geometries
+         */
+        osg::ref_ptr<osg::Geode> build() const;
+    private:
+        struct Batch {
+            osg::ref_ptr<osg::StateSet> stateSet;
+            osg::ref_ptr<osg::Vec3Array> vertices;
+            osg::ref_ptr<osg::Vec3Array> normals;
+            osg::ref_ptr<osg::Vec2Array> texcoords;
+            osg::ref_ptr<osg::DrawElementsUInt> indices;
+        };
+        /**
+         * @brief appends already indexed triangles to the current batch, transforms them with the current transform
+         */
+        void append(const osg::Vec3Array& vertices, const osg::Vec3Array* normals, const osg::Vec2Array* texcoords,
+                    const std::vector<unsigned int>& indices);
+
+        unsigned int _reserveVertices;
+        unsigned int _reserveIndices;
+        std::vector<Batch> _batches;
+        unsigned int _current;
+        std::vector<osg::Matrix> _transforms;
+        osg::BoundingBox _bound;
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <osg/Geometry>
+
+namespace brtr {
+    /**
+    *  @brief       Quadric error mesh simplifier (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics")
+    *  @details     Works on the triangles of a Geometry with a Vec3Array vertex array. Vertices with equal positions are
+    *               welded for the topology, so split normals and texture seams do not stop the simplification. Edges are
+    *               collapsed into the cheaper endpoint (half edge collapse), therefore no new vertices are created and
+    *               all per vertex arrays stay valid. Open borders are kept by additional perpendicular planes, collapses
+    *               flipping a triangle are rejected. <br/>
+    *               The result is one GL_TRIANGLES DrawElementsUInt, unused vertices are left in the arrays
+    *               (the VertexCacheVisitor drops them). A KdTree of the geometry is removed.
+    */
+    class MeshSimplifier {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  boundaryWeight   weight of the planes keeping the open borders in place
+         */
+        MeshSimplifier(double boundaryWeight = 10.0);
+
+        /**
+         * @brief simplifies a single geometry
+         *
+         * @param  geometry the geometry, lines and points are not supported
+         * @param  ratio    wanted triangle count relative to the current one
+         * @return true, if the geometry was changed
+         */
+        bool simplify(osg::Geometry& geometry, float ratio);
+
+        unsigned int getNumTrianglesBefore() const;
+        unsigned int getNumTrianglesAfter() const;
+    private:
+        double _boundaryWeight;
+        unsigned int _trianglesBefore;
+        unsigned int _trianglesAfter;
+    };
+}
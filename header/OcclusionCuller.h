@@ -0,0 +1,74 @@
+#pragma once
+#include <osgGA/GUIEventHandler>
+#include <osg/OcclusionQueryNode>
+#include <osg/Camera>
+#include <OpenThreads/Mutex>
+#include <vector>
+#include <set>
+
+namespace brtr {
+    /**
+    *  @brief       Hardware occlusion query culling for heavy subgraphs behind the walls and pillars of the station
+    *  @details     wrap() inserts an osg::OcclusionQueryNode above a subgraph (in all its parents), wrapHeavyChildren()
+    *               does so for every child of a group with enough triangles and a bound smaller than the occluders,
+    *               i.e. the train, the benches and the bottle clusters, but not the station itself. <br/>
+    *               Temporal coherence: the queries of a frame are only read in a later frame and every query is reissued
+    *               only every queryFrameCount frames, until then the last result is used. Inside the bound of a subgraph
+    *               it is always drawn. <br/>
+    *               Counts: the subgraphs tested and culled during the last frame (over all cameras, i.e. color and depth
+    *               pass count separately, the passes of an effect within a camera once) are updated upon every FRAME
+    *               event. KEY_O toggles the queries and prints the counts.
+    */
+    class OcclusionCuller : public osgGA::GUIEventHandler {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  visibilityThreshold  minimum number of passed pixels for drawing
+         * @param  queryFrameCount      frames between two queries of the same subgraph
+         */
+        OcclusionCuller(unsigned int visibilityThreshold = 10, unsigned int queryFrameCount = 5);
+        virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa);
+
+        /**
+         * @brief inserts an OcclusionQueryNode between node and its parents
+         */
+        osg::OcclusionQueryNode* wrap(osg::Node* node);
+        /**
+         * @brief wraps the children of group with at least minTriangles triangles and a bounding radius below maxRadius
+         *
+         * @return number of wrapped children
+         */
+        unsigned int wrapHeavyChildren(osg::Group* group, unsigned int minTriangles, float maxRadius);
+
+        OcclusionCuller& setQueriesEnabled(bool val);
+        bool getQueriesEnabled() const;
+        unsigned int getNumWrapped() const;
+        /**
+         * @brief number of occlusion tests in the last frame
+         */
+        unsigned int getNumTested() const;
+        /**
+         * @brief number of subgraphs culled by occlusion in the last frame
+         */
+        unsigned int getNumCulled() const;
+
+        /**
+         * @brief called by the cull callbacks, each node counts once per camera and frame
+         */
+        void countTested(const osg::Node* node, const osg::Camera* camera);
+        void countPassed(const osg::Node* node, const osg::Camera* camera);
+    protected:
+        ~OcclusionCuller() {}
+    private:
+        unsigned int _visibilityThreshold;
+        unsigned int _queryFrameCount;
+        bool _enabled;
+        std::vector<osg::ref_ptr<osg::OcclusionQueryNode>> _nodes;
+        OpenThreads::Mutex _mutex;
+        std::set<std::pair<const osg::Node*, const osg::Camera*>> _tested;     ///< in the current frame
+        std::set<std::pair<const osg::Node*, const osg::Camera*>> _passed;
+        unsigned int _lastTested;
+        unsigned int _lastCulled;
+    };
+}
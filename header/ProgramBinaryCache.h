@@ -0,0 +1,64 @@
+#pragma once
+#include <osg/Referenced>
+#include <osg/Program>
+#include <osg/GraphicsContext>
+#include <osg/OperationThread>
+#include <map>
+#include <set>
+#include <string>
+
+namespace brtr {
+    /**
+    *  @brief       Caches the linked binaries of the shader programs on disk (GL_ARB_get_program_binary)
+    *  @details     Programs are identified by a FNV-1a hash of their shader sources and attribute bindings, so the equal programs of all
+    *               CelShading instances share one file <path>/<key>.bin. The realize operation loads the binaries as
+    *               osg::ProgramBinary, the programs are then created by glProgramBinary instead of compiling and linking.
+    *               The save operation retrieves the binaries of the linked programs which were not loaded. Loaded binaries
+    *               that did not link are removed there, the program is linked from its sources again. <br/>
+    *               The files are only valid for the driver that wrote them: vendor, renderer and version are stored in
+    *               <path>/signature.txt, a changed driver ignores and overwrites the cache.
+    *  @pre         add() the programs before the viewer is realized, run the save operation after they were linked
+    */
+    class ProgramBinaryCache : public osg::Referenced {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  path directory of the cached binaries
+         */
+        ProgramBinaryCache(const std::string& path = "../BlenderFiles/cooked/programs");
+
+        /**
+         * @brief registers a program, which should be loaded from and saved to the cache
+         */
+        void add(osg::Program* program);
+
+        /**
+         * @brief realize operation loading the binaries
+         *
+         * @param  next operation run before, e.g. CoreProfileVisitor::createRealizeOperation(), may be nullptr
+         */
+        osg::GraphicsOperation* createRealizeOperation(osg::Operation* next = nullptr);
+        /**
+         * @brief graphics operation saving the binaries of the linked programs, add it to the context
+         */
+        osg::GraphicsOperation* createSaveOperation();
+
+        unsigned int getNumPrograms() const;
+        unsigned int getNumLoaded() const;
+        unsigned int getNumSaved() const;
+    private:
+        friend class ProgramBinaryLoadOperation;
+        friend class ProgramBinarySaveOperation;
+        void load(osg::GraphicsContext& gc);
+        void save(osg::GraphicsContext& gc);
+        std::string getKey(const osg::Program& program) const;
+        std::string getSignature() const;
+
+        std::string _path;
+        std::map<osg::ref_ptr<osg::Program>, std::string> _programs;   ///< program -> key
+        std::set<std::string> _loadedKeys;
+        unsigned int _numLoaded;
+        unsigned int _numSaved;
+    };
+}
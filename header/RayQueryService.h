@@ -0,0 +1,141 @@
+#pragma once
+#include <osgGA/GUIEventHandler>
+#include <osg/Group>
+#include <osg/MatrixTransform>
+#include <osg/Drawable>
+#include <vector>
+#include <map>
+#include "../header/JobSystem.h"
+
+namespace brtr {
+    /**
+    *  @brief       Resolves batches of intersection rays (movement, ground, pick) on the JobSystem one frame ahead
+    *  @details     The service intersects a snapshot of the subgraph below its root instead of the scene graph: every Geode
+    *               reachable by the mask gets a MatrixTransform with its world matrix and the path mask, the drawables
+    *               are shallow copies without statesets and callbacks (the arrays and KdTrees are shared, missing KdTrees
+    *               are built for the copies). Subgraphs of ABSOLUTE_RF cameras (the HUDs) are left out. <br/>
+    *               LOD ranges are ignored, every level reachable by the mask is intersected (the LODBuilder strips the
+    *               masks of the coarse levels, the collision proxies below a LOD are in the range 0 to FLT_MAX).
+    *               Children switched off are collected as well, but stay masked out until their Switch turns them on.
+    *               A synchronous IntersectionVisitor on the scene graph follows the active LOD range instead, so both
+    *               only agree, if the intersected geometry does not depend on the range. <br/>
+    *               Only Geodes below a Switch or a moving Transform (DYNAMIC or with an update callback) are refreshed,
+    *               once per FRAME event, while no batch is running. Between two refreshes the snapshot is read only,
+    *               so the workers and the synchronous fallback may intersect it at the same time. Other changes of the
+    *               scene need rebuild(). <br/>
+    *               Frame N: submit() starts a job per batch. Frame N+1: the FRAME event waits for these jobs and publishes
+    *               their hits, getResult() and findResult() return them until the next FRAME event. If the result of a
+    *               ray is needed in the same frame (the prediction of the last frame missed), intersect() resolves it
+    *               synchronously. <br/>
+    *               Usage: add the service as event handler before the handlers and the manipulator using it.
+    */
+    class RayQueryService : public osgGA::GUIEventHandler {
+    public:
+        struct Ray {
+            Ray() : mask(0xffffffff) {}
+            Ray(const osg::Vec3d& s, const osg::Vec3d& e, unsigned int m) : start(s), end(e), mask(m) {}
+            osg::Vec3d start;
+            osg::Vec3d end;
+            unsigned int mask;                  ///< traversal mask, like IntersectionVisitor::setTraversalMask()
+        };
+
+        struct Hit {
+            Hit() : valid(false), distance(0.0) {}
+            bool valid;                         ///< false, if the ray did not hit anything
+            double distance;                    ///< from the start of the ray to point
+            osg::Vec3d point;                   ///< world coordinates
+            osg::Vec3d normal;                  ///< world coordinates
+            osg::ref_ptr<osg::Drawable> drawable;   ///< the drawable of the scene, not the copy
+        };
+
+        /**
+         * @brief Constructor, builds the snapshot
+         *
+         * @param  root the subgraph to intersect
+         * @param  mask Geodes not reachable by any bit of mask are left out
+         */
+        RayQueryService(osg::Node* root, unsigned int mask);
+        virtual bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa);
+
+        /**
+         * @brief submits a batch of rays, resolved by one job
+         *
+         * @return the ticket of the first ray, the following rays have the following tickets
+         */
+        unsigned int submit(const std::vector<Ray>& rays);
+        unsigned int submit(const Ray& ray);
+
+        /**
+         * @brief the result of a ray submitted in the last frame
+         *
+         * @return false, if the ticket was not submitted in the last frame
+         */
+        bool getResult(unsigned int ticket, Hit& hit) const;
+
+        /**
+         * @brief the result of a ray submitted in the last frame along the same line
+         *
+         * The start points and the directions (normalized) may differ by tolerance. A hit is only used, if it lies
+         * on the wanted ray (at most tolerance away from it), a miss only for the same start point and direction
+         * and if the submitted ray was at least as long as the wanted one.
+         *
+         * @return false, if there is no such result
+         */
+        bool findResult(const Ray& ray, double tolerance, Hit& hit) const;
+
+        /**
+         * @brief synchronous fallback, intersects the snapshot on the calling thread
+         *
+         * @return hit.valid
+         */
+        bool intersect(const Ray& ray, Hit& hit) const;
+
+        /**
+         * @brief collects the snapshot again, waits for the running batches
+         */
+        void rebuild();
+
+        unsigned int getNumEntries() const;
+        unsigned int getNumDynamicEntries() const;
+        /**
+         * @brief number of results of the last frame used by getResult() and findResult()
+         */
+        unsigned int getNumAsyncResults() const;
+        /**
+         * @brief number of rays resolved by intersect()
+         */
+        unsigned int getNumSyncResults() const;
+    protected:
+        ~RayQueryService();
+    private:
+        struct Batch : public osg::Referenced {
+            unsigned int firstTicket;
+            std::vector<Ray> rays;
+            std::vector<Hit> hits;
+            osg::ref_ptr<Job> job;
+        };
+        struct DynamicEntry {
+            osg::NodePath path;
+            osg::ref_ptr<osg::MatrixTransform> transform;
+        };
+
+        void waitForBatches();
+        /**
+         * @brief updates the matrices and masks of the dynamic entries
+         */
+        void refresh();
+        void resolve(const Ray& ray, Hit& hit) const;
+
+        osg::ref_ptr<osg::Node> _root;
+        unsigned int _mask;
+        osg::ref_ptr<osg::Group> _snapshot;
+        std::vector<DynamicEntry> _dynamicEntries;
+        std::map<const osg::Drawable*, osg::ref_ptr<osg::Drawable>> _originals;  ///< copy -> drawable of the scene
+        unsigned int _numEntries;
+        std::vector<osg::ref_ptr<Batch>> _pending;      ///< submitted in this frame
+        std::vector<osg::ref_ptr<Batch>> _published;    ///< submitted in the last frame, resolved
+        unsigned int _nextTicket;
+        mutable unsigned int _numAsync;
+        mutable unsigned int _numSync;
+    };
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Texture>
+#include <set>
+
+namespace brtr {
+    /**
+    *  @brief       Visitor for releasing the system memory copies of already uploaded geometry and images
+    *  @details     Must be applied after the scene was realized and drawn at least once (post-realize),
+    *               so the display lists and texture objects for the given context already exist. <br/>
+    *               Textures: setUnRefImageDataAfterApply is set on every texture. Textures which already
+    *               own a texture object drop their images right away, the others drop them upon their first apply. <br/>
+    *               Geometry: the arrays of static, already compiled (display list) geometry are cleared. <br/>
+    *               Drawables reachable by a brtr::collisionMask, brtr::interactionMask or brtr::collisionProxyMask traversal are not touched,
+    *               the FPSCameraManipulator and the KeyHandler still need their vertices (and KdTrees) for intersecting.
+    *  @pre         viewer must be realized and one frame must have been rendered
+    */
+    class ReleaseCPUDataVisitor : public osg::NodeVisitor {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  contextID the id of the graphicscontext the scene was compiled for
+         */
+        ReleaseCPUDataVisitor(unsigned int contextID);
+        virtual void apply(osg::Node& node);
+        virtual void apply(osg::Geode& geode);
+
+        /**
+         * @brief bytes of vertex and index data released from the visited geometry
+         */
+        unsigned int getReleasedGeometryBytes() const;
+        /**
+         * @brief bytes of image data released right away (texture was already uploaded)
+         */
+        unsigned int getReleasedImageBytes() const;
+        /**
+         * @brief bytes of image data which will be released upon the first apply of its texture
+         */
+        unsigned int getPendingImageBytes() const;
+        /**
+         * @brief number of drawables kept because they are needed for collision or interaction
+         */
+        unsigned int getKeptDrawables() const;
+    private:
+        void releaseStateSet(osg::StateSet* stateSet);
+        void releaseTexture(osg::Texture* texture);
+        void releaseGeometry(osg::Geometry* geometry);
+        /**
+         * @brief checks, whether the drawable can be reached by a collision or interaction intersection
+         *
+         * @param  drawable the drawable to check, every parental path of every parent geode is considered
+         * @return true, if at least one path from the root to the drawable passes the collision or interaction mask
+         */
+        bool isNeededForIntersection(osg::Drawable& drawable) const;
+        unsigned int releaseArray(osg::Array* array);
+
+        unsigned int _contextID;
+        unsigned int _releasedGeometryBytes;
+        unsigned int _releasedImageBytes;
+        unsigned int _pendingImageBytes;
+        unsigned int _keptDrawables;
+        std::set<osg::Object*> _visited;
+    };
+}
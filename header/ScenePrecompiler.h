@@ -0,0 +1,67 @@
+#pragma once
+#include <osg/Node>
+#include <osg/Group>
+#include <osgUtil/IncrementalCompileOperation>
+#include <osgViewer/Viewer>
+#include <OpenThreads/Mutex>
+#include <string>
+#include <vector>
+#include "../header/ProgramBinaryCache.h"
+
+namespace brtr {
+    /**
+    *  @brief       Compiles the GL objects of the scene ahead of the render loop with an IncrementalCompileOperation
+    *  @details     Display lists, VBOs, textures and programs of every added subgraph are compiled, including the hidden
+    *               children of Switches (the second train, the weapons) and subgraphs not yet attached to the scene
+    *               (the portal gun of the WeaponHUD). <br/>
+    *               osgFX effects (CelShading) only create the StateSets of their passes upon the first cull, so add()
+    *               defines all their techniques and compiles the programs of the passes as well. The programs are
+    *               registered at the ProgramBinaryCache, if given. <br/>
+    *               compile() renders frames with a large compile budget, until every subgraph is compiled (at most
+    *               60 s, the rest is compiled upon first use), and reports the progress per subgraph.
+    *  @pre         construct and add() before the viewer is realized, compile() afterwards
+    */
+    class ScenePrecompiler : public osg::Referenced {
+    public:
+        /**
+         * @brief Constructor, sets the IncrementalCompileOperation of the viewer
+         *
+         * @param  viewer       the viewer
+         * @param  binaryCache  cache for the linked programs, may be nullptr
+         */
+        ScenePrecompiler(osgViewer::Viewer& viewer, ProgramBinaryCache* binaryCache = nullptr);
+
+        /**
+         * @brief adds a subgraph
+         *
+         * @param  node the subgraph
+         * @param  name shown in the progress report
+         */
+        void add(osg::Node* node, const std::string& name);
+        /**
+         * @brief adds the StateSet of a node which is not added itself, e.g. the root
+         */
+        void addStateSet(osg::StateSet* stateSet);
+
+        /**
+         * @brief renders frames until every added subgraph is compiled, afterwards the program binaries are saved
+         *
+         * @return number of rendered frames
+         */
+        unsigned int compile();
+    private:
+        class CompletedCallback;
+        struct Entry {
+            osg::ref_ptr<osg::Node> node;
+            std::string name;
+        };
+
+        osgViewer::Viewer& _viewer;
+        osg::ref_ptr<osgUtil::IncrementalCompileOperation> _ico;
+        osg::ref_ptr<ProgramBinaryCache> _binaryCache;
+        osg::ref_ptr<osg::Group> _states;          ///< one node per StateSet of an effect pass or addStateSet()
+        std::vector<Entry> _entries;
+        OpenThreads::Mutex _completedMutex;
+        std::vector<std::string> _completed;        ///< names, in the order the draw thread finished them
+    };
+}
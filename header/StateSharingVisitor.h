@@ -0,0 +1,72 @@
+#pragma once
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/StateSet>
+#include <map>
+#include <set>
+
+namespace brtr {
+    /**
+    *  @brief       Visitor which replaces equal StateSets, StateAttributes and Uniforms with shared instances
+    *  @details     Nodes and drawables without a StateSet are left untouched. StateSets, attributes and uniforms
+    *               which are DYNAMIC or have update/event callbacks are never shared, because they are changed at runtime
+    *               (e.g. by the KeyHandler or the switcher callbacks). <br/>
+    *               First the attributes (e.g. Materials created per object by Bench or ControlRoom) and uniforms of a
+    *               StateSet are replaced by the first equal instance seen, afterwards the StateSet itself.
+    *               Fewer unique StateSets means fewer state changes while drawing.
+    *  @pre         apply after all visitors modifying attributes in place (e.g. ModifyMaterialVisitor),
+    *               changing a shared attribute afterwards changes it for all users
+    */
+    class StateSharingVisitor : public osg::NodeVisitor {
+    public:
+        StateSharingVisitor();
+        virtual void apply(osg::Node& node);
+        virtual void apply(osg::Geode& geode);
+
+        /**
+         * @brief number of distinct StateSets visited
+         */
+        unsigned int getNumStateSets() const;
+        /**
+         * @brief number of distinct StateSets left after sharing
+         */
+        unsigned int getNumUniqueStateSets() const;
+        /**
+         * @brief number of attributes replaced by a shared instance
+         */
+        unsigned int getNumSharedAttributes() const;
+        /**
+         * @brief number of uniforms replaced by a shared instance
+         */
+        unsigned int getNumSharedUniforms() const;
+    private:
+        osg::StateSet* share(osg::StateSet* stateSet);
+        osg::StateAttribute* share(osg::StateAttribute* attribute);
+        osg::Uniform* share(osg::Uniform* uniform);
+        bool isChangedAtRuntime(const osg::Object* object) const;
+
+        struct LessAttribute {
+            bool operator()(const osg::ref_ptr<osg::StateAttribute>& lhs, const osg::ref_ptr<osg::StateAttribute>& rhs) const {
+                return lhs->compare(*rhs) < 0;
+            }
+        };
+        struct LessUniform {
+            bool operator()(const osg::ref_ptr<osg::Uniform>& lhs, const osg::ref_ptr<osg::Uniform>& rhs) const {
+                return lhs->compare(*rhs) < 0;
+            }
+        };
+        struct LessStateSet {
+            //attributes and uniforms are already shared, comparing the pointers is enough
+            bool operator()(const osg::ref_ptr<osg::StateSet>& lhs, const osg::ref_ptr<osg::StateSet>& rhs) const {
+                return lhs->compare(*rhs, false) < 0;
+            }
+        };
+
+        std::set<osg::ref_ptr<osg::StateAttribute>, LessAttribute> _attributes;
+        std::set<osg::ref_ptr<osg::Uniform>, LessUniform> _uniforms;
+        std::set<osg::ref_ptr<osg::StateSet>, LessStateSet> _stateSets;
+        std::map<osg::ref_ptr<osg::StateSet>, osg::ref_ptr<osg::StateSet>> _visited;
+        unsigned int _numSharedAttributes;
+        unsigned int _numSharedUniforms;
+    };
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <map>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Packs the static geometry of a subgraph into a few batches drawn by StaticBatchDrawElements
+    *  @details     Geodes below static, callback free groups and transforms are collected, if all their drawables are
+    *               static triangle geometry (Vec3Array vertices, Vec3 normals, Vec2 texture coordinates of unit 0).
+    *               Drawables with the same accumulated StateSet (including the material, the cel shaders read
+    *               gl_FrontMaterial) and in the same grid cell share one batch: the vertices are transformed to the
+    *               coordinates of the root and appended to shared vertex buffer objects, the triangles become one sub
+    *               draw of the batch with its own bounding box. <br/>
+    *               The grid cells keep the batches small enough for the zones and the culling of whole batches.
+    *               Switches, LODs, occlusion queries, effects, cameras and everything with callbacks, a dynamic
+    *               data variance, interaction (brtr::interactionMask) or user data are left as they are.
+    *               The batch Geodes get the node mask shared by all paths to their drawables (the mask is part of the
+    *               batch key), so the cameras and intersectors see them as before. Batched Geodes are removed.
+    *  @pre         apply after the CollisionProxyBuilder and before the ZoneManager and the OcclusionCuller
+    */
+    class StaticBatchBuilder : public osg::NodeVisitor {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  cellSize     edge length of the grid cells, 0 = one batch per state
+         * @param  gpuCulling   cull the sub draws with a compute shader, see StaticBatchDrawElements
+         */
+        StaticBatchBuilder(float cellSize = 100.0f, bool gpuCulling = false);
+        virtual void apply(osg::Node& node);
+        virtual void apply(osg::Geode& geode);
+
+        /**
+         * @brief builds the batches, adds them to the root and removes the batched Geodes
+         *
+         * @param  root the subgraph, the batches are in its coordinate frame
+         * @return number of batches
+         */
+        unsigned int build(osg::Group* root);
+
+        unsigned int getNumBatchedDrawables() const;
+        unsigned int getNumBatches() const;
+    private:
+        struct Candidate {
+            osg::ref_ptr<osg::Geometry> geometry;
+            osg::Matrix matrix;
+            osg::ref_ptr<osg::StateSet> stateSet;     ///< accumulated from the root to the drawable
+            osg::BoundingBox bound;                   ///< in the root frame
+            osg::Node::NodeMask nodeMask;             ///< of the whole path, without brtr::collisionProxyMask
+        };
+        struct Batch {
+            osg::ref_ptr<osg::StateSet> stateSet;
+            osg::Node::NodeMask nodeMask;
+            osg::Vec3 cell;                            ///< grid cell index (whole numbers)
+            std::vector<const Candidate*> candidates;
+        };
+
+        bool isBatchable(const osg::Node& node) const;
+        bool isBatchable(const osg::Geometry& geometry) const;
+        osg::ref_ptr<osg::StateSet> accumulateStateSet() const;
+        osg::ref_ptr<osg::Geode> createBatchGeode(const Batch& batch) const;
+
+        float _cellSize;
+        bool _gpuCulling;
+        osg::Group* _root;
+        std::map<osg::Geode*, std::vector<Candidate>> _candidates;
+        std::map<osg::Geode*, unsigned int> _numPaths;
+        std::map<osg::Geode*, bool> _rejected;
+        unsigned int _numBatchedDrawables;
+        unsigned int _numBatches;
+    };
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <osg/PrimitiveSet>
+#include <osg/BoundingBox>
+#include <osg/buffered_value>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Triangle list of a static batch, drawn with one multi draw call per frame and camera
+    *  @details     The indices of all source drawables are stored one after another, each sub draw keeps its range
+    *               and its bounding box (coordinates of the batch). On draw the sub draws are tested against the view
+    *               frustum of the current modelview and projection and the visible ranges are submitted with
+    *               glMultiDrawElements (neighbouring ranges merged). <br/>
+    *               With GPU culling (GL 4.3), a compute shader (Shader/batchCull.comp) tests the boxes and writes the
+    *               instance counts of an indirect buffer, which is submitted with glMultiDrawElementsIndirect.
+    *               The test runs in the draw thread, so the cameras and threading models do not matter. <br/>
+    *               Needs vertex buffer objects, display lists would freeze the culling.
+    */
+    class StaticBatchDrawElements : public osg::DrawElementsUInt {
+    public:
+        StaticBatchDrawElements();
+        StaticBatchDrawElements(const StaticBatchDrawElements& copy, const osg::CopyOp& copyop = osg::CopyOp::SHALLOW_COPY);
+        META_Object(brtr, StaticBatchDrawElements);
+
+        /**
+         * @brief appends a sub draw, its indices must already be appended
+         *
+         * @param  first    first index of the range
+         * @param  count    number of indices
+         * @param  bound    bounding box of the triangles
+         */
+        void addSubDraw(unsigned int first, unsigned int count, const osg::BoundingBox& bound);
+        unsigned int getNumSubDraws() const;
+
+        /**
+         * @brief cull on the GPU, falls back to the CPU if GL 4.3 is missing
+         */
+        void setGPUCulling(bool gpuCulling);
+        bool getGPUCulling() const;
+
+        virtual void draw(osg::State& state, bool useVertexBufferObjects) const;
+        virtual void resizeGLObjectBuffers(unsigned int maxSize);
+        /**
+         * @brief deletes the culling program and buffers of the context (all contexts, if state is null)
+         */
+        virtual void releaseGLObjects(osg::State* state = 0) const;
+    protected:
+        virtual ~StaticBatchDrawElements();
+    private:
+        struct SubDraw {
+            unsigned int first;
+            unsigned int count;
+            osg::BoundingBox bound;
+        };
+        struct PerContextData;
+
+        PerContextData& getPerContextData(osg::State& state) const;
+        void drawCPUCulled(PerContextData& data, const osg::Matrix& modelViewProjection, GLintptr offset) const;
+        bool drawGPUCulled(PerContextData& data, osg::State& state, const osg::Matrix& modelViewProjection, GLintptr offset) const;
+
+        std::vector<SubDraw> _subDraws;
+        bool _gpuCulling;
+        mutable osg::buffered_object<osg::ref_ptr<PerContextData>> _perContextData;
+    };
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Texture2D>
+#include <osgDB/Registry>
+#include <OpenThreads/Atomic>
+#include <set>
+#include <string>
+
+namespace brtr {
+    /**
+    *  @brief       Visitor replacing the images of the Texture2Ds in a scene by compressed, mipmapped ones
+    *  @details     For every texture image (files like wood.jpg as well as the images embedded in the .ive models) a cooked
+    *               file <cookedPath>/<image path>.dds is looked up (see getCookedFile()). If it exists and is not older than
+    *               the image file, it is loaded instead: S3TC/BC compressed with a precomputed mip chain, so the upload is a
+    *               plain copy. Image files are redirected before they are decoded by the CookedImageReadCallback, the visitor
+    *               only replaces the embedded images. Their staleness can only be checked, if the recorded file still exists:
+    *               delete the cooked file after changing an embedded texture. <br/>
+    *               In cook mode the missing files are created with the ImageProcessor of the osgDB Registry (nvtt plugin):
+    *               DXT1 for opaque, DXT5 for translucent images, mipmaps generated on the CPU. Without an ImageProcessor,
+    *               or for images which are not cooked yet, the driver compresses upon the upload and generates the mipmaps. <br/>
+    *               Textures with a NEAREST min filter (e.g. the toon ramps) and render targets are left as they are.
+    *  @pre         apply before the ReleaseCPUDataVisitor and the first frame
+    */
+    class TextureCookVisitor : public osg::NodeVisitor {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  cook         write the missing cooked files
+         * @param  cookedPath   directory of the cooked files
+         */
+        TextureCookVisitor(bool cook = false, const std::string& cookedPath = "../BlenderFiles/cooked");
+        virtual void apply(osg::Node& node);
+        virtual void apply(osg::Geode& geode);
+
+        unsigned int getNumLoaded() const;
+        unsigned int getNumCooked() const;
+        unsigned int getNumDriverCompressed() const;
+        /**
+         * @brief image bytes of the textures with a cooked file, before and after the replacement
+         */
+        unsigned int getBytesBefore() const;
+        unsigned int getBytesAfter() const;
+
+        /**
+         * @brief the cooked file of an image file
+         *
+         * The whole path is kept (wood.jpg and wood.png differ), drive letters, leading slashes and parent directories
+         * are dropped: ../BlenderFiles/textures/wood.jpg becomes <cookedPath>/BlenderFiles/textures/wood.jpg.dds
+         *
+         * @return empty, if imageFile has no name
+         */
+        static std::string getCookedFile(const std::string& cookedPath, const std::string& imageFile);
+        /**
+         * @brief true, if cookedFile exists and the source file is missing or not newer
+         */
+        static bool isCookedUpToDate(const std::string& cookedFile, const std::string& sourceFile);
+    private:
+        void applyStateSet(osg::StateSet* stateSet);
+        void applyTexture(osg::Texture2D& texture);
+        /**
+         * @brief compresses a copy of the image and writes it to cookedFile
+         *
+         * @return the compressed image, nullptr if there is no ImageProcessor or the file could not be written
+         */
+        osg::ref_ptr<osg::Image> cook(const osg::Image& image, const std::string& cookedFile) const;
+
+        bool _cook;
+        std::string _cookedPath;
+        std::set<osg::Object*> _visited;
+        unsigned int _numLoaded;
+        unsigned int _numCooked;
+        unsigned int _numDriverCompressed;
+        unsigned int _bytesBefore;
+        unsigned int _bytesAfter;
+    };
+
+    /**
+    *  @brief       Redirects the reads of image files to their cooked files (see TextureCookVisitor)
+    *  @details     The original image is only decoded, if there is no up to date cooked file. The returned image keeps
+    *               the name of the original file. Safe to be used by several loading threads.
+    *  @pre         set it as osgDB::Registry ReadFileCallback before the models are loaded
+    */
+    class CookedImageReadCallback : public osgDB::Registry::ReadFileCallback {
+    public:
+        CookedImageReadCallback(const std::string& cookedPath = "../BlenderFiles/cooked");
+        virtual osgDB::ReaderWriter::ReadResult readImage(const std::string& fileName, const osgDB::Options* options);
+        unsigned int getNumRedirected() const;
+    private:
+        std::string _cookedPath;
+        OpenThreads::Atomic _numRedirected;
+    };
+}
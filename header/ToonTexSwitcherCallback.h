@@ -1,14 +1,15 @@
 #pragma once
 #include <osg/NodeCallback>
 #include <osgViewer/Viewer>
-#include <osg/Texture2D>
+#include <osg/Uniform>
 #include "../header/BaseInteractionCallback.h"
 
 namespace brtr {
     /**
     *  @brief       Callback for switching the ToonTextures
-    *  @details	    Every click the next texture in the vector is choosen
-    *               scenedata is the node which stateset holds the textures
+    *  @details	    Every click the next layer of the toon texture array is choosen by the int uniform toonIndex,
+    *               the texture itself stays bound. scenedata is the node which stateset holds the uniform,
+    *               nodes below with an own toonIndex keep their ramp
     *  @author      Gleb Ostrowski
     *  @version     1.0
     *  @date        2014
@@ -19,13 +20,13 @@ namespace brtr {
         /**
         * @brief Constructor
         *
-        * @param  scenedata  node which stateset contains the ToonTextures
+        * @param  scenedata  node which stateset gets the toonIndex uniform
         * @param  hudCam
         * @param  width      screenWidth
         * @param  height     screenHeight
-        * @param  toonTexs   vector with ToonTextures
+        * @param  numToonTexs number of layers in the toon texture array
         */
-        ToonTexSwitcherCallback(osg::Node* scenedata, osg::Camera* hudCam, int width, int height, std::vector<osg::ref_ptr<osg::Texture2D>> toonTexs);
+        ToonTexSwitcherCallback(osg::Node* scenedata, osg::Camera* hudCam, int width, int height, unsigned int numToonTexs);
         //docu in parent
         virtual void setText();
     protected:
@@ -38,6 +39,7 @@ namespace brtr {
         virtual void interact(osg::Node* node, osg::NodeVisitor*);
     private:
         int _curTex;
-        std::vector<osg::ref_ptr<osg::Texture2D>> _toonTexs;
+        unsigned int _numToonTexs;
+        osg::ref_ptr<osg::Uniform> _toonIndex;
     };
 }
\ No newline at end of file
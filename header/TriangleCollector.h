@@ -0,0 +1,34 @@
+#pragma once
+#include <osg/Vec3>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Functor for osg::TriangleIndexFunctor, collects the triangles of any primitive set as an index list
+    *  @details     Degenerated triangles (the joints of the strips) are dropped. indices must be set before the
+    *               drawable is accepted.
+    */
+    struct TriangleCollector {
+        TriangleCollector() : indices(nullptr) {}
+        void operator()(unsigned int p1, unsigned int p2, unsigned int p3) {
+            if (p1 == p2 || p2 == p3 || p1 == p3)
+                return;
+            indices->push_back(p1);
+            indices->push_back(p2);
+            indices->push_back(p3);
+        }
+        std::vector<unsigned int>* indices;     ///< three per triangle
+    };
+
+    /**
+    *  @brief       Functor for osg::TriangleFunctor, collects the corner positions of all triangles of a drawable
+    */
+    struct TriangleVertexCollector {
+        void operator()(const osg::Vec3& v1, const osg::Vec3& v2, const osg::Vec3& v3, bool) {
+            vertices.push_back(v1);
+            vertices.push_back(v2);
+            vertices.push_back(v3);
+        }
+        std::vector<osg::Vec3> vertices;        ///< three per triangle
+    };
+}
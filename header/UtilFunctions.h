@@ -4,6 +4,7 @@
 #include <osg/Geometry>
 #include <osg/MatrixTransform>
 #include <osg/Texture2D>
+#include <osg/Texture2DArray>
 #include <osgViewer/Viewer>
 #include <osg/PositionAttitudeTransform>
 #include <osgText/Text>
@@ -11,6 +12,7 @@
 #include <osg/Shader>
 #include <osg/Material>
 #include <osgParticle/ParticleSystem>
+#include "../header/CelShading.h"
 #define _USE_MATH_DEFINES
 #include <cmath> 
 #include <functional>
@@ -28,6 +30,7 @@ namespace brtr {
     const int interactionMask = 0x2;
     const int interactionAndCollisionMask = collisionMask | interactionMask;
     const int fakeWallMask = 0x4;
+    const int collisionProxyMask = 0x8;     ///< simplified collision geometry, see CollisionProxyBuilder, never rendered
 
 
     /**
@@ -58,12 +61,36 @@ namespace brtr {
         osg::ref_ptr<osg::Camera> pass_0_depth;             ///< Camera for the first pass, renders the DepthBuffer to Texture
         osg::ref_ptr<osg::Camera> pass_PostProcess;         ///< PostProcess Camera, uses the texture from the first pass to create various effects
         std::vector<osg::ref_ptr<osg::Program>> programs;   ///< vector with the avaible postprocess programs
+        osg::ref_ptr<osg::Texture2D> colorTexture;          ///< texture pass_0_color renders to
+        osg::ref_ptr<osg::Texture2D> depthTexture;          ///< texture pass_0_depth renders to
+        osg::ref_ptr<osg::Uniform> rttScale;                ///< part of the textures actually rendered to (viewport/texturesize), used by the postprocess programs
+        osg::ref_ptr<CelShading> toonEffect;                ///< CelShading effect of the first pass, switches the depth pre-pass
+        unsigned int width;                                 ///< full resolution width of the pipeline
+        unsigned int height;                                ///< full resolution height of the pipeline
     };
 
+    /**
+     * @brief switches all programs to the GL 3.3 core profile variants in Shader/core, see CoreProfileVisitor
+     *
+     * Must be called before the rendering pipeline is created.
+     *
+     * @param core  use the core profile shaders
+     */
+    extern void setCoreShaders(bool core);
+    extern bool getCoreShaders();
+    /**
+     * @brief path of a shader file, relative to the working directory
+     *
+     * @param name  file name, e.g. "celShader.frag"
+     * @return      the file in Shader/ or Shader/core/
+     */
+    extern std::string shaderFile(const std::string& name);
+
     /**
      * @brief creates the rendering pipeline
      *
-     *  Creates the cameras and textures, attachs the textures to the cameras, set the projectionmatrix
+     *  Creates the cameras and textures, attachs the textures to the cameras, set the projectionmatrix.
+     *  The far plane follows the fog end of the active postprocess program, see FogFarPlaneCallback.
      * 
      *
      * @param width         the width of the texture, should be screenwidth 
@@ -71,8 +98,14 @@ namespace brtr {
      * @param rootForToon   Node which the CelShade effect will be applied to 
      * @param viewer        clipping pane and projectionmatrix will be set on this viewers cam        
      * @param pipe          pipe struct which should be filled
+     * @param fogColor      color of the fog in the postprocess pass
+     * @param outlines      draw the cel shading outlines
+     * @param samples       MSAA samples of the first pass, 0 = off
+     * @param program       index of the initially active postprocess program (0 = fog, 1 = sepia, 2 = waves)
+     * @param depthPrePass  start with the depth pre-pass of the CelShading effect, see CelShading::setDepthPrePass()
      */
-    extern void createRenderingPipeline(unsigned int width, unsigned int height, osg::Node& rootForToon, osgViewer::Viewer &viewer, RenderingPipeline& pipe, osg::Vec3f& fogColor);
+    extern void createRenderingPipeline(unsigned int width, unsigned int height, osg::Node& rootForToon, osgViewer::Viewer &viewer, RenderingPipeline& pipe, osg::Vec3f& fogColor,
+                                        bool outlines = true, unsigned int samples = 0, unsigned int program = 0, bool depthPrePass = false);
     
     /**
      * @brief creates a Light with a lightsource
@@ -93,9 +126,10 @@ namespace brtr {
      * @param buffer        which buffer should be written to texture 
      * @param tex           on this texture the buffer will be written to
      * @param isAbsolute    absolute or relative reference frame 
+     * @param samples       MSAA samples, 0 = off
      * @return              a ref_ptr holding the camera
      */
-    extern osg::ref_ptr<osg::Camera> createRTTCamera(osg::Camera::BufferComponent buffer, osg::Texture* tex, bool isAbsolute = false);
+    extern osg::ref_ptr<osg::Camera> createRTTCamera(osg::Camera::BufferComponent buffer, osg::Texture* tex, bool isAbsolute = false, unsigned int samples = 0);
     /**
      * @brief creates a texture-ready screen quad for postprocessing
      *
@@ -123,6 +157,7 @@ namespace brtr {
      * @brief creates a (arial) text object for use with a hud camera
      *
      * Original Function by Rui Wang/Xuelei Qian from OSG 3 Cookbook, Packt Publishing, 2012
+     * The font is shared via the FontManager.
      
      * @param pos       postion of the text in x_y plane
      * @param content   
@@ -171,7 +206,7 @@ namespace brtr {
     extern osg::ref_ptr<osg::Geometry> createRectangleWithTexcoords(double length, double width, int lsteps, int wsteps);
 
     /**
-    * @brief Creates a Cubiod with TRIANGLE_STRIPS using the createRectangle function
+    * @brief Creates a Cubiod with one indexed triangle list using the MeshBuilder
     *
     * Uses 6 Rectangles and creates a Cuboid of it.
     *
@@ -254,12 +289,13 @@ namespace brtr {
      */
     extern osg::ref_ptr<osg::Geode> createCrosshair(unsigned int width, unsigned int height);
     /**
-     * @brief creates a Texture2D object with the given toonTex
+     * @brief creates a Texture2DArray with one layer per toonTex
+     * @details the layer is chosen by the int uniform toonIndex, images of another size are scaled to the first one
      *
-     * @param  filename of the toontex
-     * @return ref_ptr containing the Texture2D
+     * @param  toonTexs filenames of the toontexs
+     * @return ref_ptr containing the Texture2DArray
      */
-    extern osg::ref_ptr<osg::Texture2D> createToonTex(std::string toonTex);
+    extern osg::ref_ptr<osg::Texture2DArray> createToonTexArray(const std::vector<std::string>& toonTexs);
 
 	/**
 	* @brief creates a simple material
@@ -0,0 +1,63 @@
+#pragma once
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <set>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Visitor converting all triangle primitives of a Geometry into one cache optimized, indexed triangle list
+    *  @details     Strips (with their degenerated stitching triangles), fans, quads and lists are collected into a
+    *               single GL_TRIANGLES DrawElements per Geometry. <br/>
+    *               The triangles are reordered for the post-transform vertex cache (Tom Forsyth, "Linear-Speed Vertex
+    *               Cache Optimisation"), afterwards the vertices are reordered by their first use (pre-transform fetch order)
+    *               and unused vertices are dropped. DrawElementsUShort is used, if the vertex count allows it. <br/>
+    *               Geometries with lines or points, deprecated index arrays, per primitive bindings, shared arrays
+    *               or unsupported array types are skipped. Geometries shared by several Geodes are processed once.
+    *               KdTrees of changed geometries are rebuilt.
+    */
+    class VertexCacheVisitor : public osg::NodeVisitor {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  cacheSize size of the simulated post-transform cache
+         */
+        VertexCacheVisitor(unsigned int cacheSize = 32);
+        virtual void apply(osg::Geode& geode);
+
+        /**
+         * @brief optimizes a single geometry
+         *
+         * @return true, if the geometry was changed
+         */
+        bool optimize(osg::Geometry& geometry);
+
+        unsigned int getNumOptimizedGeometries() const;
+        unsigned int getNumSkippedGeometries() const;
+        /**
+         * @brief average cache miss ratio (transformed vertices per triangle) of all optimized geometries, before
+         */
+        double getACMRBefore() const;
+        /**
+         * @brief average cache miss ratio (transformed vertices per triangle) of all optimized geometries, after
+         */
+        double getACMRAfter() const;
+    private:
+        /**
+         * @brief collects the per vertex arrays, false if the geometry can not be optimized
+         */
+        bool collectArrays(osg::Geometry& geometry, std::vector<osg::Array*>& arrays) const;
+        std::vector<unsigned int> optimizeTriangleOrder(const std::vector<unsigned int>& indices, unsigned int numVertices) const;
+        unsigned int countCacheMisses(const std::vector<unsigned int>& indices) const;
+
+        unsigned int _cacheSize;
+        std::set<osg::Geometry*> _visited;
+        unsigned int _numOptimized;
+        unsigned int _numSkipped;
+        unsigned int _numTriangles;
+        unsigned int _missesBefore;
+        unsigned int _missesAfter;
+    };
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Array>
+#include <osg/Program>
+#include <set>
+#include <vector>
+
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+#ifndef GL_INT_2_10_10_10_REV
+#define GL_INT_2_10_10_10_REV 0x8D9F
+#endif
+
+namespace brtr {
+    /**
+    *  @brief       One normal per element, packed as GL_INT_2_10_10_10_REV (signed normalized, w unused)
+    */
+    class PackedNormalArray : public osg::UIntArray {
+    public:
+        PackedNormalArray(unsigned int no = 0) : osg::UIntArray(no) {
+            _dataSize = 4;
+            _dataType = GL_INT_2_10_10_10_REV;
+        }
+        PackedNormalArray(const PackedNormalArray& array, const osg::CopyOp& copyop = osg::CopyOp::SHALLOW_COPY) :
+            osg::UIntArray(array, copyop) {}
+        virtual osg::Object* cloneType() const { return new PackedNormalArray(); }
+        virtual osg::Object* clone(const osg::CopyOp& copyop) const { return new PackedNormalArray(*this, copyop); }
+    };
+
+    /**
+    *  @brief       Two half floats (GL_HALF_FLOAT) per element, stored as the raw 16 bit patterns
+    */
+    class HalfFloat2Array : public osg::Vec2sArray {
+    public:
+        HalfFloat2Array(unsigned int no = 0) : osg::Vec2sArray(no) {
+            _dataType = GL_HALF_FLOAT;
+        }
+        HalfFloat2Array(const HalfFloat2Array& array, const osg::CopyOp& copyop = osg::CopyOp::SHALLOW_COPY) :
+            osg::Vec2sArray(array, copyop) {}
+        virtual osg::Object* cloneType() const { return new HalfFloat2Array(); }
+        virtual osg::Object* clone(const osg::CopyOp& copyop) const { return new HalfFloat2Array(*this, copyop); }
+    };
+
+    /**
+    *  @brief       Visitor compressing the vertex data of static geometry below the cel shading effects
+    *  @details     Normals (per vertex Vec3Array) are packed to GL_INT_2_10_10_10_REV, texture coordinates of unit 0
+    *               (Vec2Array) to half floats. Both become normalized vertex attributes (see normalAttribute and
+    *               texCoordAttribute), since the fixed function arrays do not accept these types in GL 2. <br/>
+    *               Positions of large meshes (at least minQuantizedVertices vertices) are quantized to shorts relative
+    *               to their bounding box, the box is passed by the uniforms positionOffset and positionScale and the
+    *               bound is frozen as initial bound. Drawables reachable by one of the given intersection masks keep their
+    *               float positions, the intersectors only understand float arrays. <br/>
+    *               Every changed geometry gets the uniforms compressedNormals, compressedTexCoords and quantizedPositions,
+    *               the cel shaders (celShader.vert, celOutline.vert) decode accordingly. Therefore the visitor must only
+    *               be applied to subgraphs rendered with CelShading, the CelShading programs bind the attribute locations.
+    *               <br/> Needs GL 3.3 or ARB_vertex_type_2_10_10_10_rev and ARB_half_float_vertex. Apply it after the
+    *               VertexCacheVisitor and the CollisionProxyBuilder and before the StateSharingVisitor.
+    */
+    class VertexCompressionVisitor : public osg::NodeVisitor {
+    public:
+        static const unsigned int normalAttribute = 6;      ///< not aliased with conventional arrays (NVIDIA)
+        static const unsigned int texCoordAttribute = 7;
+
+        /**
+         * @brief Constructor
+         *
+         * @param  intersectionMasks        drawables reachable with one of these masks keep float positions,
+         *                                  each mask is tested on its own
+         * @param  minQuantizedVertices     vertex count from which on positions are quantized
+         */
+        VertexCompressionVisitor(const std::vector<unsigned int>& intersectionMasks, unsigned int minQuantizedVertices = 1024);
+        virtual void apply(osg::Geode& geode);
+
+        /**
+         * @brief compresses a single geometry
+         *
+         * @param  geometry         the geometry
+         * @param  quantizePositions quantize the positions, if the geometry is large enough
+         * @return true, if the geometry was changed
+         */
+        bool compress(osg::Geometry& geometry, bool quantizePositions);
+
+        /**
+         * @brief binds the attribute locations of the compressed normals and texture coordinates
+         */
+        static void bindAttributes(osg::Program& program);
+
+        unsigned int getNumCompressedGeometries() const;
+        unsigned int getNumQuantizedGeometries() const;
+        unsigned int getBytesBefore() const;
+        unsigned int getBytesAfter() const;
+    private:
+        /**
+         * @brief checks, whether the drawable can be reached by an intersection with one of _intersectionMasks
+         */
+        bool isNeededForIntersection(osg::Drawable& drawable) const;
+        osg::StateSet* getCompressedStateSet(osg::Geometry& geometry) const;
+
+        std::vector<unsigned int> _intersectionMasks;
+        unsigned int _minQuantizedVertices;
+        std::set<osg::Geometry*> _visited;
+        unsigned int _numCompressed;
+        unsigned int _numQuantized;
+        unsigned int _bytesBefore;
+        unsigned int _bytesAfter;
+    };
+}
@@ -62,6 +62,10 @@ public:
      * @brief a portal gun is added to the weapon switch
      */
     void addPortalGun();
+    /**
+     * @brief the portal gun, not part of the scene until addPortalGun()
+     */
+    Node* getPortalGun();
     ~WeaponHUD();
 protected:
 private:
@@ -69,7 +73,12 @@ private:
      * @brief creates a weapon hud with the default weapon crowbar
      */
 	void createWeaponHUD();
+    /**
+     * @brief loads the portal gun and moves it to the lower right of the screen
+     */
+    ref_ptr<MatrixTransform> createPortalGun();
     ref_ptr<Switch> _switcher;
+    ref_ptr<MatrixTransform> _portalGun;
     ref_ptr<WeaponSwitchHandler> _handler;
 };
 }
@@ -0,0 +1,19 @@
+#pragma once
+#include <osg/NodeCallback>
+#include "../header/ZoneManager.h"
+
+namespace brtr {
+    /**
+    *  @brief       Cull callback skipping its node while its zone is not visible
+    *  @details     See ZoneManager::assign.
+    *  @pre         needs to be attached as cull callback
+    */
+    class ZoneCullCallback : public osg::NodeCallback {
+    public:
+        ZoneCullCallback(ZoneManager& manager, unsigned int zone);
+        virtual void operator()(osg::Node* node, osg::NodeVisitor* nv);
+    private:
+        osg::ref_ptr<ZoneManager> _manager;
+        unsigned int _zone;
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <osg/Referenced>
+#include <osg/Camera>
+#include <osg/BoundingBox>
+#include <osg/FrameStamp>
+#include <osg/observer_ptr>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Atomic>
+#include <string>
+#include <vector>
+
+namespace brtr {
+    /**
+    *  @brief       Zone/portal visibility for the station hall, the staircase and the control room
+    *  @details     Zones are author placed boxes, portals are boxes around the openings between two zones. Once per frame
+    *               (upon the first query) the zones visible from the camera's zone are computed: a neighbour zone is visible,
+    *               if the screen rectangle of the connecting portal overlaps the rectangle through which the current zone
+    *               is seen. Near a portal both sides count as camera zone, outside of all zones everything is visible. <br/>
+    *               Content is bound to zones by ZoneCullCallbacks (cull callbacks only, intersections and updates are
+    *               not affected), either explicitly or by assign(), which binds every Geode lying completely in one zone
+    *               (except below DYNAMIC or animated transforms, their content is never culled by zones).
+    *               The result is shared by all cameras of the frame (color and depth pass), it is computed from the
+    *               view and projection of the given (master) camera.
+    */
+    class ZoneManager : public osg::Referenced {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param  camera       the camera whose view decides the visibility
+         * @param  portalMargin distance to a portal from which on both zones are camera zones
+         */
+        ZoneManager(osg::Camera* camera, float portalMargin = 2.0f);
+
+        /**
+         * @brief adds a zone
+         *
+         * @return index of the zone
+         */
+        unsigned int addZone(const std::string& name, const osg::BoundingBox& box);
+        /**
+         * @brief adds a portal between two zones
+         *
+         * @param  opening box around the opening (world coordinates)
+         */
+        ZoneManager& addPortal(unsigned int zoneA, unsigned int zoneB, const osg::BoundingBox& opening);
+
+        /**
+         * @brief binds a node to a zone, it is culled if the zone is not visible
+         */
+        ZoneManager& assign(osg::Node* node, unsigned int zone);
+        /**
+         * @brief binds every Geode below root whose bound lies completely in one zone, moving subgraphs are skipped
+         *
+         * @return number of bound Geodes
+         */
+        unsigned int assign(osg::Node* root);
+
+        /**
+         * @brief visibility of a zone in the frame of frameStamp
+         */
+        bool isVisible(unsigned int zone, const osg::FrameStamp* frameStamp);
+        /**
+         * @brief number of zones culled in the last computed frame
+         */
+        unsigned int getNumCulledZones() const;
+        unsigned int getNumZones() const;
+        const std::string& getZoneName(unsigned int zone) const;
+        /**
+         * @brief index of the first zone containing the whole box, -1 if none
+         */
+        int findZone(const osg::BoundingBox& box) const;
+    private:
+        struct Zone {
+            std::string name;
+            osg::BoundingBox box;
+            std::vector<unsigned int> portals;
+        };
+        struct Portal {
+            unsigned int zoneA;
+            unsigned int zoneB;
+            osg::BoundingBox opening;
+        };
+        void update();
+        /**
+         * @brief marks the zones seen through the portals of zone, rect is (xmin, ymin, xmax, ymax) in NDC
+         */
+        void traversePortals(unsigned int zone, const osg::Vec4& rect, const osg::Matrix& viewProjection, std::vector<bool>& onPath);
+        /**
+         * @brief screen rectangle of a box, false if the box reaches behind the camera
+         */
+        bool project(const osg::BoundingBox& box, const osg::Matrix& viewProjection, osg::Vec4& rect) const;
+
+        osg::observer_ptr<osg::Camera> _camera;
+        float _portalMargin;
+        std::vector<Zone> _zones;
+        std::vector<Portal> _portals;
+        std::vector<bool> _visible;
+        OpenThreads::Atomic _computedFrame;         ///< frame number of _visible, set after computing it
+        unsigned int _numCulled;
+        OpenThreads::Mutex _mutex;                  ///< only taken by the first query of a frame
+    };
+}